@@ -0,0 +1,117 @@
+#!/usr/bin/env python3
+"""
+Measures what net dormancy saves for CoopGame.
+
+Runs the soak test of RunPerfTest.py twice with COOP.LogNetConsidered 1, first with COOP.NetDormancy 0 and
+then with 1, and prints per class how many actors per second the server considered for replication in each run.
+Both runs use the same scenario settings and seed.
+
+    Build/Scripts/CompareNetDormancy.py --clients 2 --waves 5
+    Build/Scripts/CompareNetDormancy.py --logs Saved/PerfTest/<run>/Awake/Server.log Saved/PerfTest/<run>/Dormant/Server.log
+
+Exit codes: 0 compared, 2 a run failed or logged no counts.
+"""
+
+import argparse
+import datetime
+import os
+import re
+import sys
+
+import RunPerfTest
+
+# Logged by FCSNetStats once per second for every class that was considered, prefixed with the frame it was logged on
+CONSIDERED_LINE = re.compile(r"^(\[[^\]]*\]\[[^\]]*\])LogCoop: Net: (\S+) considered ([0-9.]+)/s")
+
+
+def parse_args():
+    parser = argparse.ArgumentParser(description="Compare per class replication counts with and without net dormancy.")
+    parser.add_argument("--engine", default=os.environ.get("UE4_ROOT", ""), help="Engine root, used when there are no packaged binaries. Defaults to $UE4_ROOT")
+    parser.add_argument("--server-exe")
+    parser.add_argument("--client-exe")
+    parser.add_argument("--map", default="/Game/Maps/P_TestMap")
+    parser.add_argument("--game", default="/Game/Blueprints/BP_GameModeTesting.BP_GameModeTesting_C")
+    parser.add_argument("--clients", type=int, default=2)
+    parser.add_argument("--players", type=int, default=2)
+    parser.add_argument("--waves", type=int, default=5)
+    parser.add_argument("--fps", type=float, default=30.0)
+    parser.add_argument("--seed", type=int, default=1)
+    parser.add_argument("--hitch-ms", type=float, default=100.0)
+    parser.add_argument("--port", type=int, default=7777)
+    parser.add_argument("--timeout", type=float, default=1800.0)
+    parser.add_argument("--start-timeout", type=float, default=300.0)
+    parser.add_argument("--output", help="Directory for both runs. Defaults to Saved/PerfTest/<time>")
+    parser.add_argument("--logs", nargs=2, metavar=("AWAKE_LOG", "DORMANT_LOG"), help="Compare two existing server logs instead of running the test")
+    return parser.parse_args()
+
+
+def cvar_args(dormancy):
+    # Set through the ini so the cvars apply before the map spawns its pickups and barrels, COOP.NetDormancy is read on spawn
+    return ["-ini:Engine:[ConsoleVariables]:COOP.LogNetConsidered=1,[ConsoleVariables]:COOP.NetDormancy=%d" % dormancy]
+
+
+def read_considered(log_path):
+    """Returns the average considered count per second of each class over the whole run"""
+    totals = {}
+    intervals = set()
+
+    with open(log_path, errors="replace") as log_file:
+        for line in log_file:
+            match = CONSIDERED_LINE.match(line)
+            if match is None:
+                continue
+
+            # Classes that were not considered in an interval are not logged, they count as zero for it
+            intervals.add(match.group(1))
+            totals[match.group(2)] = totals.get(match.group(2), 0.0) + float(match.group(3))
+
+    if not intervals:
+        return None
+
+    return {name: total / len(intervals) for name, total in totals.items()}
+
+
+def compare(awake, dormant):
+    names = sorted(set(awake) | set(dormant), key=lambda name: -awake.get(name, 0.0))
+
+    print("%-40s %12s %12s %9s" % ("Class", "Awake/s", "Dormant/s", "Change"))
+    for name in names:
+        before = awake.get(name, 0.0)
+        after = dormant.get(name, 0.0)
+        change = "%+8.0f%%" % ((after - before) / before * 100.0) if before > 0.0 else "%9s" % "new"
+        print("%-40s %12.1f %12.1f %s" % (name, before, after, change))
+
+    print("%-40s %12.1f %12.1f" % ("Total", sum(awake.values()), sum(dormant.values())))
+
+
+def main():
+    args = parse_args()
+
+    if args.logs:
+        log_paths = args.logs
+    else:
+        output_dir = args.output or os.path.join(RunPerfTest.PROJECT_DIR, "Saved", "PerfTest", datetime.datetime.now().strftime("%Y.%m.%d-%H.%M.%S"))
+
+        log_paths = []
+        for name, dormancy in (("Awake", 0), ("Dormant", 1)):
+            run_dir = os.path.join(output_dir, name)
+            os.makedirs(run_dir, exist_ok=True)
+
+            if RunPerfTest.run_test(args, run_dir, cvar_args(dormancy)) is None:
+                return 2
+
+            log_paths.append(os.path.join(run_dir, "Server.log"))
+
+    awake = read_considered(log_paths[0])
+    dormant = read_considered(log_paths[1])
+    for log_path, counts in zip(log_paths, (awake, dormant)):
+        if counts is None:
+            print("No considered counts in %s." % log_path)
+            return 2
+
+    compare(awake, dormant)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,301 @@
+#!/usr/bin/env python3
+"""
+Performance regression test for CoopGame.
+
+Boots a dedicated server running the soak test (see UCSSoakTestComponent) and a number of headless
+clients on this machine. The server plays a fixed number of waves with seeded stand-in players. Stand-ins
+and clients all play in one match, however many there are. When the soak report is written, the run is
+summarized and compared against a stored baseline.
+
+    Build/Scripts/RunPerfTest.py --clients 2 --waves 10
+    Build/Scripts/RunPerfTest.py --update-baseline
+    Build/Scripts/RunPerfTest.py --report Saved/PerfTest/<run>/Soak.csv
+
+Exit codes: 0 passed, 1 regressed, 2 the run failed or the baseline does not match the settings.
+"""
+
+import argparse
+import csv
+import datetime
+import json
+import os
+import signal
+import subprocess
+import sys
+import time
+
+SCRIPT_DIR = os.path.dirname(os.path.abspath(__file__))
+PROJECT_DIR = os.path.abspath(os.path.join(SCRIPT_DIR, "..", ".."))
+PROJECT_FILE = os.path.join(PROJECT_DIR, "CoopGame.uproject")
+DEFAULT_BASELINE = os.path.join(SCRIPT_DIR, "PerfBaseline.json")
+
+# Metric -> (how waves are combined, absolute slack on top of the relative threshold)
+# Higher is worse for all of them
+METRICS = {
+    "FrameP50Ms": ("median", 0.5),
+    "FrameP90Ms": ("median", 0.5),
+    "FrameP99Ms": ("max", 1.0),
+    "FrameMaxMs": ("max", 5.0),
+    "PhysicsAvgMs": ("mean", 0.2),
+    "Hitches": ("sum", 2),
+    "NetOutKBpsAvg": ("mean", 1.0),
+    "NetOutKBpsMax": ("max", 2.0),
+    "MemoryHighWaterMB": ("max", 32.0),
+    "HeapAllocsAvg": ("mean", 5.0),
+}
+
+# Settings a baseline is only valid for, with the soak report column they are recorded in and their type
+SETTINGS = {
+    "map": ("SettingMap", str),
+    "game": ("SettingGame", str),
+    "clients": ("SettingClients", int),
+    "players": ("SettingPlayers", int),
+    "waves": ("SettingWaves", int),
+    "fps": ("SettingFPS", float),
+    "seed": ("SettingSeed", int),
+    "hitch_ms": ("SettingHitchMs", float),
+}
+
+# Logged by the soak test once the map is loaded and the server listens for clients
+SERVER_READY_LINE = "Soak: Running"
+
+
+def parse_args():
+    parser = argparse.ArgumentParser(description="Run the CoopGame performance test and compare it against a baseline.")
+    parser.add_argument("--engine", default=os.environ.get("UE4_ROOT", ""), help="Engine root, used when there are no packaged binaries. Defaults to $UE4_ROOT")
+    parser.add_argument("--server-exe", help="Dedicated server binary. Defaults to Binaries/Linux/CoopGameServer, else the editor with -server")
+    parser.add_argument("--client-exe", help="Client binary. Defaults to Binaries/Linux/CoopGame, else the editor with -game")
+    parser.add_argument("--map", default="/Game/Maps/P_TestMap")
+    parser.add_argument("--game", default="/Game/Blueprints/BP_GameModeTesting.BP_GameModeTesting_C")
+    parser.add_argument("--clients", type=int, default=2, help="Headless clients joining the server")
+    parser.add_argument("--players", type=int, default=2, help="Stand-in players on the server, they do the shooting")
+    parser.add_argument("--waves", type=int, default=10)
+    parser.add_argument("--fps", type=float, default=30.0, help="Fixed frame rate of the server")
+    parser.add_argument("--seed", type=int, default=1)
+    parser.add_argument("--hitch-ms", type=float, default=100.0)
+    parser.add_argument("--port", type=int, default=7777)
+    parser.add_argument("--timeout", type=float, default=1800.0, help="Seconds before the run is aborted")
+    parser.add_argument("--start-timeout", type=float, default=300.0, help="Seconds the server may take to load the map")
+    parser.add_argument("--output", help="Directory for the report and logs. Defaults to Saved/PerfTest/<time>")
+    parser.add_argument("--baseline", default=DEFAULT_BASELINE)
+    parser.add_argument("--threshold", type=float, default=0.10, help="Allowed relative increase of a metric over the baseline")
+    parser.add_argument("--update-baseline", action="store_true", help="Store the results as the new baseline instead of comparing")
+    parser.add_argument("--report", help="Compare an existing soak report instead of running the test")
+    return parser.parse_args()
+
+
+def find_command(explicit_exe, packaged_name, editor_mode, engine):
+    if explicit_exe:
+        return [explicit_exe]
+
+    packaged = os.path.join(PROJECT_DIR, "Binaries", "Linux", packaged_name)
+    if os.path.isfile(packaged):
+        return [packaged]
+
+    editor = os.path.join(engine, "Engine", "Binaries", "Linux", "UE4Editor")
+    if engine and os.path.isfile(editor):
+        return [editor, PROJECT_FILE, editor_mode]
+
+    sys.exit("No %s binary found, build the project or pass --engine / --%s-exe." % (packaged_name, "server" if editor_mode == "-server" else "client"))
+
+
+def wait_for_server(server, log_path, timeout):
+    deadline = time.time() + timeout
+    while time.time() < deadline:
+        if server.poll() is not None:
+            print("The server exited with code %d before it was ready, see %s" % (server.returncode, log_path))
+            return False
+
+        if os.path.isfile(log_path):
+            with open(log_path, errors="replace") as log_file:
+                if SERVER_READY_LINE in log_file.read():
+                    return True
+
+        time.sleep(0.5)
+
+    print("The server was not ready after %.0fs, see %s" % (timeout, log_path))
+    server.kill()
+    return False
+
+
+def run_test(args, output_dir, extra_server_args=()):
+    report_path = os.path.join(output_dir, "Soak.csv")
+    server_log_path = os.path.join(output_dir, "Server.log")
+
+    server_cmd = find_command(args.server_exe, "CoopGameServer", "-server", args.engine) + [
+        "%s?game=%s" % (args.map, args.game),
+        "-port=%d" % args.port,
+        "-log", "-unattended", "-nopause",
+        "-abslog=%s" % server_log_path,
+        "-Soak",
+        "-SoakWaves=%d" % args.waves,
+        "-SoakPlayers=%d" % args.players,
+        "-SoakClients=%d" % args.clients,
+        "-SoakFPS=%g" % args.fps,
+        "-SoakSeed=%d" % args.seed,
+        "-SoakHitchMs=%g" % args.hitch_ms,
+        "-SoakReport=%s" % report_path,
+    ] + list(extra_server_args)
+
+    client_cmd = find_command(args.client_exe, "CoopGame", "-game", args.engine) + [
+        "127.0.0.1:%d" % args.port,
+        "-nullrhi", "-nosound", "-unattended", "-nopause", "-log",
+    ]
+
+    print("Server: %s" % " ".join(server_cmd))
+    server = subprocess.Popen(server_cmd, stdout=subprocess.DEVNULL, stderr=subprocess.STDOUT)
+
+    # Clients connect once the map is loaded, the soak test waits for them
+    if not wait_for_server(server, server_log_path, args.start_timeout):
+        return None
+
+    clients = []
+    for index in range(args.clients):
+        log_path = os.path.join(output_dir, "Client%d.log" % index)
+        clients.append(subprocess.Popen(client_cmd + ["-abslog=%s" % log_path], stdout=subprocess.DEVNULL, stderr=subprocess.STDOUT))
+
+    try:
+        server.wait(timeout=args.timeout)
+    except subprocess.TimeoutExpired:
+        print("Run timed out after %.0fs." % args.timeout)
+        server.kill()
+    finally:
+        for client in clients:
+            if client.poll() is None:
+                client.send_signal(signal.SIGTERM)
+        for client in clients:
+            try:
+                client.wait(timeout=30.0)
+            except subprocess.TimeoutExpired:
+                client.kill()
+
+    if not os.path.isfile(report_path):
+        print("The server did not write a report, see %s" % server_log_path)
+        return None
+
+    return report_path
+
+
+def combine(values, how):
+    if not values:
+        return None
+    if how == "sum":
+        return sum(values)
+    if how == "max":
+        return max(values)
+    if how == "mean":
+        return sum(values) / len(values)
+    values = sorted(values)
+    middle = len(values) // 2
+    return values[middle] if len(values) % 2 else (values[middle - 1] + values[middle]) / 2.0
+
+
+def read_report(report_path):
+    with open(report_path, newline="") as report_file:
+        return list(csv.DictReader(report_file))
+
+
+def report_settings(waves):
+    # Reports written before the settings columns existed cannot be matched to a baseline
+    first = waves[0]
+    if any(column not in first for column, _ in SETTINGS.values()):
+        return None
+
+    return {key: kind(first[column]) for key, (column, kind) in SETTINGS.items()}
+
+
+def summarize(waves):
+    summary = {"Waves": len(waves)}
+    for metric, (how, _) in METRICS.items():
+        values = [float(wave[metric]) for wave in waves if metric in wave]
+
+        # Heap allocations are -1 when they were not counted
+        values = [value for value in values if value >= 0.0]
+
+        value = combine(values, how)
+        if value is not None:
+            summary[metric] = round(value, 3)
+
+    return summary
+
+
+def compare(summary, baseline, threshold):
+    regressions = []
+
+    print("%-20s %12s %12s %12s" % ("Metric", "Baseline", "Result", "Limit"))
+    for metric, (_, slack) in METRICS.items():
+        if metric not in summary or metric not in baseline:
+            continue
+
+        base = baseline[metric]
+        limit = base * (1.0 + threshold) + slack
+        value = summary[metric]
+        failed = value > limit
+
+        print("%-20s %12.2f %12.2f %12.2f%s" % (metric, base, value, limit, "  REGRESSED" if failed else ""))
+        if failed:
+            regressions.append(metric)
+
+    return regressions
+
+
+def main():
+    args = parse_args()
+
+    if args.report:
+        report_path = args.report
+    else:
+        output_dir = args.output or os.path.join(PROJECT_DIR, "Saved", "PerfTest", datetime.datetime.now().strftime("%Y.%m.%d-%H.%M.%S"))
+        os.makedirs(output_dir, exist_ok=True)
+        report_path = run_test(args, output_dir)
+        if report_path is None:
+            return 2
+
+    waves = read_report(report_path)
+    if not waves:
+        print("No waves in %s, the run did not finish." % report_path)
+        return 2
+
+    # Compare the settings the report was recorded with, not the ones on this command line
+    settings = report_settings(waves)
+    if settings is None:
+        print("%s has no settings columns, it was written by an older build." % report_path)
+        return 2
+
+    summary = summarize(waves)
+
+    if summary["Waves"] < settings["waves"]:
+        print("Only %d of %d waves were played." % (summary["Waves"], settings["waves"]))
+        return 2
+
+    if args.update_baseline:
+        with open(args.baseline, "w") as baseline_file:
+            json.dump({"settings": settings, "metrics": summary}, baseline_file, indent=4, sort_keys=True)
+            baseline_file.write("\n")
+        print("Baseline written to %s" % args.baseline)
+        return 0
+
+    if not os.path.isfile(args.baseline):
+        print(json.dumps(summary, indent=4, sort_keys=True))
+        print("No baseline at %s, run with --update-baseline to store one." % args.baseline)
+        return 2
+
+    with open(args.baseline) as baseline_file:
+        baseline = json.load(baseline_file)
+
+    # Results are only comparable for the same scenario
+    if baseline.get("settings") != settings:
+        print("Baseline was recorded with %s, the report with %s." % (baseline.get("settings"), settings))
+        return 2
+
+    regressions = compare(summary, baseline["metrics"], args.threshold)
+    if regressions:
+        print("Performance regressed: %s" % ", ".join(regressions))
+        return 1
+
+    print("Performance within %.0f%% of the baseline." % (args.threshold * 100.0))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -8,9 +8,12 @@ public class CoopGame : ModuleRules
 	{
 		PCHUsage = PCHUsageMode.UseExplicitOrSharedPCHs;
 	
-		PublicDependencyModuleNames.AddRange(new string[] { "Core", "CoreUObject", "Engine", "InputCore", "NavigationSystem" });
+		PublicDependencyModuleNames.AddRange(new string[] { "Core", "CoreUObject", "Engine", "InputCore", "NavigationSystem", "AIModule", "ReplicationGraph", "PacketHandler" });
 
 		PrivateDependencyModuleNames.AddRange(new string[] {  });
+
+		//Packet compression
+		AddEngineThirdPartyPrivateStaticDependencies(Target, "zlib");
         
 
         // Uncomment if you are using Slate UI
@@ -1,6 +1,39 @@
 // Fill out your copyright notice in the Description page of Project Settings.
 
 #include "CoopGame.h"
+#include "CSFrameScratch.h"
+#include "CSTelemetry.h"
+#include "CSRepProfiler.h"
 #include "Modules/ModuleManager.h"
 
-IMPLEMENT_PRIMARY_GAME_MODULE( FDefaultGameModuleImpl, CoopGame, "CoopGame" );
+
+class FCoopGameModule : public FDefaultGameModuleImpl
+{
+public:
+
+	virtual void StartupModule() override
+	{
+		FCSFrameScratch::Startup();
+		FCSTelemetry::Startup();
+		FCSRepProfiler::Startup();
+	}
+
+	virtual void ShutdownModule() override
+	{
+		FCSRepProfiler::Shutdown();
+		FCSTelemetry::Shutdown();
+		FCSFrameScratch::Shutdown();
+	}
+};
+
+DEFINE_LOG_CATEGORY(LogCoop);
+
+CSV_DEFINE_CATEGORY_MODULE(COOPGAME_API, Coop, true);
+
+DEFINE_STAT(STAT_CoopShots);
+DEFINE_STAT(STAT_CoopTraces);
+DEFINE_STAT(STAT_CoopPathQueries);
+DEFINE_STAT(STAT_CoopDamageEvents);
+DEFINE_STAT(STAT_CoopSpawnedEffects);
+
+IMPLEMENT_PRIMARY_GAME_MODULE( FCoopGameModule, CoopGame, "CoopGame" );
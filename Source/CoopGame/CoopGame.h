@@ -3,9 +3,55 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "Runtime/Launch/Resources/Version.h"
+#include "ProfilingDebugging/CsvProfiler.h"
 
 #define SURFACE_FLESHDEFAULT			SurfaceType1
 #define SURFACE_FLESHVULNERABLE		SurfaceType2
 
 #define COLLISION_WEAPON				ECC_GameTraceChannel1
 
+DECLARE_STATS_GROUP(TEXT("Coop"), STATGROUP_Coop, STATCAT_Advanced);
+
+// Gameplay timings and counters are recorded in CSV captures under the Coop category, e.g. -csvCaptureFrames on a dedicated server
+CSV_DECLARE_CATEGORY_MODULE_EXTERN(COOPGAME_API, Coop);
+
+// Per frame gameplay counters shared by several classes
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Shots"), STAT_CoopShots, STATGROUP_Coop, COOPGAME_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Traces"), STAT_CoopTraces, STATGROUP_Coop, COOPGAME_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Path Queries"), STAT_CoopPathQueries, STATGROUP_Coop, COOPGAME_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Damage Events"), STAT_CoopDamageEvents, STATGROUP_Coop, COOPGAME_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Spawned Effects"), STAT_CoopSpawnedEffects, STATGROUP_Coop, COOPGAME_API);
+
+// Counts an event of one of the counters above, e.g. COOP_INC_COUNTER(Shots), in stat coop and in CSV captures
+#define COOP_INC_COUNTER(Counter) \
+	do \
+	{ \
+		INC_DWORD_STAT(STAT_Coop##Counter); \
+		CSV_CUSTOM_STAT(Coop, Counter, 1, ECsvCustomStatOp::Accumulate); \
+	} while (0)
+
+// Times the rest of the scope with the cycle stat STAT_<Stat> declared by the file and as CSV timing <Stat>
+#define COOP_SCOPE_CYCLE_COUNTER(Stat) \
+	SCOPE_CYCLE_COUNTER(STAT_##Stat); \
+	CSV_SCOPED_TIMING_STAT(Coop, Stat)
+
+// Shipping builds keep warnings and errors only, the other log lines and their formatting are compiled out.
+// Gameplay events are recorded by FCSTelemetry instead
+#if UE_BUILD_SHIPPING
+DECLARE_LOG_CATEGORY_EXTERN(LogCoop, Log, Warning);
+#else
+DECLARE_LOG_CATEGORY_EXTERN(LogCoop, Log, All);
+#endif
+
+// Per instance custom data on instanced static meshes is only available from 4.25 on
+#define COOP_WITH_INSTANCE_CUSTOM_DATA	(ENGINE_MAJOR_VERSION > 4 || ENGINE_MINOR_VERSION >= 25)
+
+// Particles, sounds, camera shakes and material updates are compiled out of dedicated server builds
+#define COOP_WITH_COSMETICS				(!UE_SERVER)
+
+// Game thread heap allocations can be counted per frame outside of shipping builds, see FCSFrameScratch
+#define COOP_WITH_ALLOC_COUNTERS		(!UE_BUILD_SHIPPING)
+
+// Property reads are counted for the replication profiler outside of shipping builds, see FCSRepProfiler
+#define COOP_WITH_REP_PROFILER			(!UE_BUILD_SHIPPING)
@@ -0,0 +1,133 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "AI/CSSoakPlayerController.h"
+#include "CSCharacter.h"
+#include "CSMatchInstance.h"
+#include "Components/CSHealthComponent.h"
+#include "Engine/World.h"
+
+
+ACSSoakPlayerController::ACSSoakPlayerController()
+{
+	bWantsPlayerState = true;
+
+	PrimaryActorTick.bCanEverTick = true;
+
+	EngageRange = 2000.0f;
+	PreferredRange = 600.0f;
+	RetargetInterval = 0.5f;
+
+	bInvulnerable = true;
+	bFiring = false;
+	RetargetTimeLeft = 0.0f;
+}
+
+void ACSSoakPlayerController::OnPossess(APawn* InPawn)
+{
+	Super::OnPossess(InPawn);
+
+	if (InPawn && bInvulnerable)
+		InPawn->bCanBeDamaged = false;
+
+	Target = nullptr;
+	RetargetTimeLeft = 0.0f;
+}
+
+void ACSSoakPlayerController::OnUnPossess()
+{
+	SetFiring(Cast<ACSCharacter>(GetPawn()), false);
+	ClearFocus(EAIFocusPriority::Gameplay);
+
+	Super::OnUnPossess();
+}
+
+
+
+APawn* ACSSoakPlayerController::FindTarget() const
+{
+	APawn* MyPawn = GetPawn();
+
+	APawn* BestTarget = nullptr;
+	float BestDistanceSquared = FLT_MAX;
+
+	for (FConstPawnIterator It = GetWorld()->GetPawnIterator(); It; ++It)
+	{
+		APawn* TestPawn = It->Get();
+
+		//Pooled bots are hidden
+		if (TestPawn == nullptr || TestPawn == MyPawn || TestPawn->bHidden || UCSHealthComponent::IsFriendly(MyPawn, TestPawn) || !ACSMatchInstance::IsSameMatch(this, TestPawn))
+			continue;
+
+		UCSHealthComponent* HealthComp = Cast<UCSHealthComponent>(TestPawn->GetComponentByClass(UCSHealthComponent::StaticClass()));
+		if (HealthComp == nullptr || HealthComp->GetHealth() <= 0.0f)
+			continue;
+
+		float DistanceSquared = FVector::DistSquared(TestPawn->GetActorLocation(), MyPawn->GetActorLocation());
+		if (DistanceSquared < BestDistanceSquared)
+		{
+			BestTarget = TestPawn;
+			BestDistanceSquared = DistanceSquared;
+		}
+	}
+
+	return BestTarget;
+}
+
+void ACSSoakPlayerController::SetFiring(ACSCharacter* MyCharacter, bool bNewFiring)
+{
+	if (MyCharacter == nullptr || bFiring == bNewFiring)
+		return;
+
+	bFiring = bNewFiring;
+
+	if (bFiring)
+		MyCharacter->StartFire();
+	else
+		MyCharacter->StopFire();
+}
+
+
+
+void ACSSoakPlayerController::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	ACSCharacter* MyCharacter = Cast<ACSCharacter>(GetPawn());
+	if (MyCharacter == nullptr)
+		return;
+
+	RetargetTimeLeft -= DeltaSeconds;
+	if (RetargetTimeLeft <= 0.0f || !Target.IsValid() || Target->bHidden)
+	{
+		RetargetTimeLeft = RetargetInterval;
+
+		APawn* NewTarget = FindTarget();
+		if (NewTarget != Target.Get())
+		{
+			Target = NewTarget;
+
+			if (NewTarget)
+			{
+				SetFocus(NewTarget, EAIFocusPriority::Gameplay);
+				MoveToActor(NewTarget, PreferredRange);
+			}
+			else
+			{
+				ClearFocus(EAIFocusPriority::Gameplay);
+				StopMovement();
+			}
+		}
+	}
+
+	if (!Target.IsValid())
+	{
+		//Nothing to shoot, use the time to reload
+		SetFiring(MyCharacter, false);
+		MyCharacter->Reload();
+		return;
+	}
+
+	bool bInRange = FVector::DistSquared(Target->GetActorLocation(), MyCharacter->GetActorLocation()) < FMath::Square(EngageRange);
+	SetFiring(MyCharacter, bInRange && LineOfSightTo(Target.Get()));
+}
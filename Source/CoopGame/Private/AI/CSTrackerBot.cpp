@@ -2,10 +2,22 @@
 
 
 #include "AI/CSTrackerBot.h"
+#include "CoopGame.h"
+#include "CSMatchInstance.h"
+#include "CSNetStats.h"
+#include "CSRepProfiler.h"
+#include "CSActorPool.h"
+#include "CSReplicationGraph.h"
+#include "CSTriggerManager.h"
+#include "CSTeamFilter.h"
+#include "CSFrameScratch.h"
+#include "AI/CSTrackerBotSwarm.h"
+#include "AI/CSTrackerBotRenderer.h"
+#include "Components/CSSpawnDirectorComponent.h"
 #include "GameFramework/Actor.h"
+#include "GameFramework/GameStateBase.h"
 #include "Components/StaticMeshComponent.h"
 #include "Components/CSHealthComponent.h"
-#include "Components/SphereComponent.h"
 #include "Kismet/GameplayStatics.h"
 #include "NavigationSystem.h"
 #include "NavigationPath.h"
@@ -13,9 +25,9 @@
 #include "Materials/MaterialInstanceDynamic.h"
 #include "Kismet/GameplayStatics.h"
 #include "CSCharacter.h"
-#include "TimerManager.h"
 #include "Sound/SoundCue.h"
 #include "Kismet/KismetSystemLibrary.h"
+#include "Net/UnrealNetwork.h"
 
 
 static int32 DebugTrackerBotDrawing = 0;
@@ -25,12 +37,37 @@ FAutoConsoleVariableRef CVARDebugTrackerBotDrawing(
 	TEXT("Draw debug lines for tracker bots"),
 	ECVF_Cheat);
 
+static int32 TrackerBotPhysicsLOD = 1;
+FAutoConsoleVariableRef CVARTrackerBotPhysicsLOD(
+	TEXT("COOP.TrackerBotPhysicsLOD"),
+	TrackerBotPhysicsLOD,
+	TEXT("Let tracker bots far away from players move kinematically instead of simulating physics"),
+	ECVF_Default);
+
+static int32 TrackerBotCountContacts = 0;
+FAutoConsoleVariableRef CVARTrackerBotCountContacts(
+	TEXT("COOP.TrackerBotCountContacts"),
+	TrackerBotCountContacts,
+	TEXT("Count physics contacts between tracker bots for 'stat coop'. Only affects bots spawned afterwards"),
+	ECVF_Default);
+
+DECLARE_CYCLE_STAT(TEXT("Tracker Bot Path Query"), STAT_TrackerBotPathQuery, STATGROUP_Coop);
+DECLARE_CYCLE_STAT(TEXT("Tracker Bot Proximity"), STAT_TrackerBotProximity, STATGROUP_Coop);
+DECLARE_CYCLE_STAT(TEXT("Tracker Bot Explode"), STAT_TrackerBotExplode, STATGROUP_Coop);
+DECLARE_CYCLE_STAT(TEXT("Tracker Bot Tick"), STAT_TrackerBotTick, STATGROUP_Coop);
+
 
 // Sets default values
 ACSTrackerBot::ACSTrackerBot()
 {
-	// Set this pawn to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
+	//Movement and timers are driven by ACSTrackerBotSwarm on the server, clients tick to extrapolate movement
 	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bStartWithTickEnabled = false;
+
+	//Movement replicates through BotMovement, which only changes once client extrapolation drifts, clients extrapolate between updates
+	SetReplicateMovement(false);
+	NetUpdateFrequency = 10.0f;
+	MinNetUpdateFrequency = 2.0f;
 
 	//Components
 	MeshComp = CreateDefaultSubobject<UStaticMeshComponent>(TEXT("MeshComp"));
@@ -42,13 +79,6 @@ ACSTrackerBot::ACSTrackerBot()
 	HealthComp = CreateDefaultSubobject<UCSHealthComponent>(TEXT("HealthComp"));
 	HealthComp->OnHealthChanged.AddDynamic(this, &ACSTrackerBot::HandleTakeDamage);
 
-	SphereComp = CreateDefaultSubobject<USphereComponent>(TEXT("SphereComp"));
-	SphereComp->SetCollisionEnabled(ECollisionEnabled::QueryOnly);
-	SphereComp->SetCollisionResponseToAllChannels(ECR_Ignore);
-	SphereComp->SetCollisionResponseToChannel(ECC_Pawn, ECR_Overlap);
-	SphereComp->SetSphereRadius(200.0f);
-	SphereComp->SetupAttachment(RootComponent);
-
 	SphereCompRadius = 200.0f;
 
 	//Movement
@@ -56,6 +86,27 @@ ACSTrackerBot::ACSTrackerBot()
 	MovementForce = 1000;
 	RequiredDistanceToTarget = 100;
 	MaxTargetMoveDistance = 25.0f;
+	RefreshPathInterval = 5.0f;
+
+	//Physics LOD
+	PhysicsLODRadius = 2500.0f;
+	PhysicsLODHysteresis = 500.0f;
+	KinematicTickInterval = 0.1f;
+	KinematicNetUpdateFrequency = 2.0f;
+	KinematicMaxSpeed = 600.0f;
+	bKinematicLOD = false;
+	KinematicVelocity = FVector::ZeroVector;
+	BotRadius = 0.0f;
+	BotMass = 0.0f;
+
+	//Movement Replication
+	RepLocationTolerance = 10.0f;
+	RepVelocityTolerance = 50.0f;
+	RepMaxInterval = 1.0f;
+	ErrorCorrectionHalfLife = 0.1f;
+	ErrorSnapDistance = 400.0f;
+	MaxExtrapolationTime = 0.5f;
+	ErrorOffset = FVector::ZeroVector;
 
 	//Combat
 	ExplosionDamage = 60;
@@ -63,11 +114,19 @@ ACSTrackerBot::ACSTrackerBot()
 	DamageSelfInterval = 0.25f;
 
 	BotProximityDamageMultiplier = 0.1f;
+	ProximityCheckInterval = 1.0f;
 	MaxBotProximityMultiplierCount = 3;
 	BotsInProximityCount = 0;
 	
 	bExploded = false;
 	bHasStartedSelfDestruction = false;
+	SwarmIndex = INDEX_NONE;
+	RenderBatchIndex = INDEX_NONE;
+	RenderInstanceIndex = INDEX_NONE;
+	bPooled = false;
+	PoolGeneration = 0;
+	LocalPoolGeneration = 0;
+	MatchId = INDEX_NONE;
 
 	//Effects
 	ExplosionEffectScale = FVector::OneVector;
@@ -79,20 +138,69 @@ void ACSTrackerBot::BeginPlay()
 {
 	Super::BeginPlay();
 
-	if(Role == ROLE_Authority)
+	//Bots spawned into the actor pool skip the swarm and path finding until they are acquired
+	if (Role == ROLE_Authority)
+		bPooled = ACSActorPool::IsPooled(this);
+
+	SimulatedNetUpdateFrequency = NetUpdateFrequency;
+	BotRadius = MeshComp->Bounds.SphereRadius;
+	BotMass = MeshComp->GetMass();
+
+	if(Role == ROLE_Authority && !bPooled)
 	{
+		//Contacts only raise hit events when we are measuring them
+		if (TrackerBotCountContacts > 0)
+			MeshComp->SetNotifyRigidBodyCollision(true);
+
+		//Swarm runs the proximity checks and path refreshes from now on
+		Swarm = ACSTrackerBotSwarm::Get(GetWorld());
+		if (Swarm.IsValid())
+			Swarm->RegisterBot(this);
+
 		//Find initial move to
 		NextPathPoint = GetNextPathPoint();
 
-		//Set proximity check timer
-		GetWorldTimerManager().SetTimer(TimerHandle_BotProximity, this, &ACSTrackerBot::CheckProximity, 1.0f, true, 0.0f);
+		BotMovement.Location = GetActorLocation();
+		BotMovement.ServerTime = GetWorld()->TimeSeconds;
+	}
+	else if (Role != ROLE_Authority)
+	{
+		//Clients never simulate bots, they extrapolate the replicated movement
+		MeshComp->SetSimulatePhysics(false);
+		LocalPoolGeneration = PoolGeneration;
+		SetActorTickEnabled(!bPooled);
 	}
 
-	if (MatInstance == nullptr)
-		MatInstance = MeshComp->CreateAndSetMaterialInstanceDynamicFromMaterial(0, MeshComp->GetMaterial(0));
+	//Server and clients both start the self destruction, clients for its sound
+	ACSTriggerManager* TriggerManager = ACSTriggerManager::Get(GetWorld());
+	if (TriggerManager)
+	{
+		DetonationTrigger = TriggerManager->AddTrigger(this, SphereCompRadius, true,
+			FCSTriggerSignature::CreateUObject(this, &ACSTrackerBot::OnDetonationTriggerEnter));
+		TriggerManager->SetTriggerEnabled(DetonationTrigger, false);
+		TriggerManager->SetTriggerIgnoreMask(DetonationTrigger, FCSTeamFilter::GetTeamMask(this));
+	}
 
-	if (MatInstance)
-		MatInstance->SetScalarParameterValue("LastTimeDamageTaken", GetWorld()->TimeSeconds);
+	//Pooled bots stay hidden until they are activated
+	if (!bPooled)
+		ShowBot();
+
+	SetMaterialParameter("LastTimeDamageTaken", TRACKERBOT_CUSTOMDATA_LASTTIMEDAMAGETAKEN, GetWorld()->TimeSeconds);
+}
+
+void ACSTrackerBot::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (Swarm.IsValid())
+		Swarm->UnregisterBot(this);
+
+	if (Renderer.IsValid())
+		Renderer->RemoveBot(this);
+
+	ACSTriggerManager* TriggerManager = ACSTriggerManager::Get(GetWorld(), false);
+	if (TriggerManager)
+		TriggerManager->RemoveTrigger(DetonationTrigger);
+
+	Super::EndPlay(EndPlayReason);
 }
 
 
@@ -106,6 +214,8 @@ void ACSTrackerBot::RefreshPath()
 
 FVector ACSTrackerBot::GetNextPathPoint()
 {
+	COOP_SCOPE_CYCLE_COUNTER(TrackerBotPathQuery);
+
 	AActor* BestTarget = nullptr;
 	float NearestTargetDistance = FLT_MAX;
 
@@ -113,7 +223,7 @@ FVector ACSTrackerBot::GetNextPathPoint()
 	{
 		APawn* TestPawn = It->Get();
 
-		if (TestPawn == nullptr || UCSHealthComponent::IsFriendly(this, TestPawn))
+		if (TestPawn == nullptr || UCSHealthComponent::IsFriendly(this, TestPawn) || !ACSMatchInstance::IsSameMatch(this, TestPawn))
 			continue;
 
 		UCSHealthComponent* TestPawnHealthComp = Cast<UCSHealthComponent>(TestPawn->GetComponentByClass(UCSHealthComponent::StaticClass()));
@@ -130,10 +240,11 @@ FVector ACSTrackerBot::GetNextPathPoint()
 
 	if (BestTarget)
 	{
+		COOP_INC_COUNTER(PathQueries);
 		UNavigationPath* NavPath = UNavigationSystemV1::FindPathToActorSynchronously(this, GetActorLocation(), BestTarget);
 
-		GetWorldTimerManager().ClearTimer(TimerHandle_RefreshPath);
-		GetWorldTimerManager().SetTimer(TimerHandle_RefreshPath, this, &ACSTrackerBot::RefreshPath, 5.0f, false);
+		if (Swarm.IsValid())
+			Swarm->ScheduleRefreshPath(SwarmIndex, RefreshPathInterval);
 
 		if (NavPath && NavPath->PathPoints.Num() > 1)
 		{
@@ -151,19 +262,27 @@ void ACSTrackerBot::SelfDestruct()
 {
 	if (bExploded) return;
 
+	COOP_SCOPE_CYCLE_COUNTER(TrackerBotExplode);
 
 	bExploded = true;
 
+#if COOP_WITH_COSMETICS
 	UGameplayStatics::SpawnEmitterAtLocation(GetWorld(), ExplosionEffect, GetActorLocation(), FRotator::ZeroRotator, ExplosionEffectScale);
+	COOP_INC_COUNTER(SpawnedEffects);
 	UGameplayStatics::PlaySoundAtLocation(this, ExplosionSound, GetActorLocation());
+#endif
 	MeshComp->SetSimulatePhysics(false);
-	MeshComp->SetVisibility(false, true);
+	SetActorTickEnabled(false);
+	HideBot();
 	MeshComp->SetCollisionEnabled(ECollisionEnabled::NoCollision);
 
 	//Server logic
 	if (Role == ROLE_Authority)
 	{
-		TArray<AActor*> IgnoredActors;
+		if (Swarm.IsValid())
+			Swarm->UnregisterBot(this);
+
+		TCSFrameArray<AActor*> IgnoredActors;
 		IgnoredActors.Add(this);
 
 		//Apply radial damage
@@ -171,13 +290,17 @@ void ACSTrackerBot::SelfDestruct()
 		if (BotsInProximityCount > 0) 
 			TotalDamage *= 1 + (BotsInProximityCount * BotProximityDamageMultiplier);
 
-		UGameplayStatics::ApplyRadialDamage(this, TotalDamage, GetActorLocation(), ExplosionRadius, nullptr, IgnoredActors, this, GetInstigatorController(), true);
+		//Other bots are left out of the overlap
+		FCSTeamFilter::ApplyRadialDamage(this, TotalDamage, GetActorLocation(), ExplosionRadius, nullptr, IgnoredActors, GetInstigatorController(), true);
 
 		if (DebugTrackerBotDrawing)
 			DrawDebugSphere(GetWorld(), GetActorLocation(), ExplosionRadius, 12, FColor::Red, false, 2.0f, 0, 1.0f);
 
-		//Destroy actor immidiatly
-		SetLifeSpan(2.0f);
+		//Return to the pool or destroy the actor after a delay
+		if (SpawnDirector.IsValid())
+			SpawnDirector->ReleaseBot(this);
+		else
+			SetLifeSpan(2.0f);
 	}
 }
 
@@ -191,11 +314,7 @@ void ACSTrackerBot::HandleTakeDamage(UCSHealthComponent* HealthComponent, float
 	const class UDamageType* DamageType, class AController* InstigatedBy, AActor* DamageCauser)
 {
 	// @TODO Pulse material on hit
-	if(MatInstance == nullptr)
-		MatInstance = MeshComp->CreateAndSetMaterialInstanceDynamicFromMaterial(0, MeshComp->GetMaterial(0));
-
-	if (MatInstance)
-		MatInstance->SetScalarParameterValue("LastTimeDamageTaken", GetWorld()->TimeSeconds);
+	SetMaterialParameter("LastTimeDamageTaken", TRACKERBOT_CUSTOMDATA_LASTTIMEDAMAGETAKEN, GetWorld()->TimeSeconds);
 
 	//Explode if health is 0
 	if (Health == 0)
@@ -208,89 +327,512 @@ void ACSTrackerBot::HandleTakeDamage(UCSHealthComponent* HealthComponent, float
 
 void ACSTrackerBot::CheckProximity()
 {
-	TArray<TEnumAsByte<EObjectTypeQuery>> ObjectTypes;
-	ObjectTypes.Add(UEngineTypes::ConvertToObjectType(ECollisionChannel::ECC_WorldDynamic));
-	ObjectTypes.Add(UEngineTypes::ConvertToObjectType(ECollisionChannel::ECC_PhysicsBody));
+	COOP_SCOPE_CYCLE_COUNTER(TrackerBotProximity);
 
-	TArray<AActor*> ActorsToIgnore;
-	ActorsToIgnore.Add(this);
+	//Only called on the game thread, the overlap results keep their memory between calls
+	static TArray<FOverlapResult> Overlaps;
+	Overlaps.Reset();
 
-	TArray<AActor*> OutActors;
+	FCollisionObjectQueryParams ObjectParams;
+	ObjectParams.AddObjectTypesToQuery(ECC_WorldDynamic);
+	ObjectParams.AddObjectTypesToQuery(ECC_PhysicsBody);
 
-	UKismetSystemLibrary::SphereOverlapActors(GetWorld(), GetActorLocation(), SphereComp->GetScaledSphereRadius(), 
-		ObjectTypes, ACSTrackerBot::StaticClass(), ActorsToIgnore, OutActors);
+	FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(TrackerBotProximity), false, this);
 
-	BotsInProximityCount = FMath::Clamp(OutActors.Num(), 0, MaxBotProximityMultiplierCount);
+	GetWorld()->OverlapMultiByObjectType(Overlaps, GetActorLocation(), FQuat::Identity, ObjectParams, FCollisionShape::MakeSphere(SphereCompRadius), QueryParams);
+
+	//A bot is counted once, whatever number of its components overlap
+	TCSFrameArray<const AActor*> NearbyBots;
+	for (const FOverlapResult& Overlap : Overlaps)
+	{
+		const AActor* OverlapActor = Overlap.GetActor();
+		if (OverlapActor && OverlapActor != this && OverlapActor->IsA(ACSTrackerBot::StaticClass()))
+			NearbyBots.AddUnique(OverlapActor);
+	}
+
+	BotsInProximityCount = FMath::Clamp(NearbyBots.Num(), 0, MaxBotProximityMultiplierCount);
 	float GlowAmount = 0;
 
-	if (OutActors.Num() > 0)
+	if (NearbyBots.Num() > 0)
 		GlowAmount = BotsInProximityCount / (float)MaxBotProximityMultiplierCount;
 
 
-	//UE_LOG(LogTemp, Log, TEXT("Glow amount: %f"), GlowAmount);
+	//UE_LOG(LogCoop, Log, TEXT("Glow amount: %f"), GlowAmount);
+
+	SetMaterialParameter("GlowAmount", TRACKERBOT_CUSTOMDATA_GLOWAMOUNT, GlowAmount);
+}
+
+void ACSTrackerBot::ShowBot()
+{
+	ACSTriggerManager* TriggerManager = ACSTriggerManager::Get(GetWorld(), false);
+	if (TriggerManager)
+		TriggerManager->SetTriggerEnabled(DetonationTrigger, true);
+
+	//Draw the bot as part of a shared instanced mesh instead of its own mesh component
+	if (ACSTrackerBotRenderer::IsEnabled(GetWorld()))
+	{
+		Renderer = ACSTrackerBotRenderer::Get(GetWorld());
+		if (Renderer.IsValid() && Renderer->AddBot(this, MeshComp))
+		{
+			MeshComp->SetVisibility(false);
+			return;
+		}
+	}
+
+	MeshComp->SetVisibility(true);
+}
+
+void ACSTrackerBot::HideBot()
+{
+	ACSTriggerManager* TriggerManager = ACSTriggerManager::Get(GetWorld(), false);
+	if (TriggerManager)
+		TriggerManager->SetTriggerEnabled(DetonationTrigger, false);
+
+	MeshComp->SetVisibility(false, true);
+
+	if (Renderer.IsValid())
+		Renderer->RemoveBot(this);
+}
+
+void ACSTrackerBot::SetMaterialParameter(FName ParameterName, int32 CustomDataIndex, float Value)
+{
+#if COOP_WITH_COSMETICS
+	if (RenderInstanceIndex != INDEX_NONE)
+	{
+		if (Renderer.IsValid())
+			Renderer->SetCustomData(this, CustomDataIndex, Value);
+
+		return;
+	}
 
 	if (MatInstance == nullptr)
 		MatInstance = MeshComp->CreateAndSetMaterialInstanceDynamicFromMaterial(0, MeshComp->GetMaterial(0));
 
 	if (MatInstance)
-		MatInstance->SetScalarParameterValue("GlowAmount", GlowAmount);
+		MatInstance->SetScalarParameterValue(ParameterName, Value);
+#endif
+}
+
+
+
+void ACSTrackerBot::ApplySwarmStep(const FVector& SteeringForce, bool bReachedPathPoint, float DistanceToNearestPlayer, float DeltaTime)
+{
+	if (bExploded)
+		return;
+
+	UpdatePhysicsLOD(DistanceToNearestPlayer);
+
+	if (bReachedPathPoint)
+	{
+		NextPathPoint = GetNextPathPoint();
+
+		if (DebugTrackerBotDrawing)
+			DrawDebugString(GetWorld(), GetActorLocation(), "Target Reached!", NULL, FColor::Green, 1);
+	}
+	else
+	{
+		// Keep moving to next target
+		ApplyMovementForce(SteeringForce, DeltaTime);
+
+		if (DebugTrackerBotDrawing)
+			DrawDebugDirectionalArrow(GetWorld(), GetActorLocation(), GetActorLocation() + SteeringForce, 32.0f, FColor::Red, false, 0.0f, 0, 3.0f);
+	}
+
+	if (DebugTrackerBotDrawing)
+		DrawDebugSphere(GetWorld(), NextPathPoint, 20, 12, FColor::Yellow, false, 4.0f, 1.0f);
+}
+
+
+#pragma region Physics LOD
+
+void ACSTrackerBot::UpdatePhysicsLOD(float DistanceToNearestPlayer)
+{
+	if (TrackerBotPhysicsLOD <= 0)
+	{
+		SetKinematicLOD(false);
+		return;
+	}
+
+	//Hysteresis keeps bots on the edge of the radius from flipping every tick
+	if (bKinematicLOD && DistanceToNearestPlayer < PhysicsLODRadius)
+		SetKinematicLOD(false);
+	else if (!bKinematicLOD && DistanceToNearestPlayer > PhysicsLODRadius + PhysicsLODHysteresis)
+		SetKinematicLOD(true);
+}
+
+void ACSTrackerBot::SetKinematicLOD(bool bNewKinematic)
+{
+	if (bKinematicLOD == bNewKinematic || bExploded)
+		return;
+
+	bKinematicLOD = bNewKinematic;
+
+	if (bKinematicLOD)
+	{
+		//Carry the simulated velocity over so the bot keeps rolling where physics left it
+		KinematicVelocity = MeshComp->GetPhysicsLinearVelocity();
+		KinematicVelocity.Z = 0.0f;
+
+		MeshComp->SetSimulatePhysics(false);
+
+		UCSReplicationGraph::SetActorNetUpdateFrequency(this, KinematicNetUpdateFrequency);
+	}
+	else
+	{
+		MeshComp->SetSimulatePhysics(true);
+
+		//Hand the rolling state back to the physics body
+		if (Role == ROLE_Authority)
+		{
+			MeshComp->SetPhysicsLinearVelocity(KinematicVelocity);
+			if (BotRadius > 0.0f)
+				MeshComp->SetPhysicsAngularVelocityInRadians((FVector::UpVector ^ KinematicVelocity) / BotRadius);
+		}
+
+		UCSReplicationGraph::SetActorNetUpdateFrequency(this, SimulatedNetUpdateFrequency);
+	}
+
+	ForceNetUpdate();
+}
+
+void ACSTrackerBot::ApplyMovementForce(const FVector& Force, float DeltaTime)
+{
+	if (bKinematicLOD)
+		TickKinematicMovement(Force, DeltaTime);
+	else
+		MeshComp->AddForce(Force, NAME_None, bUseVelocityChange);
+}
+
+void ACSTrackerBot::TickKinematicMovement(const FVector& Force, float DeltaTime)
+{
+	//Same response to the force as the rigid body would have, without contacts or gravity
+	FVector Acceleration = Force;
+	if (!bUseVelocityChange && BotMass > KINDA_SMALL_NUMBER)
+		Acceleration /= BotMass;
+
+	KinematicVelocity += FVector(Acceleration.X, Acceleration.Y, 0.0f) * DeltaTime;
+	KinematicVelocity *= 1.0f / (1.0f + MeshComp->GetLinearDamping() * DeltaTime);
+	KinematicVelocity = KinematicVelocity.GetClampedToMaxSize(KinematicMaxSpeed);
+
+	FVector Delta = KinematicVelocity * DeltaTime;
+	if (Delta.IsNearlyZero())
+		return;
+
+	FHitResult Hit;
+	MeshComp->MoveComponent(Delta, GetRolledRotation(Delta), true, &Hit);
+
+	if (Hit.IsValidBlockingHit())
+	{
+		//Slide along whatever we ran into
+		KinematicVelocity = FVector::VectorPlaneProject(KinematicVelocity, Hit.Normal);
+		KinematicVelocity.Z = 0.0f;
+
+		MeshComp->MoveComponent(FVector::VectorPlaneProject(Delta, Hit.Normal) * (1.0f - Hit.Time), MeshComp->GetComponentQuat(), true);
+	}
+
+	//Keep the bot on the ground
+	FVector Location = GetActorLocation();
+	FHitResult GroundHit;
+	COOP_INC_COUNTER(Traces);
+	if (GetWorld()->LineTraceSingleByObjectType(GroundHit, Location, Location - FVector(0, 0, BotRadius * 4.0f), FCollisionObjectQueryParams(ECC_WorldStatic)))
+	{
+		MeshComp->MoveComponent(FVector(0, 0, GroundHit.ImpactPoint.Z + BotRadius - Location.Z), MeshComp->GetComponentQuat(), true);
+	}
+}
+
+FQuat ACSTrackerBot::GetRolledRotation(const FVector& Delta) const
+{
+	FVector GroundDelta(Delta.X, Delta.Y, 0.0f);
+	if (BotRadius <= 0.0f || GroundDelta.IsNearlyZero())
+		return GetActorQuat();
+
+	//Roll around the axis perpendicular to the movement direction
+	FVector RollAxis = (FVector::UpVector ^ GroundDelta).GetSafeNormal();
+	return FQuat(RollAxis, GroundDelta.Size() / BotRadius) * GetActorQuat();
+}
+
+#pragma endregion Physics LOD
+
+
+
+#pragma region Movement Replication
+
+bool FCSTrackerBotRepMovement::NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess)
+{
+	//Whole unit precision is plenty for a rolling bot, velocity needs a lot less range than the location
+	bOutSuccess = SerializePackedVector<1, 24>(Location, Ar);
+	bOutSuccess &= SerializePackedVector<1, 16>(Velocity, Ar);
+	Ar << ServerTime;
+
+	return true;
+}
+
+FVector ACSTrackerBot::GetBotVelocity() const
+{
+	return bKinematicLOD ? KinematicVelocity : MeshComp->GetPhysicsLinearVelocity();
 }
 
+void ACSTrackerBot::UpdateRepMovement()
+{
+	float TimeSeconds = GetWorld()->TimeSeconds;
+	float TimeSinceRep = TimeSeconds - BotMovement.ServerTime;
+
+	FVector Location = GetActorLocation();
+	FVector Velocity = GetBotVelocity();
+
+	//Only send new movement once the clients extrapolation drifts too far from the real movement
+	FVector ExtrapolatedLocation = BotMovement.Location + BotMovement.Velocity * FMath::Min(TimeSinceRep, MaxExtrapolationTime);
+
+	if (TimeSinceRep >= RepMaxInterval
+		|| FVector::DistSquared(ExtrapolatedLocation, Location) > FMath::Square(RepLocationTolerance)
+		|| FVector::DistSquared(BotMovement.Velocity, Velocity) > FMath::Square(RepVelocityTolerance))
+	{
+		BotMovement.Location = Location;
+		BotMovement.Velocity = Velocity;
+		BotMovement.ServerTime = TimeSeconds;
+	}
+}
+
+void ACSTrackerBot::OnRep_BotMovement()
+{
+	if (bExploded)
+		return;
+
+	COOP_REP_READ(BotMovement);
+
+	FVector RenderedLocation = GetActorLocation();
+
+	//Keep drawing the bot where it is and correct the error over time
+	ErrorOffset = RenderedLocation - (BotMovement.Location + BotMovement.Velocity * GetExtrapolationTime());
+	if (ErrorOffset.SizeSquared() > FMath::Square(ErrorSnapDistance))
+		ErrorOffset = FVector::ZeroVector;
+}
+
+void ACSTrackerBot::TickClientMovement(float DeltaTime)
+{
+	if (bExploded)
+		return;
+
+	float ExtrapolationTime = GetExtrapolationTime();
+
+	if (ErrorCorrectionHalfLife > 0.0f)
+		ErrorOffset *= FMath::Pow(0.5f, DeltaTime / ErrorCorrectionHalfLife);
+	else
+		ErrorOffset = FVector::ZeroVector;
+
+	COOP_REP_READ(BotMovement);
+	FVector NewLocation = BotMovement.Location + BotMovement.Velocity * ExtrapolationTime + ErrorOffset;
+
+	SetActorLocationAndRotation(NewLocation, GetRolledRotation(NewLocation - GetActorLocation()), false, nullptr, ETeleportType::TeleportPhysics);
+}
+
+float ACSTrackerBot::GetExtrapolationTime() const
+{
+	//Measured from when the server took the movement, so jitter on the way does not add to the error
+	AGameStateBase* GS = GetWorld()->GetGameState();
+	if (GS == nullptr)
+		return 0.0f;
+
+	return FMath::Clamp(GS->GetServerWorldTimeSeconds() - BotMovement.ServerTime, 0.0f, MaxExtrapolationTime);
+}
+
+void ACSTrackerBot::PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker)
+{
+	Super::PreReplication(ChangedPropertyTracker);
+
+	FCSNetStats::NotifyConsidered(this);
+	FCSRepProfiler::NotifyPreReplication(this);
+
+	if (Role == ROLE_Authority && !bExploded)
+		UpdateRepMovement();
+}
+
+void ACSTrackerBot::PostNetReceive()
+{
+	Super::PostNetReceive();
+
+	FCSRepProfiler::NotifyPostNetReceive(this);
+}
+
+#pragma endregion Movement Replication
+
 
 
 // Called every frame
 void ACSTrackerBot::Tick(float DeltaTime)
 {
+	COOP_SCOPE_CYCLE_COUNTER(TrackerBotTick);
+
 	Super::Tick(DeltaTime);
 
+	if (Role != ROLE_Authority)
+		TickClientMovement(DeltaTime);
+}
+
 
-	if (Role == ROLE_Authority && !bExploded)
+
+#pragma region Pooling
+
+void ACSTrackerBot::OnReleasedToPool_Implementation()
+{
+	if (Role != ROLE_Authority)
+		return;
+
+	bPooled = true;
+	//Keeps the swarm, overlaps and damage away from the bot while it is pooled
+	bExploded = true;
+
+	if (Swarm.IsValid())
+		Swarm->UnregisterBot(this);
+
+	//The pool hides the actor, disables its collision and tick and puts it to sleep
+	MeshComp->SetSimulatePhysics(false);
+	HideBot();
+}
+
+void ACSTrackerBot::OnAcquiredFromPool_Implementation()
+{
+	if (Role != ROLE_Authority)
+		return;
+
+	//Spawn directors acquire bots with their match instance as owner
+	ACSMatchInstance* Match = Cast<ACSMatchInstance>(GetOwner());
+	MatchId = Match ? Match->GetMatchId() : INDEX_NONE;
+	SpawnDirector = Match ? Match->FindComponentByClass<UCSSpawnDirectorComponent>() : nullptr;
+
+	bPooled = false;
+	PoolGeneration++;
+	LocalPoolGeneration = PoolGeneration;
+
+	//The swarm updates bots on the server, only clients tick them
+	SetActorTickEnabled(false);
+
+	bExploded = false;
+	bHasStartedSelfDestruction = false;
+	BotsInProximityCount = 0;
+
+	HealthComp->ResetHealth();
+
+	//Physics
+	bKinematicLOD = false;
+	KinematicVelocity = FVector::ZeroVector;
+	UCSReplicationGraph::SetActorNetUpdateFrequency(this, SimulatedNetUpdateFrequency);
+
+	MeshComp->SetCollisionEnabled(ECollisionEnabled::QueryAndPhysics);
+
+	MeshComp->SetSimulatePhysics(true);
+	MeshComp->SetPhysicsLinearVelocity(FVector::ZeroVector);
+	MeshComp->SetPhysicsAngularVelocityInRadians(FVector::ZeroVector);
+
+	ShowBot();
+	SetMaterialParameter("GlowAmount", TRACKERBOT_CUSTOMDATA_GLOWAMOUNT, 0.0f);
+
+	//Swarm timers start over with the registration
+	Swarm = ACSTrackerBotSwarm::Get(GetWorld());
+	if (Swarm.IsValid())
+		Swarm->RegisterBot(this);
+
+	NextPathPoint = GetNextPathPoint();
+
+	BotMovement.Location = GetActorLocation();
+	BotMovement.Velocity = FVector::ZeroVector;
+	BotMovement.ServerTime = GetWorld()->TimeSeconds;
+
+	ForceNetUpdate();
+}
+
+void ACSTrackerBot::OnRep_PoolState()
+{
+	if (bPooled)
+	{
+		bExploded = true;
+		SetActorTickEnabled(false);
+		HideBot();
+	}
+	else if (PoolGeneration != LocalPoolGeneration)
 	{
-		FVector TargetDelta = (NextPathPoint - GetActorLocation());
+		LocalPoolGeneration = PoolGeneration;
 
-		if (TargetDelta.Size() <= RequiredDistanceToTarget)
-		{
-			NextPathPoint = GetNextPathPoint();
+		bExploded = false;
+		bHasStartedSelfDestruction = false;
 
-			if (DebugTrackerBotDrawing)
-				DrawDebugString(GetWorld(), GetActorLocation(), "Target Reached!", NULL, FColor::Green, 1);
-		}
-		else
-		{
-			// Keep moving to next target
-			FVector ForceDirection = TargetDelta;
-			ForceDirection.Normalize();
-			ForceDirection *= MovementForce;
+		MeshComp->SetCollisionEnabled(ECollisionEnabled::QueryAndPhysics);
+		ShowBot();
+		SetMaterialParameter("GlowAmount", TRACKERBOT_CUSTOMDATA_GLOWAMOUNT, 0.0f);
 
-			MeshComp->AddForce(ForceDirection, NAME_None, bUseVelocityChange);
+		//Start extrapolating from the spawn location
+		SetActorLocation(BotMovement.Location, false, nullptr, ETeleportType::TeleportPhysics);
+		ErrorOffset = FVector::ZeroVector;
+		SetActorTickEnabled(true);
+	}
+}
 
-			if (DebugTrackerBotDrawing)
-				DrawDebugDirectionalArrow(GetWorld(), GetActorLocation(), GetActorLocation() + ForceDirection, 32.0f, FColor::Red, false, 0.0f, 0, 3.0f);
-		}
+void ACSTrackerBot::Reset()
+{
+	if (Role == ROLE_Authority && SpawnDirector.IsValid())
+	{
+		if (!bPooled)
+			SpawnDirector->ReturnBot(this);
 
-		if (DebugTrackerBotDrawing)
-			DrawDebugSphere(GetWorld(), NextPathPoint, 20, 12, FColor::Yellow, false, 4.0f, 1.0f);
+		return;
 	}
-	
+
+	Super::Reset();
 }
 
+#pragma endregion Pooling
 
-void ACSTrackerBot::NotifyActorBeginOverlap(AActor* OtherActor)
+
+
+bool ACSTrackerBot::IsNetRelevantFor(const AActor* RealViewer, const AActor* ViewTarget, const FVector& SrcLocation) const
+{
+	if (!ACSMatchInstance::IsSameMatch(this, RealViewer))
+		return false;
+
+	return Super::IsNetRelevantFor(RealViewer, ViewTarget, SrcLocation);
+}
+
+
+
+
+
+void ACSTrackerBot::OnDetonationTriggerEnter(AActor* OtherActor)
 {
 	if (!bHasStartedSelfDestruction && !bExploded)
 	{
-		if (HealthComp && !UCSHealthComponent::IsFriendly(this, OtherActor))
+		if (UCSHealthComponent::IsFriendly(this, OtherActor))
 		{
-			//We overlapped with player!
-			if (Role == ROLE_Authority)
-			{
-				//Start self destructing
-				GetWorldTimerManager().SetTimer(TimerHandle_DamageSelf, this, &ACSTrackerBot::DamageSelf, DamageSelfInterval, true, 0.0f);
-			}
-
+			FCSTeamFilter::NotifyFriendlyDiscarded("Trigger");
+		}
+		else if (HealthComp)
+		{
+			//Player came into the trigger!
+			//Start self destructing, on the server the swarm picks this up and damages the bot every DamageSelfInterval
 			bHasStartedSelfDestruction = true;
 
+#if COOP_WITH_COSMETICS
 			UGameplayStatics::SpawnSoundAttached(SelfDestructSound, RootComponent);
+#endif
 		}
 	}
-}
\ No newline at end of file
+}
+
+
+void ACSTrackerBot::NotifyHit(class UPrimitiveComponent* MyComp, AActor* Other, class UPrimitiveComponent* OtherComp, bool bSelfMoved, FVector HitLocation, FVector HitNormal, FVector NormalImpulse, const FHitResult& Hit)
+{
+	Super::NotifyHit(MyComp, Other, OtherComp, bSelfMoved, HitLocation, HitNormal, NormalImpulse, Hit);
+
+	ACSTrackerBot* OtherBot = Cast<ACSTrackerBot>(Other);
+	if (TrackerBotCountContacts > 0 && OtherBot && Swarm.IsValid())
+		Swarm->NotifyBotContact(this, OtherBot);
+}
+
+
+void ACSTrackerBot::GetLifetimeReplicatedProps(TArray< FLifetimeProperty > & OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME(ACSTrackerBot, BotMovement);
+	DOREPLIFETIME(ACSTrackerBot, bPooled);
+	DOREPLIFETIME(ACSTrackerBot, PoolGeneration);
+}
@@ -0,0 +1,206 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "AI/CSTrackerBotRenderer.h"
+#include "AI/CSTrackerBot.h"
+#include "CoopGame.h"
+#include "Engine/World.h"
+#include "Engine/StaticMesh.h"
+#include "EngineUtils.h"
+#include "Components/StaticMeshComponent.h"
+#include "Components/InstancedStaticMeshComponent.h"
+
+
+#if COOP_WITH_INSTANCE_CUSTOM_DATA
+static int32 TrackerBotInstancedRendering = 1;
+FAutoConsoleVariableRef CVARTrackerBotInstancedRendering(
+	TEXT("COOP.TrackerBotInstancedRendering"),
+	TrackerBotInstancedRendering,
+	TEXT("Render tracker bots through one instanced static mesh per mesh. Only affects bots spawned afterwards"),
+	ECVF_Default);
+#endif
+
+//Movement below this is not worth a render state update
+static const float InstanceLocationTolerance = 0.5f;
+static const float InstanceRotationTolerance = 0.01f;
+
+
+ACSTrackerBotRenderer::ACSTrackerBotRenderer()
+{
+	PrimaryActorTick.bCanEverTick = true;
+	//Follow the transforms after physics has moved the bots
+	PrimaryActorTick.TickGroup = TG_PostPhysics;
+
+	SetReplicates(false);
+
+	RootComponent = CreateDefaultSubobject<USceneComponent>(TEXT("SceneComp"));
+}
+
+bool ACSTrackerBotRenderer::IsEnabled(UWorld* World)
+{
+#if COOP_WITH_INSTANCE_CUSTOM_DATA && COOP_WITH_COSMETICS
+	return TrackerBotInstancedRendering > 0 && World && World->GetNetMode() != NM_DedicatedServer;
+#else
+	//Without custom data the damage flash and glow could not be shown on instances
+	return false;
+#endif
+}
+
+ACSTrackerBotRenderer* ACSTrackerBotRenderer::Get(UWorld* World)
+{
+	if (World == nullptr)
+		return nullptr;
+
+	for (TActorIterator<ACSTrackerBotRenderer> It(World); It; ++It)
+	{
+		if (!It->IsPendingKill())
+			return *It;
+	}
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	return World->SpawnActor<ACSTrackerBotRenderer>(SpawnParams);
+}
+
+
+
+int32 ACSTrackerBotRenderer::FindOrAddBatch(UStaticMeshComponent* BotMeshComp)
+{
+	UStaticMesh* Mesh = BotMeshComp->GetStaticMesh();
+
+	if (int32* BatchIndex = BatchIndexByMesh.Find(Mesh))
+		return *BatchIndex;
+
+	UInstancedStaticMeshComponent* InstanceComp = NewObject<UInstancedStaticMeshComponent>(this);
+	InstanceComp->SetStaticMesh(Mesh);
+	InstanceComp->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	InstanceComp->SetCanEverAffectNavigation(false);
+	InstanceComp->SetMobility(EComponentMobility::Movable);
+	InstanceComp->CastShadow = BotMeshComp->CastShadow;
+
+	for (int32 i = 0; i < BotMeshComp->GetNumMaterials(); i++)
+	{
+		InstanceComp->SetMaterial(i, BotMeshComp->GetMaterial(i));
+	}
+
+#if COOP_WITH_INSTANCE_CUSTOM_DATA
+	InstanceComp->SetNumCustomDataFloats(TRACKERBOT_CUSTOMDATA_NUM);
+#endif
+
+	InstanceComp->SetupAttachment(RootComponent);
+	InstanceComp->RegisterComponent();
+
+	FCSTrackerBotInstanceBatch Batch;
+	Batch.InstanceComp = InstanceComp;
+
+	int32 BatchIndex = Batches.Add(Batch);
+	BatchIndexByMesh.Add(Mesh, BatchIndex);
+
+	return BatchIndex;
+}
+
+bool ACSTrackerBotRenderer::AddBot(ACSTrackerBot* Bot, UStaticMeshComponent* BotMeshComp)
+{
+	if (Bot == nullptr || BotMeshComp == nullptr || BotMeshComp->GetStaticMesh() == nullptr || Bot->RenderInstanceIndex != INDEX_NONE)
+		return false;
+
+	int32 BatchIndex = FindOrAddBatch(BotMeshComp);
+	FCSTrackerBotInstanceBatch& Batch = Batches[BatchIndex];
+
+	//Reuse instances of removed bots, removing instances would shift the indices of all following bots
+	int32 InstanceIndex;
+	if (Batch.FreeInstances.Num() > 0)
+	{
+		InstanceIndex = Batch.FreeInstances.Pop(false);
+		Batch.Bots[InstanceIndex] = Bot;
+		Batch.Transforms[InstanceIndex] = BotMeshComp->GetComponentTransform();
+		Batch.InstanceComp->UpdateInstanceTransform(InstanceIndex, Batch.Transforms[InstanceIndex], true, false, true);
+		Batch.bRenderStateDirty = true;
+	}
+	else
+	{
+		InstanceIndex = Batch.InstanceComp->AddInstanceWorldSpace(BotMeshComp->GetComponentTransform());
+		Batch.Bots.Add(Bot);
+		Batch.Transforms.Add(BotMeshComp->GetComponentTransform());
+	}
+
+	Bot->RenderBatchIndex = BatchIndex;
+	Bot->RenderInstanceIndex = InstanceIndex;
+
+	return true;
+}
+
+void ACSTrackerBotRenderer::RemoveBot(ACSTrackerBot* Bot)
+{
+	if (Bot == nullptr || !Batches.IsValidIndex(Bot->RenderBatchIndex))
+		return;
+
+	FCSTrackerBotInstanceBatch& Batch = Batches[Bot->RenderBatchIndex];
+	int32 InstanceIndex = Bot->RenderInstanceIndex;
+
+	if (Batch.Bots.IsValidIndex(InstanceIndex) && Batch.Bots[InstanceIndex] == Bot)
+	{
+		//Collapse the instance until another bot takes it over
+		FTransform HiddenTransform = Bot->GetActorTransform();
+		HiddenTransform.SetScale3D(FVector::ZeroVector);
+		Batch.InstanceComp->UpdateInstanceTransform(InstanceIndex, HiddenTransform, true, false, true);
+		Batch.bRenderStateDirty = true;
+
+		Batch.Bots[InstanceIndex] = nullptr;
+		Batch.FreeInstances.Add(InstanceIndex);
+	}
+
+	Bot->RenderBatchIndex = INDEX_NONE;
+	Bot->RenderInstanceIndex = INDEX_NONE;
+}
+
+void ACSTrackerBotRenderer::SetCustomData(ACSTrackerBot* Bot, int32 CustomDataIndex, float Value)
+{
+#if COOP_WITH_INSTANCE_CUSTOM_DATA
+	if (Bot && Batches.IsValidIndex(Bot->RenderBatchIndex))
+	{
+		//Applied with the transforms at the end of the frame
+		FCSTrackerBotInstanceBatch& Batch = Batches[Bot->RenderBatchIndex];
+		Batch.InstanceComp->SetCustomDataValue(Bot->RenderInstanceIndex, CustomDataIndex, Value, false);
+		Batch.bRenderStateDirty = true;
+	}
+#endif
+}
+
+
+
+void ACSTrackerBotRenderer::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	for (FCSTrackerBotInstanceBatch& Batch : Batches)
+	{
+		for (int32 InstanceIndex = 0; InstanceIndex < Batch.Bots.Num(); InstanceIndex++)
+		{
+			ACSTrackerBot* Bot = Batch.Bots[InstanceIndex];
+			if (Bot == nullptr)
+				continue;
+
+			//Resting and sleeping bots leave their instance alone
+			const FTransform& BotTransform = Bot->GetActorTransform();
+			if (BotTransform.GetLocation().Equals(Batch.Transforms[InstanceIndex].GetLocation(), InstanceLocationTolerance)
+				&& BotTransform.GetRotation().Equals(Batch.Transforms[InstanceIndex].GetRotation(), InstanceRotationTolerance))
+			{
+				continue;
+			}
+
+			Batch.Transforms[InstanceIndex] = BotTransform;
+			Batch.InstanceComp->UpdateInstanceTransform(InstanceIndex, BotTransform, true, false, true);
+			Batch.bRenderStateDirty = true;
+		}
+
+		//Single render state update per mesh and only if something changed, instead of one per bot and frame
+		if (Batch.bRenderStateDirty)
+		{
+			Batch.InstanceComp->UpdateBounds();
+			Batch.InstanceComp->MarkRenderStateDirty();
+			Batch.bRenderStateDirty = false;
+		}
+	}
+}
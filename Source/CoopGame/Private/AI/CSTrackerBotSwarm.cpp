@@ -0,0 +1,416 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "AI/CSTrackerBotSwarm.h"
+#include "AI/CSTrackerBot.h"
+#include "CoopGame.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "GameFramework/PlayerController.h"
+#include "Async/ParallelFor.h"
+#include "Algo/Sort.h"
+
+
+static int32 TrackerBotSteering = 1;
+FAutoConsoleVariableRef CVARTrackerBotSteering(
+	TEXT("COOP.TrackerBotSteering"),
+	TrackerBotSteering,
+	TEXT("Add separation, alignment and avoidance steering to tracker bot movement"),
+	ECVF_Default);
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Tracker Bot Contacts Started"), STAT_TrackerBotContactsStarted, STATGROUP_Coop);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Tracker Bot Touching Pairs"), STAT_TrackerBotTouchingPairs, STATGROUP_Coop);
+DECLARE_CYCLE_STAT(TEXT("Tracker Bot Swarm Tick"), STAT_TrackerBotSwarmTick, STATGROUP_Coop);
+
+
+ACSTrackerBotSwarm::ACSTrackerBotSwarm()
+{
+	PrimaryActorTick.bCanEverTick = true;
+	//Forces have to be in before the physics step
+	PrimaryActorTick.TickGroup = TG_PrePhysics;
+
+	SetReplicates(false);
+
+	MinParallelBatchSize = 32;
+
+	//Steering
+	NeighborRadius = 250.0f;
+	SeparationWeight = 1.5f;
+	AlignmentWeight = 0.3f;
+	AlignmentFullSpeed = 600.0f;
+	AvoidanceWeight = 1.0f;
+	AvoidanceTime = 0.75f;
+	MaxSteeringForceScale = 1.5f;
+}
+
+ACSTrackerBotSwarm* ACSTrackerBotSwarm::Get(UWorld* World)
+{
+	if (World == nullptr)
+		return nullptr;
+
+	for (TActorIterator<ACSTrackerBotSwarm> It(World); It; ++It)
+	{
+		if (!It->IsPendingKill())
+			return *It;
+	}
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	return World->SpawnActor<ACSTrackerBotSwarm>(SpawnParams);
+}
+
+
+
+void ACSTrackerBotSwarm::RegisterBot(ACSTrackerBot* Bot)
+{
+	if (Bot == nullptr || Bot->SwarmIndex != INDEX_NONE)
+		return;
+
+	Bot->SwarmIndex = Bots.Add(Bot);
+
+	Locations.Add(Bot->GetActorLocation());
+	Velocities.Add(FVector::ZeroVector);
+	Radii.Add(Bot->BotRadius);
+	PathPoints.Add(Bot->NextPathPoint);
+	MovementForces.Add(Bot->MovementForce);
+	RequiredDistances.Add(Bot->RequiredDistanceToTarget);
+
+	StepAccumulators.Add(0.0f);
+	StepDeltaTimes.Add(0.0f);
+
+	DamageSelfTimeLeft.Add(-1.0f);
+	//First proximity check happens right away
+	ProximityTimeLeft.Add(0.0f);
+	RefreshPathTimeLeft.Add(-1.0f);
+
+	SteeringForces.Add(FVector::ZeroVector);
+	PathPointReached.Add(0);
+	NearestPlayerDistances.Add(FLT_MAX);
+}
+
+void ACSTrackerBotSwarm::UnregisterBot(ACSTrackerBot* Bot)
+{
+	if (Bot == nullptr || !Bots.IsValidIndex(Bot->SwarmIndex) || Bots[Bot->SwarmIndex] != Bot)
+		return;
+
+	//Slots are compacted on the next gather, so unregistering while the batch is applied is safe
+	Bots[Bot->SwarmIndex] = nullptr;
+	Bot->SwarmIndex = INDEX_NONE;
+}
+
+void ACSTrackerBotSwarm::NotifyBotContact(const ACSTrackerBot* Bot, const ACSTrackerBot* Other)
+{
+	//Touching bots raise a hit every frame, both bots of a pair get it
+	uint32 IdA = FMath::Min(Bot->GetUniqueID(), Other->GetUniqueID());
+	uint32 IdB = FMath::Max(Bot->GetUniqueID(), Other->GetUniqueID());
+	uint64 PairKey = ((uint64)IdA << 32) | IdB;
+
+	bool bAlreadyTouching = false;
+	TouchingPairs.Add(PairKey, &bAlreadyTouching);
+
+	if (!bAlreadyTouching && !PreviousTouchingPairs.Contains(PairKey))
+		INC_DWORD_STAT(STAT_TrackerBotContactsStarted);
+}
+
+void ACSTrackerBotSwarm::ScheduleRefreshPath(int32 BotIndex, float Delay)
+{
+	if (RefreshPathTimeLeft.IsValidIndex(BotIndex))
+		RefreshPathTimeLeft[BotIndex] = Delay;
+}
+
+void ACSTrackerBotSwarm::CompactBots()
+{
+	for (int32 i = Bots.Num() - 1; i >= 0; i--)
+	{
+		if (Bots[i] && !Bots[i]->IsPendingKill())
+			continue;
+
+		if (Bots[i])
+			Bots[i]->SwarmIndex = INDEX_NONE;
+
+		Bots.RemoveAtSwap(i, 1, false);
+		Locations.RemoveAtSwap(i, 1, false);
+		Velocities.RemoveAtSwap(i, 1, false);
+		Radii.RemoveAtSwap(i, 1, false);
+		PathPoints.RemoveAtSwap(i, 1, false);
+		MovementForces.RemoveAtSwap(i, 1, false);
+		RequiredDistances.RemoveAtSwap(i, 1, false);
+		StepAccumulators.RemoveAtSwap(i, 1, false);
+		StepDeltaTimes.RemoveAtSwap(i, 1, false);
+		DamageSelfTimeLeft.RemoveAtSwap(i, 1, false);
+		ProximityTimeLeft.RemoveAtSwap(i, 1, false);
+		RefreshPathTimeLeft.RemoveAtSwap(i, 1, false);
+		SteeringForces.RemoveAtSwap(i, 1, false);
+		PathPointReached.RemoveAtSwap(i, 1, false);
+		NearestPlayerDistances.RemoveAtSwap(i, 1, false);
+
+		//Fix up the index of the bot that got swapped into this slot
+		if (Bots.IsValidIndex(i) && Bots[i])
+			Bots[i]->SwarmIndex = i;
+	}
+}
+
+
+
+void ACSTrackerBotSwarm::GatherBotState(float DeltaSeconds)
+{
+	CompactBots();
+
+	for (int32 i = 0; i < Bots.Num(); i++)
+	{
+		ACSTrackerBot* Bot = Bots[i];
+
+		Locations[i] = Bot->GetActorLocation();
+		Velocities[i] = Bot->GetBotVelocity();
+		PathPoints[i] = Bot->NextPathPoint;
+
+		//Kinematic bots only step every KinematicTickInterval
+		StepAccumulators[i] += DeltaSeconds;
+		float StepInterval = Bot->bKinematicLOD ? Bot->KinematicTickInterval : 0.0f;
+
+		if (StepAccumulators[i] >= StepInterval)
+		{
+			StepDeltaTimes[i] = StepAccumulators[i];
+			StepAccumulators[i] = 0.0f;
+		}
+		else
+		{
+			StepDeltaTimes[i] = 0.0f;
+		}
+
+		//Start self destructing right away once the bot overlapped a player
+		if (Bot->bHasStartedSelfDestruction && DamageSelfTimeLeft[i] < 0.0f)
+			DamageSelfTimeLeft[i] = 0.0f;
+	}
+
+	PlayerLocations.Reset();
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		APlayerController* PC = It->Get();
+		if (PC && PC->GetPawn())
+			PlayerLocations.Add(PC->GetPawn()->GetActorLocation());
+	}
+
+	if (TrackerBotSteering > 0)
+		BuildNeighborGrid();
+}
+
+int64 ACSTrackerBotSwarm::GetCellKey(int32 CellX, int32 CellY) const
+{
+	return ((int64)CellX << 32) | (uint32)CellY;
+}
+
+void ACSTrackerBotSwarm::BuildNeighborGrid()
+{
+	CellKeys.SetNumUninitialized(Bots.Num(), false);
+	SortedBotIndices.SetNumUninitialized(Bots.Num(), false);
+
+	for (int32 i = 0; i < Bots.Num(); i++)
+	{
+		//Bots roll on the ground, a 2D grid is enough
+		CellKeys[i] = GetCellKey(FMath::FloorToInt(Locations[i].X / NeighborRadius), FMath::FloorToInt(Locations[i].Y / NeighborRadius));
+		SortedBotIndices[i] = i;
+	}
+
+	Algo::Sort(SortedBotIndices, [this](int32 A, int32 B) { return CellKeys[A] < CellKeys[B]; });
+
+	CellRanges.Reset();
+	for (int32 Start = 0; Start < SortedBotIndices.Num();)
+	{
+		int64 Key = CellKeys[SortedBotIndices[Start]];
+
+		int32 End = Start + 1;
+		while (End < SortedBotIndices.Num() && CellKeys[SortedBotIndices[End]] == Key)
+			End++;
+
+		CellRanges.Add(Key, FIntPoint(Start, End - Start));
+		Start = End;
+	}
+}
+
+FVector ACSTrackerBotSwarm::ComputeNeighborSteering(int32 BotIndex) const
+{
+	const FVector& Location = Locations[BotIndex];
+	const FVector& Velocity = Velocities[BotIndex];
+
+	FVector Separation = FVector::ZeroVector;
+	FVector Avoidance = FVector::ZeroVector;
+	FVector NeighborVelocitySum = FVector::ZeroVector;
+	int32 NumNeighbors = 0;
+
+	int32 CellX = FMath::FloorToInt(Location.X / NeighborRadius);
+	int32 CellY = FMath::FloorToInt(Location.Y / NeighborRadius);
+
+	for (int32 OffsetX = -1; OffsetX <= 1; OffsetX++)
+	{
+		for (int32 OffsetY = -1; OffsetY <= 1; OffsetY++)
+		{
+			const FIntPoint* Range = CellRanges.Find(GetCellKey(CellX + OffsetX, CellY + OffsetY));
+			if (Range == nullptr)
+				continue;
+
+			for (int32 SortedIndex = Range->X; SortedIndex < Range->X + Range->Y; SortedIndex++)
+			{
+				int32 Other = SortedBotIndices[SortedIndex];
+				if (Other == BotIndex)
+					continue;
+
+				FVector ToOther = Locations[Other] - Location;
+				ToOther.Z = 0.0f;
+
+				float DistanceSquared = ToOther.SizeSquared();
+				if (DistanceSquared > FMath::Square(NeighborRadius) || DistanceSquared < KINDA_SMALL_NUMBER)
+					continue;
+
+				float Distance = FMath::Sqrt(DistanceSquared);
+
+				//Separation, pushes harder the closer the neighbor is
+				Separation -= (ToOther / Distance) * (1.0f - Distance / NeighborRadius);
+
+				NeighborVelocitySum += Velocities[Other];
+				NumNeighbors++;
+
+				//Avoidance, steer away from neighbors we will run into within AvoidanceTime
+				FVector RelativeVelocity = Velocity - Velocities[Other];
+				RelativeVelocity.Z = 0.0f;
+
+				float RelativeSpeedSquared = RelativeVelocity.SizeSquared();
+				if (RelativeSpeedSquared > KINDA_SMALL_NUMBER && AvoidanceTime > 0.0f)
+				{
+					float TimeToClosest = (ToOther | RelativeVelocity) / RelativeSpeedSquared;
+					if (TimeToClosest > 0.0f && TimeToClosest < AvoidanceTime)
+					{
+						FVector ClosestOffset = ToOther - RelativeVelocity * TimeToClosest;
+						float ContactDistance = Radii[BotIndex] + Radii[Other];
+
+						if (ClosestOffset.SizeSquared() < FMath::Square(ContactDistance))
+							Avoidance -= ClosestOffset.GetSafeNormal() * (1.0f - TimeToClosest / AvoidanceTime);
+					}
+				}
+			}
+		}
+	}
+
+	if (NumNeighbors == 0)
+		return FVector::ZeroVector;
+
+	//Match the average heading of the neighbors, relative to a bots typical speed
+	FVector Alignment = ((NeighborVelocitySum / NumNeighbors) - Velocity) / AlignmentFullSpeed;
+	Alignment.Z = 0.0f;
+
+	return Separation * SeparationWeight + Alignment.GetClampedToMaxSize(1.0f) * AlignmentWeight + Avoidance * AvoidanceWeight;
+}
+
+void ACSTrackerBotSwarm::ComputeSteering()
+{
+	//Runs on worker threads, must not touch any UObject
+	ParallelFor(Bots.Num(), [this](int32 i)
+	{
+		if (StepDeltaTimes[i] <= 0.0f)
+			return;
+
+		FVector TargetDelta = PathPoints[i] - Locations[i];
+
+		if (TargetDelta.SizeSquared() <= FMath::Square(RequiredDistances[i]))
+		{
+			PathPointReached[i] = 1;
+			SteeringForces[i] = FVector::ZeroVector;
+		}
+		else
+		{
+			PathPointReached[i] = 0;
+
+			FVector Steering = TargetDelta.GetSafeNormal();
+			if (TrackerBotSteering > 0)
+				Steering = (Steering + ComputeNeighborSteering(i)).GetClampedToMaxSize(MaxSteeringForceScale);
+
+			SteeringForces[i] = Steering * MovementForces[i];
+		}
+
+		float NearestDistanceSquared = FLT_MAX;
+		for (const FVector& PlayerLocation : PlayerLocations)
+		{
+			NearestDistanceSquared = FMath::Min(NearestDistanceSquared, FVector::DistSquared(PlayerLocation, Locations[i]));
+		}
+
+		NearestPlayerDistances[i] = NearestDistanceSquared < FLT_MAX ? FMath::Sqrt(NearestDistanceSquared) : FLT_MAX;
+
+	}, Bots.Num() < MinParallelBatchSize);
+}
+
+void ACSTrackerBotSwarm::ApplySteering()
+{
+	float DeltaSeconds = GetWorld()->GetDeltaSeconds();
+
+	//Bots registered while applying are picked up on the next frame
+	int32 NumBots = Bots.Num();
+
+	for (int32 i = 0; i < NumBots; i++)
+	{
+		if (Bots[i] == nullptr || Bots[i]->bExploded)
+			continue;
+
+		//Damage self
+		if (DamageSelfTimeLeft[i] >= 0.0f)
+		{
+			DamageSelfTimeLeft[i] -= DeltaSeconds;
+			if (DamageSelfTimeLeft[i] <= 0.0f)
+			{
+				DamageSelfTimeLeft[i] += Bots[i]->DamageSelfInterval;
+				Bots[i]->DamageSelf();
+
+				//Bot may have exploded and unregistered
+				if (Bots[i] == nullptr || Bots[i]->bExploded)
+					continue;
+			}
+		}
+
+		//Bot proximity
+		ProximityTimeLeft[i] -= DeltaSeconds;
+		if (ProximityTimeLeft[i] <= 0.0f)
+		{
+			ProximityTimeLeft[i] += Bots[i]->ProximityCheckInterval;
+			Bots[i]->CheckProximity();
+		}
+
+		//Refresh path, only runs once per schedule
+		if (RefreshPathTimeLeft[i] >= 0.0f)
+		{
+			RefreshPathTimeLeft[i] -= DeltaSeconds;
+			if (RefreshPathTimeLeft[i] <= 0.0f)
+			{
+				RefreshPathTimeLeft[i] = -1.0f;
+				Bots[i]->RefreshPath();
+			}
+		}
+
+		if (StepDeltaTimes[i] > 0.0f)
+		{
+			Bots[i]->ApplySwarmStep(SteeringForces[i], PathPointReached[i] != 0, NearestPlayerDistances[i], StepDeltaTimes[i]);
+		}
+	}
+}
+
+
+
+void ACSTrackerBotSwarm::Tick(float DeltaSeconds)
+{
+	COOP_SCOPE_CYCLE_COUNTER(TrackerBotSwarmTick);
+
+	Super::Tick(DeltaSeconds);
+
+	//Ticks before physics, the pairs of the last step become the previous ones
+	SET_DWORD_STAT(STAT_TrackerBotTouchingPairs, TouchingPairs.Num());
+	Swap(TouchingPairs, PreviousTouchingPairs);
+	TouchingPairs.Reset();
+
+	GatherBotState(DeltaSeconds);
+
+	if (Bots.Num() == 0)
+		return;
+
+	ComputeSteering();
+
+	ApplySteering();
+}
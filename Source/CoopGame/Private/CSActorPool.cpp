@@ -0,0 +1,403 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CSActorPool.h"
+#include "CoopGame.h"
+#include "CSNetStats.h"
+#include "CSPoolableActor.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "GameFramework/ProjectileMovementComponent.h"
+
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Actor Pool Size"), STAT_ActorPoolSize, STATGROUP_Coop);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Actor Pool Hit Rate"), STAT_ActorPoolHitRate, STATGROUP_Coop);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Actor Pool Spawn Time Saved (ms)"), STAT_ActorPoolSpawnTimeSaved, STATGROUP_Coop);
+
+static int32 ActorPooling = 1;
+FAutoConsoleVariableRef CVARActorPooling(
+	TEXT("COOP.ActorPool"),
+	ActorPooling,
+	TEXT("Recycle actors implementing ICSPoolableActor. 0 spawns and destroys them like other actors"),
+	ECVF_Default);
+
+static int32 ActorPoolPrewarmPerFrame = 2;
+FAutoConsoleVariableRef CVARActorPoolPrewarmPerFrame(
+	TEXT("COOP.ActorPoolPrewarmPerFrame"),
+	ActorPoolPrewarmPerFrame,
+	TEXT("Maximum number of actors spawned into the pool per frame, spreads the spawn cost over several frames"),
+	ECVF_Default);
+
+static int32 ActorPoolMaxPerClass = 256;
+FAutoConsoleVariableRef CVARActorPoolMaxPerClass(
+	TEXT("COOP.ActorPoolMaxPerClass"),
+	ActorPoolMaxPerClass,
+	TEXT("Actors released while the pool holds this many of their class are destroyed"),
+	ECVF_Default);
+
+
+int32 FCSActorPoolEntry::GetPrewarmTarget() const
+{
+	int32 Target = 0;
+	for (const TPair<TWeakObjectPtr<const UObject>, int32>& Request : PrewarmRequests)
+	{
+		if (Request.Key.IsValid())
+			Target += Request.Value;
+	}
+
+	return Target;
+}
+
+
+
+ACSActorPool::ACSActorPool()
+{
+	PrimaryActorTick.bCanEverTick = true;
+
+	PoolSize = 0;
+	HitRate = 0.0f;
+	SpawnTimeSavedMs = 0.0f;
+}
+
+ACSActorPool* ACSActorPool::Get(UWorld* World, bool bCreateIfMissing)
+{
+	if (World == nullptr)
+		return nullptr;
+
+	//IsPooled asks for every projectile, only search the world when the cached pool belongs to another one
+	static TWeakObjectPtr<ACSActorPool> CachedPool;
+
+	ACSActorPool* Pool = CachedPool.Get();
+	if (Pool && Pool->GetWorld() == World && !Pool->IsPendingKill())
+		return Pool;
+
+	for (TActorIterator<ACSActorPool> It(World); It; ++It)
+	{
+		if (!It->IsPendingKill())
+		{
+			CachedPool = *It;
+			return *It;
+		}
+	}
+
+	if (!bCreateIfMissing || World->bIsTearingDown)
+		return nullptr;
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	Pool = World->SpawnActor<ACSActorPool>(SpawnParams);
+	CachedPool = Pool;
+
+	return Pool;
+}
+
+bool ACSActorPool::IsPooled(const AActor* Actor)
+{
+	if (Actor == nullptr)
+		return false;
+
+	ACSActorPool* Pool = Get(Actor->GetWorld(), false);
+	return Pool && Pool->PooledSet.Contains(Actor);
+}
+
+bool ACSActorPool::IsPoolable(const UClass* ActorClass)
+{
+	return ActorPooling > 0 && ActorClass && ActorClass->ImplementsInterface(UCSPoolableActor::StaticClass());
+}
+
+void ACSActorPool::ReleaseToPool(AActor* Actor)
+{
+	if (Actor == nullptr || Actor->IsPendingKill())
+		return;
+
+	ACSActorPool* Pool = IsPoolable(Actor->GetClass()) ? Get(Actor->GetWorld()) : nullptr;
+	if (Pool)
+		Pool->ReleaseActor(Actor);
+	else
+		Actor->Destroy();
+}
+
+
+
+AActor* ACSActorPool::AcquireActor(UClass* ActorClass, const FTransform& Transform, const FActorSpawnParameters& SpawnParams)
+{
+	if (ActorClass == nullptr)
+		return nullptr;
+
+	if (!IsPoolable(ActorClass))
+		return GetWorld()->SpawnActor(ActorClass, &Transform, SpawnParams);
+
+	FCSActorPoolEntry& Entry = Entries.FindOrAdd(ActorClass);
+	AActor* Actor = nullptr;
+	while (Actor == nullptr && Entry.PooledActors.Num() > 0)
+	{
+		Actor = Entry.PooledActors.Pop(false);
+		PooledSet.Remove(Actor);
+
+		if (Actor && Actor->IsPendingKill())
+			Actor = nullptr;
+	}
+
+	if (Actor)
+	{
+		Entry.NumAcquiredFromPool++;
+	}
+	else
+	{
+		//Pool ran dry, pay the spawn cost now
+		Entry.NumMissed++;
+
+		Actor = SpawnIntoPool(ActorClass, Transform);
+		if (Actor == nullptr)
+			return nullptr;
+
+		PooledSet.Remove(Actor);
+	}
+
+	ActivateActor(Actor, Transform, SpawnParams);
+	return Actor;
+}
+
+void ACSActorPool::ReleaseActor(AActor* Actor)
+{
+	if (Actor == nullptr || Actor->IsPendingKill() || PooledSet.Contains(Actor))
+		return;
+
+	UClass* ActorClass = Actor->GetClass();
+	FCSActorPoolEntry* Entry = IsPoolable(ActorClass) ? &Entries.FindOrAdd(ActorClass) : nullptr;
+
+	if (Entry == nullptr || Entry->PooledActors.Num() >= ActorPoolMaxPerClass || GetWorld()->bIsTearingDown)
+	{
+		Actor->Destroy();
+		return;
+	}
+
+	PooledSet.Add(Actor);
+	DeactivateActor(Actor);
+
+	//Blueprints may still destroy the actor when it is released
+	if (Actor->IsPendingKill())
+	{
+		PooledSet.Remove(Actor);
+		return;
+	}
+
+	Entries.FindOrAdd(ActorClass).PooledActors.Add(Actor);
+}
+
+void ACSActorPool::SetPrewarm(UClass* ActorClass, const UObject* Requester, int32 NumActors)
+{
+	if (!IsPoolable(ActorClass) || Requester == nullptr)
+		return;
+
+	FCSActorPoolEntry& Entry = Entries.FindOrAdd(ActorClass);
+	if (NumActors > 0)
+		Entry.PrewarmRequests.Add(Requester, NumActors);
+	else
+		Entry.PrewarmRequests.Remove(Requester);
+}
+
+int32 ACSActorPool::GetNumPooled(UClass* ActorClass) const
+{
+	const FCSActorPoolEntry* Entry = Entries.Find(ActorClass);
+	return Entry ? Entry->PooledActors.Num() : 0;
+}
+
+
+
+AActor* ACSActorPool::SpawnIntoPool(UClass* ActorClass, const FTransform& Transform)
+{
+	double StartTime = FPlatformTime::Seconds();
+
+	AActor* Actor = GetWorld()->SpawnActorDeferred<AActor>(ActorClass, Transform, nullptr, nullptr, ESpawnActorCollisionHandlingMethod::AlwaysSpawn);
+	if (Actor == nullptr)
+		return nullptr;
+
+	//Pooled before it begins play, so it skips whatever it only does when it enters play
+	PooledSet.Add(Actor);
+	Actor->FinishSpawning(Transform);
+
+	if (Actor->IsPendingKill())
+	{
+		PooledSet.Remove(Actor);
+		return nullptr;
+	}
+
+	DeactivateActor(Actor);
+
+	//Beginning play may have added entries
+	FCSActorPoolEntry& Entry = Entries.FindOrAdd(ActorClass);
+	Entry.NumSpawned++;
+	Entry.SpawnTimeMs += (FPlatformTime::Seconds() - StartTime) * 1000.0;
+
+	return Actor;
+}
+
+void ACSActorPool::DeactivateActor(AActor* Actor)
+{
+	ICSPoolableActor::Execute_OnReleasedToPool(Actor);
+
+	//The pool releases actors with a life span itself
+	Actor->SetLifeSpan(0.0f);
+	LifeSpanExpiries.Remove(Actor);
+
+	Actor->SetActorHiddenInGame(true);
+	Actor->SetActorEnableCollision(false);
+	Actor->SetActorTickEnabled(false);
+
+	//Clients keep dormant actors, the channel is reused when the actor is acquired again
+	if (Actor->GetIsReplicated() && Actor->HasAuthority())
+	{
+		Actor->ForceNetUpdate();
+		Actor->SetNetDormancy(DORM_DormantAll);
+	}
+}
+
+void ACSActorPool::ActivateActor(AActor* Actor, const FTransform& Transform, const FActorSpawnParameters& SpawnParams)
+{
+	const AActor* Defaults = Actor->GetClass()->GetDefaultObject<AActor>();
+
+	if (Actor->GetIsReplicated() && Actor->HasAuthority())
+	{
+		//Classes that are dormant by default replicate their new state once and stay dormant
+		if (Defaults->NetDormancy > DORM_Awake && FCSNetStats::IsDormancyEnabled())
+			Actor->FlushNetDormancy();
+		else
+			Actor->SetNetDormancy(DORM_Awake);
+	}
+
+	Actor->SetOwner(SpawnParams.Owner);
+	Actor->Instigator = SpawnParams.Instigator;
+	Actor->SetActorTransform(Transform, false, nullptr, ETeleportType::ResetPhysics);
+
+	Actor->SetActorHiddenInGame(Defaults->bHidden);
+	Actor->SetActorEnableCollision(Defaults->GetActorEnableCollision());
+	Actor->SetActorTickEnabled(Defaults->PrimaryActorTick.bStartWithTickEnabled);
+
+	RestartProjectileMovement(Actor);
+
+	if (Defaults->InitialLifeSpan > 0.0f)
+		LifeSpanExpiries.Add(Actor, GetWorld()->TimeSeconds + Defaults->InitialLifeSpan);
+
+	ICSPoolableActor::Execute_OnAcquiredFromPool(Actor);
+
+	if (Actor->GetIsReplicated() && Actor->HasAuthority())
+		Actor->ForceNetUpdate();
+}
+
+void ACSActorPool::RestartProjectileMovement(AActor* Actor)
+{
+	TArray<UProjectileMovementComponent*> ProjectileMovements;
+	Actor->GetComponents(ProjectileMovements);
+
+	for (UProjectileMovementComponent* ProjectileMovement : ProjectileMovements)
+	{
+		//Same as on spawn, the template velocity gives the direction and the initial speed the length
+		const UProjectileMovementComponent* Template = Cast<UProjectileMovementComponent>(ProjectileMovement->GetArchetype());
+		FVector InitialVelocity = Template ? Template->Velocity : FVector::ForwardVector;
+		if (ProjectileMovement->InitialSpeed > 0.0f)
+			InitialVelocity = InitialVelocity.GetSafeNormal() * ProjectileMovement->InitialSpeed;
+
+		ProjectileMovement->SetUpdatedComponent(Actor->GetRootComponent());
+
+		if (ProjectileMovement->bInitialVelocityInLocalSpace)
+			ProjectileMovement->SetVelocityInLocalSpace(InitialVelocity);
+		else
+			ProjectileMovement->Velocity = InitialVelocity;
+
+		ProjectileMovement->UpdateComponentVelocity();
+		ProjectileMovement->Activate(true);
+	}
+}
+
+
+
+void ACSActorPool::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	//Release actors whose life span ran out
+	float TimeSeconds = GetWorld()->TimeSeconds;
+	TArray<AActor*> ExpiredActors;
+
+	for (auto It = LifeSpanExpiries.CreateIterator(); It; ++It)
+	{
+		if (!It->Key.IsValid())
+			It.RemoveCurrent();
+		else if (It->Value <= TimeSeconds)
+			ExpiredActors.Add(It->Key.Get());
+	}
+
+	for (AActor* Actor : ExpiredActors)
+		ReleaseActor(Actor);
+
+	//Pre-warm a few actors per frame, spawning can add entries
+	TArray<UClass*> ActorClasses;
+	Entries.GetKeys(ActorClasses);
+
+	int32 NumPrewarmed = 0;
+	for (UClass* ActorClass : ActorClasses)
+	{
+		while (NumPrewarmed < ActorPoolPrewarmPerFrame)
+		{
+			FCSActorPoolEntry* Entry = Entries.Find(ActorClass);
+			if (Entry == nullptr || Entry->PooledActors.Num() >= FMath::Min(Entry->GetPrewarmTarget(), ActorPoolMaxPerClass))
+				break;
+
+			AActor* Actor = SpawnIntoPool(ActorClass, GetActorTransform());
+			if (Actor == nullptr)
+				break;
+
+			Entries.FindChecked(ActorClass).PooledActors.Add(Actor);
+			NumPrewarmed++;
+		}
+	}
+
+	UpdateStats();
+}
+
+void ACSActorPool::UpdateStats()
+{
+	int32 NumFromPool = 0;
+	int32 NumMissed = 0;
+	float TimeSavedMs = 0.0f;
+
+	PoolSize = 0;
+
+	for (const TPair<UClass*, FCSActorPoolEntry>& Pair : Entries)
+	{
+		const FCSActorPoolEntry& Entry = Pair.Value;
+
+		PoolSize += Entry.PooledActors.Num();
+		NumFromPool += Entry.NumAcquiredFromPool;
+		NumMissed += Entry.NumMissed;
+		TimeSavedMs += Entry.NumAcquiredFromPool * Entry.GetAverageSpawnTimeMs();
+	}
+
+	HitRate = NumFromPool + NumMissed > 0 ? (float)NumFromPool / (NumFromPool + NumMissed) : 0.0f;
+	SpawnTimeSavedMs = TimeSavedMs;
+
+	SET_DWORD_STAT(STAT_ActorPoolSize, PoolSize);
+	SET_FLOAT_STAT(STAT_ActorPoolHitRate, HitRate);
+	SET_FLOAT_STAT(STAT_ActorPoolSpawnTimeSaved, SpawnTimeSavedMs);
+}
+
+void ACSActorPool::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	for (const TPair<UClass*, FCSActorPoolEntry>& Pair : Entries)
+	{
+		const FCSActorPoolEntry& Entry = Pair.Value;
+		if (Entry.NumAcquiredFromPool + Entry.NumMissed == 0)
+			continue;
+
+		UE_LOG(LogCoop, Log, TEXT("Pool: %s acquired %d times, %d from the pool, %d spawned, %.2f ms per spawn, %.1f ms saved."),
+			*GetNameSafe(Pair.Key), Entry.NumAcquiredFromPool + Entry.NumMissed, Entry.NumAcquiredFromPool, Entry.NumSpawned,
+			Entry.GetAverageSpawnTimeMs(), Entry.NumAcquiredFromPool * Entry.GetAverageSpawnTimeMs());
+	}
+
+	PooledSet.Reset();
+	LifeSpanExpiries.Reset();
+
+	Super::EndPlay(EndPlayReason);
+}
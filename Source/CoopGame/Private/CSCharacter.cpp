@@ -3,9 +3,16 @@
 
 #include "CSCharacter.h"
 #include "CoopGame.h"
+#include "CSMatchInstance.h"
+#include "CSPlayerState.h"
 #include "CSWeapon.h"
+#include "CSActorPool.h"
+#include "CSTriggerManager.h"
+#include "CSTelemetry.h"
+#include "CSRepProfiler.h"
 #include "Components/InputComponent.h"
 #include "Components/CSHealthComponent.h"
+#include "Components/CSEffectComponent.h"
 #include "Components/SkeletalMeshComponent.h"
 #include "Components/CapsuleComponent.h"
 #include "Camera/CameraComponent.h"
@@ -24,6 +31,8 @@ ACSCharacter::ACSCharacter()
 
 	HealthComp = CreateDefaultSubobject<UCSHealthComponent>(TEXT("InHealthComp"));
 
+	EffectComp = CreateDefaultSubobject<UCSEffectComponent>(TEXT("EffectComp"));
+
 	GetMovementComponent()->GetNavAgentPropertiesRef().bCanCrouch = true;
 
 	GetCapsuleComponent()->SetCollisionResponseToChannel(COLLISION_WEAPON, ECR_Ignore);
@@ -61,6 +70,35 @@ FVector ACSCharacter::GetPawnViewLocation() const
 	return Super::GetPawnViewLocation();
 }
 
+bool ACSCharacter::IsNetRelevantFor(const AActor* RealViewer, const AActor* ViewTarget, const FVector& SrcLocation) const
+{
+	if (!ACSMatchInstance::IsSameMatch(this, RealViewer))
+		return false;
+
+	return Super::IsNetRelevantFor(RealViewer, ViewTarget, SrcLocation);
+}
+
+void ACSCharacter::PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker)
+{
+	Super::PreReplication(ChangedPropertyTracker);
+
+	FCSRepProfiler::NotifyPreReplication(this);
+}
+
+void ACSCharacter::PostNetReceive()
+{
+	Super::PostNetReceive();
+
+	FCSRepProfiler::NotifyPostNetReceive(this);
+}
+
+bool ACSCharacter::CallRemoteFunction(UFunction* Function, void* Parameters, FOutParmRec* OutParms, FFrame* Stack)
+{
+	FCSRepProfiler::NotifyRemoteFunction(this, Function, Parameters);
+
+	return Super::CallRemoteFunction(Function, Parameters, OutParms, Stack);
+}
+
 // Called when the game starts or when spawned
 void ACSCharacter::BeginPlay()
 {
@@ -71,17 +109,26 @@ void ACSCharacter::BeginPlay()
 
 	//Events
 	HealthComp->OnDeath.AddDynamic(this, &ACSCharacter::OnDeathEvent);
+	EffectComp->OnStatsChanged.AddDynamic(this, &ACSCharacter::OnEffectStatsChanged);
 
 	FOV_Default = CameraComp->FieldOfView;
 
+	//Sets off pickups and tracker bots
+	ACSTriggerManager* TriggerManager = ACSTriggerManager::Get(GetWorld());
+	if (TriggerManager)
+		TriggerManager->AddOccupant(this);
 
 	if (Role == ROLE_Authority)
 	{
+		FCSTelemetry::Record(ECSTelemetryEvent::Spawn, this);
+
 		//Spawn default weapon
 		FActorSpawnParameters SpawnParams;
 		SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+		//The replication graph ties the weapon to its owner when the weapon is spawned
+		SpawnParams.Owner = this;
 
-		CurrentWeapon = GetWorld()->SpawnActor<ACSWeapon>(DefaultWeaponClass, FVector::ZeroVector, FRotator::ZeroRotator, SpawnParams);
+		CurrentWeapon = ACSActorPool::SpawnPooledActor<ACSWeapon>(GetWorld(), DefaultWeaponClass, FTransform::Identity, SpawnParams);
 		if (CurrentWeapon)
 		{
 			CurrentWeapon->SetOwner(this);
@@ -92,6 +139,26 @@ void ACSCharacter::BeginPlay()
 	}
 }
 
+void ACSCharacter::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	ACSTriggerManager* TriggerManager = ACSTriggerManager::Get(GetWorld(), false);
+	if (TriggerManager)
+		TriggerManager->RemoveOccupant(this);
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void ACSCharacter::Destroyed()
+{
+	if (Role == ROLE_Authority && CurrentWeapon)
+	{
+		ACSActorPool::ReleaseToPool(CurrentWeapon);
+		CurrentWeapon = nullptr;
+	}
+
+	Super::Destroyed();
+}
+
 
 //Movement Methods
 #pragma region Movement Methods
@@ -113,15 +180,13 @@ void ACSCharacter::EndCrouch()
 void ACSCharacter::BeginSprint()
 {
 	bIsSprinting = true;
-	MaxSpeed = SprintSpeed * SpeedMultiplier;
-	GetCharacterMovement()->MaxWalkSpeed = MaxSpeed;
+	UpdateMaxSpeed();
 }
 
 void ACSCharacter::EndSprint()
 {
 	bIsSprinting = false;
-	MaxSpeed = WalkSpeed * SpeedMultiplier;
-	GetCharacterMovement()->MaxWalkSpeed = MaxSpeed;
+	UpdateMaxSpeed();
 }
 
 
@@ -136,10 +201,23 @@ void ACSCharacter::SetSpeedMultiplier(float multiplier)
 	//Will replicate to clients
 	SpeedMultiplier = multiplier;
 	
-	MaxSpeed = bIsSprinting ? SprintSpeed * SpeedMultiplier : WalkSpeed * SpeedMultiplier;
+	UpdateMaxSpeed();
+}
+
+void ACSCharacter::UpdateMaxSpeed()
+{
+	float Multiplier = SpeedMultiplier * EffectComp->GetStatMultiplier(ECSEffectStat::MoveSpeed);
+
+	MaxSpeed = bIsSprinting ? SprintSpeed * Multiplier : WalkSpeed * Multiplier;
 	GetCharacterMovement()->MaxWalkSpeed = MaxSpeed;
 }
 
+void ACSCharacter::OnEffectStatsChanged(UCSEffectComponent* EffectComponent)
+{
+	//Weapons read their damage effects when they fire
+	UpdateMaxSpeed();
+}
+
 #pragma endregion Movement Methods
 
 
@@ -251,6 +329,10 @@ void ACSCharacter::OnDeathEvent(UCSHealthComponent* HealthComponent, float Healt
 		GetMovementComponent()->StopMovementImmediately();
 		GetCapsuleComponent()->SetCollisionEnabled(ECollisionEnabled::NoCollision);
 
+		ACSTriggerManager* TriggerManager = ACSTriggerManager::Get(GetWorld(), false);
+		if (TriggerManager)
+			TriggerManager->RemoveOccupant(this);
+
 		DetachFromControllerPendingDestroy();
 
 		SetLifeSpan(10.0f);
@@ -259,6 +341,7 @@ void ACSCharacter::OnDeathEvent(UCSHealthComponent* HealthComponent, float Healt
 
 void ACSCharacter::OnRep_MaxSpeed()
 {
+	COOP_REP_READ(MaxSpeed);
 	GetCharacterMovement()->MaxWalkSpeed = MaxSpeed;
 }
 
@@ -277,11 +360,23 @@ void ACSCharacter::Tick(float DeltaTime)
 {
 	Super::Tick(DeltaTime);
 
+#if COOP_WITH_COSMETICS
+	COOP_REP_READ(bIsAiming);
 	float TargetFOV = bIsAiming ? FOV_Aim : FOV_Default;
 
 	float NewFOV = FMath::FInterpTo(CameraComp->FieldOfView, TargetFOV, DeltaTime, AimInterpSpeed);
 
 	CameraComp->SetFieldOfView(NewFOV);
+#endif
+
+	//A joining client can play once it has its pawn, its weapon and the game state
+	COOP_REP_READ(CurrentWeapon);
+	if (Role == ROLE_AutonomousProxy && CurrentWeapon && GetWorld()->GetGameState())
+	{
+		ACSPlayerState* PS = Cast<ACSPlayerState>(PlayerState);
+		if (PS)
+			PS->ReportPlayable();
+	}
 }
 
 // Called to bind functionality to input
@@ -2,11 +2,15 @@
 
 
 #include "CSExplosiveActor.h"
+#include "CoopGame.h"
+#include "CSNetStats.h"
+#include "CSRepProfiler.h"
 #include "Components/CSHealthComponent.h"
 #include "Components/StaticMeshComponent.h"
 #include "PhysicsEngine/RadialForceComponent.h"
 #include "Kismet/GameplayStatics.h"
 #include "DrawDebugHelpers.h"
+#include "CSGameplayScheduler.h"
 
 static int32 DebugExplosiveActorDrawing = 0;
 FAutoConsoleVariableRef CVARDebugExplosiveActorDrawing(
@@ -15,6 +19,8 @@ FAutoConsoleVariableRef CVARDebugExplosiveActorDrawing(
 	TEXT("Draw debug lines for explosive actors"),
 	ECVF_Cheat);
 
+DECLARE_CYCLE_STAT(TEXT("Explosive Actor Explode"), STAT_ExplosiveActorExplode, STATGROUP_Coop);
+
 
 
 // Sets default values
@@ -27,6 +33,7 @@ ACSExplosiveActor::ACSExplosiveActor()
 
 	HealthComp = CreateDefaultSubobject<UCSHealthComponent>(TEXT("HealthComp"));
 
+	HealthComp->OnHealthChanged.AddDynamic(this, &ACSExplosiveActor::OnHealthChanged);
 	HealthComp->OnDeath.AddDynamic(this, &ACSExplosiveActor::OnDeath);
 
 	RadForceComp = CreateDefaultSubobject<URadialForceComponent>(TEXT("RadForceComp"));
@@ -36,18 +43,92 @@ ACSExplosiveActor::ACSExplosiveActor()
 	RadForceComp->SetupAttachment(MeshComp);
 
 	ExplosionScale = FVector::OneVector;
+	bHasExploded = false;
+
+	//Barrels only replicate while they are hit and pushed around
+	NetDormancy = DORM_Initial;
+	DormancyDelay = 3.0f;
+}
+
+void ACSExplosiveActor::BeginPlay()
+{
+	Super::BeginPlay();
+
+	InitialTransform = GetActorTransform();
+
+	if (Role == ROLE_Authority && !FCSNetStats::IsDormancyEnabled())
+		SetNetDormancy(DORM_Awake);
+}
+
+void ACSExplosiveActor::WakeForReplication()
+{
+	if (Role != ROLE_Authority || !FCSNetStats::IsDormancyEnabled())
+		return;
+
+	SetNetDormancy(DORM_Awake);
+	ACSGameplayScheduler::Get(GetWorld())->SetTimer(TimerHandle_Dormancy, this, &ACSExplosiveActor::GoDormant, DormancyDelay);
+}
+
+void ACSExplosiveActor::GoDormant()
+{
+	//Keep replicating while the physics body is still moving
+	if (MeshComp->IsSimulatingPhysics() && MeshComp->IsAnyRigidBodyAwake())
+	{
+		ACSGameplayScheduler::Get(GetWorld())->SetTimer(TimerHandle_Dormancy, this, &ACSExplosiveActor::GoDormant, DormancyDelay);
+		return;
+	}
+
+	SetNetDormancy(DORM_DormantAll);
+}
+
+void ACSExplosiveActor::Reset()
+{
+	Super::Reset();
+
+	WakeForReplication();
+
+	HealthComp->ResetHealth();
+	bHasExploded = false;
+
+	SetActorTransform(InitialTransform, false, nullptr, ETeleportType::ResetPhysics);
+	if (MeshComp->IsSimulatingPhysics())
+	{
+		MeshComp->SetPhysicsLinearVelocity(FVector::ZeroVector);
+		MeshComp->SetPhysicsAngularVelocityInRadians(FVector::ZeroVector);
+	}
+}
+
+void ACSExplosiveActor::PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker)
+{
+	Super::PreReplication(ChangedPropertyTracker);
+
+	FCSNetStats::NotifyConsidered(this);
+	FCSRepProfiler::NotifyPreReplication(this);
+}
+
+void ACSExplosiveActor::OnHealthChanged(UCSHealthComponent* InHealthComp, float Health, float HealthDelta, const class UDamageType* DamageType, class AController* InstigatedBy, AActor* DamageCauser)
+{
+	WakeForReplication();
 }
 
 void ACSExplosiveActor::OnDeath(UCSHealthComponent* InHealthComp, float HealthDelta, const class UDamageType* DamageType, class AController* InstigatedBy, AActor* DamageCauser)
 {
+	COOP_SCOPE_CYCLE_COUNTER(ExplosiveActorExplode);
+
+	WakeForReplication();
+
 	//Explode
+#if COOP_WITH_COSMETICS
 	if (ExplosionEffect)
 	{
-		UE_LOG(LogTemp, Log, TEXT("Spawned Explosion Effect!"));
+		UE_LOG(LogCoop, Verbose, TEXT("Spawned Explosion Effect!"));
 		UGameplayStatics::SpawnEmitterAtLocation(GetWorld(), ExplosionEffect, GetActorLocation(), FRotator::ZeroRotator, ExplosionScale);
+		COOP_INC_COUNTER(SpawnedEffects);
 	}
+#endif
 
-	DrawDebugSphere(GetWorld(), GetActorLocation(), RadForceComp->Radius, 16, FColor::Red, false, 3.0f);
+	if (DebugExplosiveActorDrawing > 0)
+		DrawDebugSphere(GetWorld(), GetActorLocation(), RadForceComp->Radius, 16, FColor::Red, false, 3.0f);
 	RadForceComp->FireImpulse();
 
 	//Apply damage on server
@@ -0,0 +1,163 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CSFrameScratch.h"
+#include "CoopGame.h"
+#include "HAL/MemoryBase.h"
+#include "HAL/ThreadSafeCounter64.h"
+#include "Misc/CoreDelegates.h"
+#include "Misc/CommandLine.h"
+#include "Misc/Parse.h"
+
+
+DECLARE_MEMORY_STAT(TEXT("Frame Scratch Bytes"), STAT_FrameScratchBytes, STATGROUP_Coop);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Game Thread Heap Allocs"), STAT_GameThreadHeapAllocs, STATGROUP_Coop);
+
+
+#if COOP_WITH_ALLOC_COUNTERS
+
+// Counts the allocations of the game thread and hands everything to the allocator it wraps, like the engine's malloc proxies
+class FCSMallocCounter : public FMalloc
+{
+public:
+
+	explicit FCSMallocCounter(FMalloc* InMalloc) : UsedMalloc(InMalloc) { }
+
+	FThreadSafeCounter64 GameThreadAllocs;
+
+	virtual void* Malloc(SIZE_T Count, uint32 Alignment) override
+	{
+		if (IsInGameThread())
+			GameThreadAllocs.Increment();
+
+		return UsedMalloc->Malloc(Count, Alignment);
+	}
+
+	virtual void* Realloc(void* Original, SIZE_T Count, uint32 Alignment) override
+	{
+		//Growing or allocating anew, shrinking to 0 frees
+		if (Count > 0 && IsInGameThread())
+			GameThreadAllocs.Increment();
+
+		return UsedMalloc->Realloc(Original, Count, Alignment);
+	}
+
+	virtual void Free(void* Original) override { UsedMalloc->Free(Original); }
+
+	virtual SIZE_T QuantizeSize(SIZE_T Count, uint32 Alignment) override { return UsedMalloc->QuantizeSize(Count, Alignment); }
+
+	virtual bool GetAllocationSize(void* Original, SIZE_T& SizeOut) override { return UsedMalloc->GetAllocationSize(Original, SizeOut); }
+
+	virtual void Trim() override { UsedMalloc->Trim(); }
+
+	virtual void SetupTLSCachesOnCurrentThread() override { UsedMalloc->SetupTLSCachesOnCurrentThread(); }
+
+	virtual void ClearAndDisableTLSCachesOnCurrentThread() override { UsedMalloc->ClearAndDisableTLSCachesOnCurrentThread(); }
+
+	virtual void InitializeStatsMetadata() override { UsedMalloc->InitializeStatsMetadata(); }
+
+	virtual void UpdateStats() override { UsedMalloc->UpdateStats(); }
+
+	virtual void GetAllocatorStats(FGenericMemoryStats& OutStats) override { UsedMalloc->GetAllocatorStats(OutStats); }
+
+	virtual void DumpAllocatorStats(FOutputDevice& Ar) override { UsedMalloc->DumpAllocatorStats(Ar); }
+
+	virtual bool IsInternallyThreadSafe() const override { return UsedMalloc->IsInternallyThreadSafe(); }
+
+	virtual bool ValidateHeap() override { return UsedMalloc->ValidateHeap(); }
+
+	virtual bool Exec(UWorld* InWorld, const TCHAR* Cmd, FOutputDevice& Ar) override { return UsedMalloc->Exec(InWorld, Cmd, Ar); }
+
+	virtual const TCHAR* GetDescriptiveName() override { return UsedMalloc->GetDescriptiveName(); }
+
+private:
+
+	FMalloc* UsedMalloc;
+};
+
+//Never deleted, memory allocated through it can be freed at any time until exit
+static FCSMallocCounter* MallocCounter = nullptr;
+
+#endif
+
+
+static FMemStackBase* FrameScratch = nullptr;
+
+static FDelegateHandle EndFrameHandle;
+
+static int32 LastFrameHeapAllocs = -1;
+
+static int64 FrameStartHeapAllocs = 0;
+
+
+void FCSFrameScratch::Startup()
+{
+	//No marks needed, the whole stack is flushed at the end of the frame
+	if (FrameScratch == nullptr)
+		FrameScratch = new FMemStackBase(0);
+
+	EndFrameHandle = FCoreDelegates::OnEndFrame.AddStatic(&FCSFrameScratch::OnEndFrame);
+
+#if COOP_WITH_ALLOC_COUNTERS
+	const TCHAR* CommandLine = FCommandLine::Get();
+	if (MallocCounter == nullptr && (FParse::Param(CommandLine, TEXT("CountAllocs")) || FParse::Param(CommandLine, TEXT("Soak"))))
+	{
+		MallocCounter = new FCSMallocCounter(GMalloc);
+		GMalloc = MallocCounter;
+
+		UE_LOG(LogCoop, Log, TEXT("Counting game thread heap allocations."));
+	}
+#endif
+}
+
+void FCSFrameScratch::Shutdown()
+{
+	FCoreDelegates::OnEndFrame.Remove(EndFrameHandle);
+
+	if (FrameScratch)
+	{
+		FrameScratch->Flush();
+		delete FrameScratch;
+		FrameScratch = nullptr;
+	}
+}
+
+FMemStackBase& FCSFrameScratch::Get()
+{
+	check(IsInGameThread() && FrameScratch);
+
+	return *FrameScratch;
+}
+
+int32 FCSFrameScratch::GetLastFrameHeapAllocs()
+{
+	return LastFrameHeapAllocs;
+}
+
+int64 FCSFrameScratch::GetTotalHeapAllocs()
+{
+#if COOP_WITH_ALLOC_COUNTERS
+	if (MallocCounter)
+		return MallocCounter->GameThreadAllocs.GetValue();
+#endif
+
+	return -1;
+}
+
+void FCSFrameScratch::OnEndFrame()
+{
+	if (FrameScratch)
+	{
+		SET_MEMORY_STAT(STAT_FrameScratchBytes, FrameScratch->GetByteCount());
+		FrameScratch->Flush();
+	}
+
+	int64 TotalHeapAllocs = GetTotalHeapAllocs();
+	if (TotalHeapAllocs >= 0)
+	{
+		LastFrameHeapAllocs = (int32)(TotalHeapAllocs - FrameStartHeapAllocs);
+		FrameStartHeapAllocs = TotalHeapAllocs;
+
+		SET_DWORD_STAT(STAT_GameThreadHeapAllocs, LastFrameHeapAllocs);
+	}
+}
@@ -2,21 +2,33 @@
 
 
 #include "CSGameMode.h"
+#include "CoopGame.h"
 #include "CSGameState.h"
 #include "CSPlayerState.h"
-#include "TimerManager.h"
+#include "CSMatchInstance.h"
 #include "Engine/World.h"
-#include "Components/CSHealthComponent.h"
+#include "EngineUtils.h"
+#include "Components/CSSoakTestComponent.h"
+#include "GameFramework/PlayerStart.h"
 #include "Kismet/GameplayStatics.h"
+#include "Misc/CommandLine.h"
 
 
 ACSGameMode::ACSGameMode()
 {
 	GameStateClass = ACSGameState::StaticClass();
 	PlayerStateClass = ACSPlayerState::StaticClass();
-	
+	MatchInstanceClass = ACSMatchInstance::StaticClass();
+
+	SoakTestComp = CreateDefaultSubobject<UCSSoakTestComponent>(TEXT("SoakTestComp"));
+
 	WaveInterval = 2.0f;
 	BotSpawnInterval = 0.2f;
+	GameOverResetDelay = 5.0f;
+
+	MaxMatches = 1;
+	MaxPlayersPerMatch = 4;
+	ArenaTagPrefix = "Arena";
 
 	PrimaryActorTick.bCanEverTick = true;
 	PrimaryActorTick.TickInterval = 1.0f;
@@ -24,144 +36,143 @@ ACSGameMode::ACSGameMode()
 
 
 
-void ACSGameMode::StartWave()
-{
-	WaveCount++;
-	NumOfBotsToSpawn = 2 * WaveCount;
-
-	UE_LOG(LogTemp, Log, TEXT("Game: Wave %d started!"), WaveCount);
-	GetWorldTimerManager().SetTimer(TimerHandle_BotSpawner, this, &ACSGameMode::SpawnBotTimerElapsed, BotSpawnInterval, true);
-
-	SetWaveState(EWaveState::WaveInProgress);
-}
-
-
-void ACSGameMode::SpawnBotTimerElapsed()
+void ACSGameMode::InitGame(const FString& MapName, const FString& Options, FString& ErrorMessage)
 {
-	SpawnNewBot();
+	Super::InitGame(MapName, Options, ErrorMessage);
 
-	NumOfBotsToSpawn--;
+	FParse::Value(FCommandLine::Get(), TEXT("Matches="), MaxMatches);
+	MaxMatches = FMath::Max(MaxMatches, 1);
 
-	if (NumOfBotsToSpawn <= 0)
+	//Soak reports cover the first match but sample the bandwidth of every connection, all stand-ins and clients have to play in it
+	if (FParse::Param(FCommandLine::Get(), TEXT("Soak")) && MaxMatches > 1)
 	{
-		EndWave();
+		UE_LOG(LogCoop, Log, TEXT("Game: Soak test runs a single match instead of %d."), MaxMatches);
+		MaxMatches = 1;
 	}
 }
 
 
-void ACSGameMode::EndWave()
+ACSMatchInstance* ACSGameMode::GetOrCreateMatch(int32 MatchId)
 {
-	UE_LOG(LogTemp, Log, TEXT("Game: Wave %d has ended!"), WaveCount);
-	GetWorldTimerManager().ClearTimer(TimerHandle_BotSpawner);
+	if (Matches.IsValidIndex(MatchId) && Matches[MatchId])
+		return Matches[MatchId];
 
-	SetWaveState(EWaveState::WaitingToComplete);
-}
+	if (MatchId < 0 || MatchId >= MaxMatches)
+		return nullptr;
 
+	//A single match plays on the whole map, several matches each need their own arena
+	FName ArenaTag = MaxMatches > 1 ? FName(*FString::Printf(TEXT("%s%d"), *ArenaTagPrefix.ToString(), MatchId)) : NAME_None;
 
-void ACSGameMode::PrepareForNextWave()
-{
-	RestartDeadPlayers();
+	//Deferred so the spawn director knows its arena when it builds its spawn candidates
+	ACSMatchInstance* Match = GetWorld()->SpawnActorDeferred<ACSMatchInstance>(MatchInstanceClass, FTransform::Identity, this);
+	if (Match == nullptr)
+		return nullptr;
 
-	UE_LOG(LogTemp, Log, TEXT("Game: Preparing for next wave!"));
-	GetWorldTimerManager().SetTimer(TimerHandle_NextWaveStart, this, &ACSGameMode::StartWave, WaveInterval, false);
+	Match->InitMatch(MatchId, ArenaTag);
+	Match->FinishSpawning(FTransform::Identity);
 
-	SetWaveState(EWaveState::WaitingToStart);
-}
+	if (Matches.Num() <= MatchId)
+		Matches.SetNum(MatchId + 1);
 
+	Matches[MatchId] = Match;
 
+	UE_LOG(LogCoop, Log, TEXT("Game: Match %d opened, %d of %d matches running."), MatchId, GetNumMatches(), MaxMatches);
 
-void ACSGameMode::CheckWaveState()
+	return Match;
+}
+
+ACSMatchInstance* ACSGameMode::AssignPlayerToMatch(AController* Player)
 {
-	bool bIsPreparingForNextWave = GetWorldTimerManager().IsTimerActive(TimerHandle_NextWaveStart);
-	
-	if (NumOfBotsToSpawn > 0 || bIsPreparingForNextWave)
-		return;
+	ACSPlayerState* PS = Player ? Cast<ACSPlayerState>(Player->PlayerState) : nullptr;
+	if (PS == nullptr)
+		return nullptr;
 
+	if (ACSMatchInstance* CurrentMatch = GetMatchForController(Player))
+		return CurrentMatch;
 
-	bool bIsAnyBotAlive = false;
+	//Fill the running matches first so a server with few players runs few matches
+	ACSMatchInstance* BestMatch = nullptr;
+	int32 BestNumPlayers = MAX_int32;
 
-	for (FConstPawnIterator It = GetWorld()->GetPawnIterator(); It; ++It)
+	for (ACSMatchInstance* Match : Matches)
 	{
-		APawn* TestPawn = It->Get();
-
-		if (TestPawn == nullptr || TestPawn->IsPlayerControlled())
+		if (Match == nullptr)
 			continue;
 
-		UCSHealthComponent* HealthComp = Cast<UCSHealthComponent>(TestPawn->GetComponentByClass(UCSHealthComponent::StaticClass()));
-		if (HealthComp && HealthComp->GetHealth() > 0.0f)
+		int32 NumPlayers = Match->GetNumPlayers();
+		if (NumPlayers < MaxPlayersPerMatch)
 		{
-			bIsAnyBotAlive = true;
+			BestMatch = Match;
 			break;
 		}
+
+		if (NumPlayers < BestNumPlayers)
+		{
+			BestMatch = Match;
+			BestNumPlayers = NumPlayers;
+		}
 	}
 
-	if (!bIsAnyBotAlive)
+	//All matches are full, open a new one or overfill the emptiest one
+	if (BestMatch == nullptr || BestMatch->GetNumPlayers() >= MaxPlayersPerMatch)
 	{
-		SetWaveState(EWaveState::WaveComplete);
-		PrepareForNextWave();
+		if (ACSMatchInstance* NewMatch = GetOrCreateMatch(Matches.Num()))
+			BestMatch = NewMatch;
 	}
-}
 
-void ACSGameMode::CheckAnyPlayerAlive()
-{
-	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	if (BestMatch)
 	{
-		APlayerController* PC = It->Get();
-		if (PC && PC->GetPawn())
-		{
-			APawn* MyPawn = PC->GetPawn();
-			UCSHealthComponent* HealthComp = Cast<UCSHealthComponent>(MyPawn->GetComponentByClass(UCSHealthComponent::StaticClass()));
-			
-			//Ensure that the player pawn has a Health Component or cause a break in the code
-			if (ensure(HealthComp))
-			{
-				return;
-			}
-		}
+		PS->SetMatchId(BestMatch->GetMatchId());
+		UE_LOG(LogCoop, Log, TEXT("Game: %s joined match %d."), *PS->GetPlayerName(), BestMatch->GetMatchId());
 	}
 
-	//No player alive
-	GameOver();
+	return BestMatch;
 }
 
-
-
-
-void ACSGameMode::GameOver()
+ACSMatchInstance* ACSGameMode::GetMatchForController(AController* Controller) const
 {
-	EndWave();
-	UGameplayStatics::OpenLevel(this, FName(*GetWorld()->GetName()), false);
-	// @TODO: Finish up the match, present 'Game Over' to the players.
+	ACSPlayerState* PS = Controller ? Cast<ACSPlayerState>(Controller->PlayerState) : nullptr;
+	if (PS && Matches.IsValidIndex(PS->GetMatchId()))
+		return Matches[PS->GetMatchId()];
 
-	UE_LOG(LogTemp, Log, TEXT("GAME OVER! Players Died!"));
-	SetWaveState(EWaveState::GameOver);
+	return nullptr;
 }
 
 
-void ACSGameMode::SetWaveState(EWaveState NewState)
-{
-	ACSGameState* GS = GetGameState<ACSGameState>();
-	if (ensureAlways(GS))
-	{
-		GS->SetWaveState(NewState);
-	}
-}
 
+void ACSGameMode::PostLogin(APlayerController* NewPlayer)
+{
+	//Before Super, it restarts the player at a start of its arena
+	AssignPlayerToMatch(NewPlayer);
 
+	ACSPlayerState* PS = Cast<ACSPlayerState>(NewPlayer->PlayerState);
+	if (PS)
+		PS->NotifyLoggedIn();
 
+	Super::PostLogin(NewPlayer);
+}
 
-void ACSGameMode::RestartDeadPlayers()
+AActor* ACSGameMode::ChoosePlayerStart_Implementation(AController* Player)
 {
-	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	ACSMatchInstance* Match = AssignPlayerToMatch(Player);
+
+	if (Match && Match->GetArenaTag() != NAME_None)
 	{
-		APlayerController* PC = It->Get();
-		if (PC && PC->GetPawn() == nullptr)
+		TArray<APlayerStart*> ArenaStarts;
+		for (TActorIterator<APlayerStart> It(GetWorld()); It; ++It)
 		{
-			RestartPlayer(PC);
+			if (It->PlayerStartTag == Match->GetArenaTag())
+				ArenaStarts.Add(*It);
 		}
+
+		if (ArenaStarts.Num() > 0)
+			return ArenaStarts[FMath::RandHelper(ArenaStarts.Num())];
+
+		UE_LOG(LogCoop, Warning, TEXT("Game: No player start tagged %s, match %d spawns anywhere."), *Match->GetArenaTag().ToString(), Match->GetMatchId());
 	}
-}
 
+	return Super::ChoosePlayerStart_Implementation(Player);
+}
 
 
 
@@ -169,14 +180,18 @@ void ACSGameMode::StartPlay()
 {
 	Super::StartPlay();
 
-	PrepareForNextWave();
+	GetOrCreateMatch(0);
+
+	SoakTestComp->SpawnStandInPlayers();
 }
 
 void ACSGameMode::Tick(float DeltaSeconds)
 {
 	Super::Tick(DeltaSeconds);
 
-	CheckWaveState();
-	CheckAnyPlayerAlive();
+	for (ACSMatchInstance* Match : Matches)
+	{
+		if (Match)
+			Match->UpdateMatch();
+	}
 }
-
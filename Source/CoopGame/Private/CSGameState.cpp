@@ -2,30 +2,40 @@
 
 
 #include "CSGameState.h"
-#include "Net/UnrealNetwork.h"
+#include "CSRepProfiler.h"
 
-void ACSGameState::OnRep_WaveState(EWaveState OldState)
+ACSGameState::ACSGameState()
 {
-	WaveStateChanged(WaveState, OldState);
+	//Joining clients can't begin play before the game state arrived, send it ahead of pawns and player controllers
+	NetPriority = 4.0f;
 }
 
 void ACSGameState::SetWaveState(EWaveState NewState)
 {
-	if (Role == ROLE_Authority)
-	{
-		EWaveState OldState = WaveState;
-
-		WaveState = NewState;
-		//Call on server
-		OnRep_WaveState(OldState);
-	}
+	//Local mirror, called on server and clients by the match instance of the local player
+	EWaveState OldState = WaveState;
+
+	WaveState = NewState;
+	WaveStateChanged(WaveState, OldState);
+}
+
+void ACSGameState::Reset()
+{
+	Super::Reset();
+
+	SetWaveState(EWaveState::WaitingToStart);
 }
 
+void ACSGameState::PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker)
+{
+	Super::PreReplication(ChangedPropertyTracker);
 
+	FCSRepProfiler::NotifyPreReplication(this);
+}
 
-void ACSGameState::GetLifetimeReplicatedProps(TArray< FLifetimeProperty > & OutLifetimeProps) const
+void ACSGameState::PostNetReceive()
 {
-	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+	Super::PostNetReceive();
 
-	DOREPLIFETIME(ACSGameState, WaveState);
-}
\ No newline at end of file
+	FCSRepProfiler::NotifyPostNetReceive(this);
+}
@@ -0,0 +1,123 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CSGameplayScheduler.h"
+#include "CoopGame.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+
+
+DECLARE_CYCLE_STAT(TEXT("Scheduler Tick"), STAT_SchedulerTick, STATGROUP_Coop);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Scheduler Timers"), STAT_SchedulerTimers, STATGROUP_Coop);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Scheduler Timers Fired"), STAT_SchedulerTimersFired, STATGROUP_Coop);
+
+static float SchedulerResolution = 1.0f / 120.0f;
+FAutoConsoleVariableRef CVARSchedulerResolution(
+	TEXT("COOP.SchedulerResolution"),
+	SchedulerResolution,
+	TEXT("Seconds per tick of the gameplay scheduler, timers fire on the first tick after they are due. Applies to schedulers created afterwards"),
+	ECVF_Default);
+
+
+ACSGameplayScheduler::ACSGameplayScheduler()
+	: Wheel(SchedulerResolution)
+{
+	PrimaryActorTick.bCanEverTick = true;
+	//Where the world ticks its timer manager
+	PrimaryActorTick.TickGroup = TG_PostPhysics;
+}
+
+ACSGameplayScheduler* ACSGameplayScheduler::Get(UWorld* World, bool bCreateIfMissing)
+{
+	if (World == nullptr)
+		return nullptr;
+
+	//Gameplay code asks for the scheduler whenever it sets a timer, remember the last one found
+	static TWeakObjectPtr<ACSGameplayScheduler> CachedScheduler;
+
+	ACSGameplayScheduler* Scheduler = CachedScheduler.Get();
+	if (Scheduler && Scheduler->GetWorld() == World && !Scheduler->IsPendingKill())
+		return Scheduler;
+
+	for (TActorIterator<ACSGameplayScheduler> It(World); It; ++It)
+	{
+		if (!It->IsPendingKill())
+		{
+			CachedScheduler = *It;
+			return *It;
+		}
+	}
+
+	if (!bCreateIfMissing || World->bIsTearingDown)
+		return nullptr;
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	Scheduler = World->SpawnActor<ACSGameplayScheduler>(SpawnParams);
+	CachedScheduler = Scheduler;
+
+	return Scheduler;
+}
+
+void ACSGameplayScheduler::BeginPlay()
+{
+	Super::BeginPlay();
+
+	//Timers set before begin play were set from the same time
+	if (Wheel.GetNumTimers() == 0)
+		Wheel.Reset(GetWorld()->GetTimeSeconds());
+}
+
+void ACSGameplayScheduler::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	Wheel.Reset(0.0);
+
+	Super::EndPlay(EndPlayReason);
+}
+
+
+
+void ACSGameplayScheduler::SetTimer(FCSTimerHandle& InOutHandle, const UObject* Owner, const FTimerDelegate& Delegate, float Rate, bool bLoop, float FirstDelay)
+{
+	//Clear the timers of actors when they end play, like the timer manager does
+	const AActor* OwnerActor = Cast<AActor>(Owner);
+	if (OwnerActor && Rate > 0.0f && !Wheel.HasTimersForOwner(Owner))
+		const_cast<AActor*>(OwnerActor)->OnEndPlay.AddUniqueDynamic(this, &ACSGameplayScheduler::OnOwnerEndPlay);
+
+	Wheel.SetTimer(InOutHandle, Owner, Delegate, GetWorld()->GetTimeSeconds(), Rate, bLoop, FirstDelay);
+}
+
+void ACSGameplayScheduler::ClearTimer(FCSTimerHandle& InOutHandle)
+{
+	Wheel.ClearTimer(InOutHandle);
+}
+
+void ACSGameplayScheduler::ClearAllTimersForObject(const UObject* Owner)
+{
+	Wheel.ClearAllTimersForOwner(Owner);
+}
+
+float ACSGameplayScheduler::GetTimerRemaining(const FCSTimerHandle& Handle) const
+{
+	return Wheel.GetTimerRemaining(Handle, GetWorld()->GetTimeSeconds());
+}
+
+void ACSGameplayScheduler::OnOwnerEndPlay(AActor* Actor, EEndPlayReason::Type EndPlayReason)
+{
+	Wheel.ClearAllTimersForOwner(Actor);
+}
+
+
+
+void ACSGameplayScheduler::Tick(float DeltaSeconds)
+{
+	SCOPE_CYCLE_COUNTER(STAT_SchedulerTick);
+
+	Super::Tick(DeltaSeconds);
+
+	int32 NumFired = Wheel.Advance(GetWorld()->GetTimeSeconds());
+
+	SET_DWORD_STAT(STAT_SchedulerTimers, Wheel.GetNumTimers());
+	SET_DWORD_STAT(STAT_SchedulerTimersFired, NumFired);
+}
@@ -0,0 +1,505 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CSMatchInstance.h"
+#include "CoopGame.h"
+#include "CSGameMode.h"
+#include "CSPlayerState.h"
+#include "AI/CSTrackerBot.h"
+#include "Components/CSHealthComponent.h"
+#include "Components/CSSpawnDirectorComponent.h"
+#include "Components/CSSoakTestComponent.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "GameFramework/PlayerController.h"
+#include "CSGameplayScheduler.h"
+#include "CSTelemetry.h"
+#include "Net/UnrealNetwork.h"
+
+
+DECLARE_CYCLE_STAT(TEXT("Check Wave State"), STAT_CheckWaveState, STATGROUP_Coop);
+
+
+ACSMatchInstance::ACSMatchInstance()
+{
+	SpawnDirectorComp = CreateDefaultSubobject<UCSSpawnDirectorComponent>(TEXT("SpawnDirectorComp"));
+
+	SetReplicates(true);
+	bAlwaysRelevant = false;
+
+	MatchId = INDEX_NONE;
+	ArenaTag = NAME_None;
+	WaveState = EWaveState::WaitingToStart;
+	WaveCount = 0;
+	NumOfBotsToSpawn = 0;
+	bMatchStarted = false;
+	LastRestartTimeMs = 0.0f;
+}
+
+
+void ACSMatchInstance::InitMatch(int32 InMatchId, FName InArenaTag)
+{
+	MatchId = InMatchId;
+	ArenaTag = InArenaTag;
+
+	//Bots of an arena spawn around its own spawn origins
+	if (ArenaTag != NAME_None)
+		SpawnDirectorComp->SetSpawnOriginTag(ArenaTag);
+}
+
+void ACSMatchInstance::BeginPlay()
+{
+	Super::BeginPlay();
+
+	OnRep_WaveState();
+}
+
+ACSGameMode* ACSMatchInstance::GetGameMode() const
+{
+	return GetWorld()->GetAuthGameMode<ACSGameMode>();
+}
+
+
+
+#pragma region Membership
+
+int32 ACSMatchInstance::FindMatchId(const AActor* Actor)
+{
+	//Follow player states, owners and instigators up to an actor that knows its match
+	for (int32 Depth = 0; Actor && Depth < 8; Depth++)
+	{
+		if (const ACSMatchInstance* Match = Cast<ACSMatchInstance>(Actor))
+			return Match->MatchId;
+
+		if (const ACSPlayerState* PS = Cast<ACSPlayerState>(Actor))
+			return PS->GetMatchId();
+
+		const ACSTrackerBot* Bot = Cast<ACSTrackerBot>(Actor);
+		if (Bot && Bot->GetMatchId() != INDEX_NONE)
+			return Bot->GetMatchId();
+
+		const AController* Controller = Cast<AController>(Actor);
+		const APawn* Pawn = Cast<APawn>(Actor);
+
+		if (Controller && Controller->PlayerState)
+			Actor = Controller->PlayerState;
+		else if (Pawn && Pawn->PlayerState)
+			Actor = Pawn->PlayerState;
+		else if (Actor->GetOwner())
+			Actor = Actor->GetOwner();
+		else
+			Actor = Actor->Instigator;
+	}
+
+	return INDEX_NONE;
+}
+
+bool ACSMatchInstance::IsSameMatch(const AActor* ActorA, const AActor* ActorB)
+{
+	int32 MatchIdA = FindMatchId(ActorA);
+	int32 MatchIdB = FindMatchId(ActorB);
+
+	return MatchIdA == INDEX_NONE || MatchIdB == INDEX_NONE || MatchIdA == MatchIdB;
+}
+
+bool ACSMatchInstance::ContainsActor(const AActor* Actor) const
+{
+	if (Actor == nullptr)
+		return false;
+
+	if (FindMatchId(Actor) == MatchId)
+		return true;
+
+	if (ArenaTag == NAME_None)
+		return false;
+
+	for (const AActor* It = Actor; It; It = It->GetOwner())
+	{
+		if (It->ActorHasTag(ArenaTag))
+			return true;
+	}
+
+	return false;
+}
+
+int32 ACSMatchInstance::GetNumPlayers() const
+{
+	int32 NumPlayers = 0;
+
+	for (FConstControllerIterator It = GetWorld()->GetControllerIterator(); It; ++It)
+	{
+		AController* PC = It->Get();
+		ACSPlayerState* PS = PC ? Cast<ACSPlayerState>(PC->PlayerState) : nullptr;
+		if (PS && PS->GetMatchId() == MatchId)
+			NumPlayers++;
+	}
+
+	return NumPlayers;
+}
+
+bool ACSMatchInstance::IsNetRelevantFor(const AActor* RealViewer, const AActor* ViewTarget, const FVector& SrcLocation) const
+{
+	return FindMatchId(RealViewer) == MatchId;
+}
+
+#pragma endregion Membership
+
+
+
+void ACSMatchInstance::UpdateMatch()
+{
+	int32 NumPlayers = GetNumPlayers();
+
+	if (!bMatchStarted)
+	{
+		//Soak tests hold the match until their remote clients joined
+		ACSGameMode* GM = GetGameMode();
+		if (NumPlayers > 0 && !(GM && GM->SoakTestComp->IsWaitingForClients()))
+			StartMatch();
+
+		return;
+	}
+
+	if (NumPlayers == 0)
+	{
+		StopMatch();
+		return;
+	}
+
+	//Nothing to check while the match shows its game over
+	if (ACSGameplayScheduler::Get(GetWorld())->IsTimerActive(TimerHandle_GameOverReset))
+		return;
+
+	CheckWaveState();
+	CheckAnyPlayerAlive();
+}
+
+void ACSMatchInstance::StartMatch()
+{
+	UE_LOG(LogCoop, Log, TEXT("Match %d: Started with %d players."), MatchId, GetNumPlayers());
+
+	bMatchStarted = true;
+	PrepareForNextWave();
+}
+
+void ACSMatchInstance::StopMatch()
+{
+	UE_LOG(LogCoop, Log, TEXT("Match %d: All players left."), MatchId);
+
+	EndWave();
+	ResetMatch();
+
+	bMatchStarted = false;
+}
+
+
+
+void ACSMatchInstance::StartWave()
+{
+	WaveCount++;
+	NumOfBotsToSpawn = 2 * WaveCount;
+
+	//Bots missing from the pool are spawned when needed
+	SpawnDirectorComp->PrewarmPool(0);
+
+	UE_LOG(LogCoop, Log, TEXT("Match %d: Wave %d started!"), MatchId, WaveCount);
+	FCSTelemetry::Record(ECSTelemetryEvent::WaveStart, this, nullptr, WaveCount);
+
+	//Soak reports cover the first match
+	ACSGameMode* GM = GetGameMode();
+	if (GM && MatchId == 0)
+		GM->SoakTestComp->NotifyWaveStarted(WaveCount, NumOfBotsToSpawn);
+
+	ScheduleNextBotSpawn();
+
+	SetWaveState(EWaveState::WaveInProgress);
+}
+
+
+void ACSMatchInstance::SpawnBotTimerElapsed()
+{
+	ACSGameMode* GM = GetGameMode();
+	if (GM == nullptr)
+		return;
+
+	//Hold the spawn while the server is over budget, the wave still spawns all of its bots
+	if (SpawnDirectorComp->ShouldDeferSpawn())
+	{
+		SpawnDirectorComp->NotifySpawnDeferred();
+		ACSGameplayScheduler::Get(GetWorld())->SetTimer(TimerHandle_BotSpawner, this, &ACSMatchInstance::SpawnBotTimerElapsed, GM->BotSpawnInterval, false);
+		return;
+	}
+
+	if (SpawnDirectorComp->CanSpawnBots())
+		SpawnDirectorComp->SpawnBot();
+	else
+		GM->SpawnNewBot();
+
+	NumOfBotsToSpawn--;
+
+	if (NumOfBotsToSpawn <= 0)
+	{
+		EndWave();
+	}
+	else
+	{
+		ScheduleNextBotSpawn();
+	}
+}
+
+void ACSMatchInstance::ScheduleNextBotSpawn()
+{
+	ACSGameMode* GM = GetGameMode();
+	if (GM)
+		ACSGameplayScheduler::Get(GetWorld())->SetTimer(TimerHandle_BotSpawner, this, &ACSMatchInstance::SpawnBotTimerElapsed, SpawnDirectorComp->GetSpawnInterval(GM->BotSpawnInterval), false);
+}
+
+
+void ACSMatchInstance::EndWave()
+{
+	UE_LOG(LogCoop, Log, TEXT("Match %d: Wave %d has ended!"), MatchId, WaveCount);
+	ACSGameplayScheduler::Get(GetWorld())->ClearTimer(TimerHandle_BotSpawner);
+
+	SetWaveState(EWaveState::WaitingToComplete);
+}
+
+
+void ACSMatchInstance::PrepareForNextWave()
+{
+	ACSGameMode* GM = GetGameMode();
+	if (GM == nullptr)
+		return;
+
+	RestartDeadPlayers();
+
+	//Spawn the bots of the next wave while players wait for it
+	SpawnDirectorComp->PrewarmPool(2 * (WaveCount + 1));
+
+	UE_LOG(LogCoop, Log, TEXT("Match %d: Preparing for next wave!"), MatchId);
+	ACSGameplayScheduler::Get(GetWorld())->SetTimer(TimerHandle_NextWaveStart, this, &ACSMatchInstance::StartWave, GM->WaveInterval, false);
+
+	SetWaveState(EWaveState::WaitingToStart);
+}
+
+
+
+void ACSMatchInstance::CheckWaveState()
+{
+	COOP_SCOPE_CYCLE_COUNTER(CheckWaveState);
+
+	bool bIsPreparingForNextWave = ACSGameplayScheduler::Get(GetWorld())->IsTimerActive(TimerHandle_NextWaveStart);
+
+	if (NumOfBotsToSpawn > 0 || bIsPreparingForNextWave)
+		return;
+
+
+	bool bIsAnyBotAlive = false;
+
+	for (FConstPawnIterator It = GetWorld()->GetPawnIterator(); It; ++It)
+	{
+		APawn* TestPawn = It->Get();
+
+		//Pooled bots are hidden, pawns with a player state are players or stand-ins, bots of other matches don't count
+		if (TestPawn == nullptr || TestPawn->IsPlayerControlled() || TestPawn->PlayerState || TestPawn->bHidden || !IsSameMatch(this, TestPawn))
+			continue;
+
+		UCSHealthComponent* HealthComp = Cast<UCSHealthComponent>(TestPawn->GetComponentByClass(UCSHealthComponent::StaticClass()));
+		if (HealthComp && HealthComp->GetHealth() > 0.0f)
+		{
+			bIsAnyBotAlive = true;
+			break;
+		}
+	}
+
+	if (!bIsAnyBotAlive)
+	{
+		ACSGameMode* GM = GetGameMode();
+		if (GM && MatchId == 0)
+			GM->SoakTestComp->NotifyWaveCompleted(WaveCount);
+
+		FCSTelemetry::Record(ECSTelemetryEvent::WaveEnd, this, nullptr, WaveCount);
+
+		SetWaveState(EWaveState::WaveComplete);
+		PrepareForNextWave();
+	}
+}
+
+void ACSMatchInstance::CheckAnyPlayerAlive()
+{
+	//Iterate all controllers with a player state in this match, soak tests play with AI stand-in players
+	for (FConstControllerIterator It = GetWorld()->GetControllerIterator(); It; ++It)
+	{
+		AController* PC = It->Get();
+		if (PC && PC->PlayerState && PC->GetPawn() && FindMatchId(PC) == MatchId)
+		{
+			APawn* MyPawn = PC->GetPawn();
+			UCSHealthComponent* HealthComp = Cast<UCSHealthComponent>(MyPawn->GetComponentByClass(UCSHealthComponent::StaticClass()));
+
+			//Ensure that the player pawn has a Health Component or cause a break in the code
+			if (ensure(HealthComp))
+			{
+				return;
+			}
+		}
+	}
+
+	//No player alive
+	GameOver();
+}
+
+
+
+
+void ACSMatchInstance::GameOver()
+{
+	EndWave();
+	// @TODO: Finish up the match, present 'Game Over' to the players.
+
+	UE_LOG(LogCoop, Log, TEXT("Match %d: GAME OVER! Players Died!"), MatchId);
+	FCSTelemetry::Record(ECSTelemetryEvent::GameOver, this, nullptr, WaveCount);
+
+	ACSGameMode* GM = GetGameMode();
+	if (GM && MatchId == 0)
+		GM->SoakTestComp->NotifyGameOver();
+
+	SetWaveState(EWaveState::GameOver);
+
+	//Resetting in the same frame would replace the state before it replicates
+	float ResetDelay = GM ? GM->GameOverResetDelay : 0.0f;
+	if (ResetDelay > 0.0f)
+		ACSGameplayScheduler::Get(GetWorld())->SetTimer(TimerHandle_GameOverReset, this, &ACSMatchInstance::GameOverResetElapsed, ResetDelay, false);
+	else
+		GameOverResetElapsed();
+}
+
+void ACSMatchInstance::GameOverResetElapsed()
+{
+	ResetMatch();
+	PrepareForNextWave();
+}
+
+void ACSMatchInstance::ResetMatch()
+{
+	ACSGameMode* GM = GetGameMode();
+	if (GM == nullptr)
+		return;
+
+	double StartTime = FPlatformTime::Seconds();
+
+	//Bots go back into the pool, pawns and weapons are destroyed
+	//and pickups, barrels and the game state go back to their initial state
+	if (GM->GetNumMatches() > 1)
+		ResetMatchActors();
+	else
+		GM->ResetLevel();
+
+	LastRestartTimeMs = (float)((FPlatformTime::Seconds() - StartTime) * 1000.0);
+	UE_LOG(LogCoop, Log, TEXT("Match %d: Restarted in %.2fms."), MatchId, LastRestartTimeMs);
+}
+
+void ACSMatchInstance::ResetMatchActors()
+{
+	ACSGameMode* GM = GetGameMode();
+
+	TArray<AActor*> MatchActors;
+	for (FActorIterator It(GetWorld()); It; ++It)
+	{
+		AActor* A = *It;
+		if (A && A != this && !A->IsPendingKill() && ContainsActor(A) && GM->ShouldReset(A))
+			MatchActors.Add(A);
+	}
+
+	//Controllers first, like AGameModeBase::ResetLevel
+	for (AActor* A : MatchActors)
+	{
+		AController* Controller = Cast<AController>(A);
+		if (Controller == nullptr)
+			continue;
+
+		APlayerController* PC = Cast<APlayerController>(Controller);
+		if (PC)
+			PC->ClientReset();
+
+		Controller->Reset();
+	}
+
+	for (AActor* A : MatchActors)
+	{
+		if (!A->IsPendingKill() && !A->IsA<AController>())
+			A->Reset();
+	}
+
+	Reset();
+}
+
+
+void ACSMatchInstance::Reset()
+{
+	Super::Reset();
+
+	ACSGameplayScheduler::Get(GetWorld())->ClearTimer(TimerHandle_BotSpawner);
+	ACSGameplayScheduler::Get(GetWorld())->ClearTimer(TimerHandle_NextWaveStart);
+	ACSGameplayScheduler::Get(GetWorld())->ClearTimer(TimerHandle_GameOverReset);
+
+	WaveCount = 0;
+	NumOfBotsToSpawn = 0;
+}
+
+
+void ACSMatchInstance::RestartDeadPlayers()
+{
+	ACSGameMode* GM = GetGameMode();
+
+	for (FConstControllerIterator It = GetWorld()->GetControllerIterator(); It; ++It)
+	{
+		AController* PC = It->Get();
+		if (PC && PC->PlayerState && PC->GetPawn() == nullptr && FindMatchId(PC) == MatchId)
+		{
+			GM->RestartPlayer(PC);
+		}
+	}
+}
+
+
+
+void ACSMatchInstance::SetWaveState(EWaveState NewState)
+{
+	if (Role == ROLE_Authority)
+	{
+		WaveState = NewState;
+		//Call on server
+		OnRep_WaveState();
+	}
+}
+
+void ACSMatchInstance::OnRep_WaveState()
+{
+	ACSGameState* GS = GetWorld()->GetGameState<ACSGameState>();
+	if (GS && IsLocalMatch())
+		GS->SetWaveState(WaveState);
+}
+
+bool ACSMatchInstance::IsLocalMatch() const
+{
+	//Clients only receive their own match
+	if (Role != ROLE_Authority)
+		return true;
+
+	//Dedicated servers and hosts that have not joined a match yet show the first match
+	const APlayerController* LocalPC = GEngine->GetFirstLocalPlayerController(GetWorld());
+	int32 LocalMatchId = LocalPC ? FindMatchId(LocalPC) : INDEX_NONE;
+
+	return LocalMatchId == MatchId || (LocalMatchId == INDEX_NONE && MatchId == 0);
+}
+
+
+
+void ACSMatchInstance::GetLifetimeReplicatedProps(TArray< FLifetimeProperty > & OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME(ACSMatchInstance, MatchId);
+	DOREPLIFETIME(ACSMatchInstance, ArenaTag);
+	DOREPLIFETIME(ACSMatchInstance, WaveState);
+}
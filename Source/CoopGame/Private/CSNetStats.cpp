@@ -0,0 +1,59 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CSNetStats.h"
+#include "CoopGame.h"
+#include "GameFramework/Actor.h"
+
+
+static int32 LogNetConsidered = 0;
+FAutoConsoleVariableRef CVARLogNetConsidered(
+	TEXT("COOP.LogNetConsidered"),
+	LogNetConsidered,
+	TEXT("Log per class how many actors were considered for replication per second"),
+	ECVF_Default);
+
+static int32 NetDormancy = 1;
+FAutoConsoleVariableRef CVARNetDormancy(
+	TEXT("COOP.NetDormancy"),
+	NetDormancy,
+	TEXT("Let pickups, powerups and barrels go net dormant between state changes. Only affects actors spawned afterwards"),
+	ECVF_Default);
+
+
+TMap<FName, int32> FCSNetStats::ConsideredCounts;
+
+double FCSNetStats::CountStartTime = 0.0;
+
+
+void FCSNetStats::NotifyConsidered(const AActor* Actor)
+{
+	if (LogNetConsidered == 0 || Actor == nullptr)
+		return;
+
+	ConsideredCounts.FindOrAdd(Actor->GetClass()->GetFName())++;
+
+	double Now = FPlatformTime::Seconds();
+	if (CountStartTime <= 0.0)
+		CountStartTime = Now;
+	else if (Now - CountStartTime >= 1.0)
+		LogConsideredCounts(Now);
+}
+
+bool FCSNetStats::IsDormancyEnabled()
+{
+	return NetDormancy != 0;
+}
+
+void FCSNetStats::LogConsideredCounts(double Now)
+{
+	float Duration = (float)(Now - CountStartTime);
+
+	ConsideredCounts.ValueSort([](int32 A, int32 B) { return A > B; });
+
+	for (const TPair<FName, int32>& Count : ConsideredCounts)
+		UE_LOG(LogCoop, Log, TEXT("Net: %s considered %.1f/s"), *Count.Key.ToString(), Count.Value / Duration);
+
+	ConsideredCounts.Reset();
+	CountStartTime = Now;
+}
@@ -0,0 +1,192 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CSPacketCompressionCommandlet.h"
+#include "CoopGame.h"
+#include "CSPacketCompressionComponent.h"
+#include "HAL/FileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+
+//Length of the byte sequences counted during training
+static const int32 SegmentLength = 8;
+
+//Captures started this close after the previous one were recorded by another process of the same session
+static const double SessionGapSeconds = 60.0;
+
+
+int32 UCSPacketCompressionCommandlet::Main(const FString& Params)
+{
+	FString CaptureDir = FCSPacketCompressionComponent::GetCaptureDir();
+	FParse::Value(*Params, TEXT("Captures="), CaptureDir);
+
+	int32 DictSize = 4096;
+	FParse::Value(*Params, TEXT("DictSize="), DictSize);
+	DictSize = FMath::Clamp(DictSize, 256, FCSPacketDictionary::MaxSize);
+
+	int32 Level = 1;
+	FParse::Value(*Params, TEXT("Level="), Level);
+
+	TArray<FString> CaptureFiles;
+	IFileManager::Get().FindFiles(CaptureFiles, *(CaptureDir / TEXT("*.bin")), true, false);
+
+	//Capture names start with the time they were started at, sorted they are in the order they were recorded
+	CaptureFiles.Sort();
+
+	//Packets close to each other are near duplicates, so whole sessions are held out. Even sessions train the dictionary, odd ones are benchmarked.
+	//New sessions sort last, so adding captures never moves a session the stored dictionary was trained on into the benchmark
+	TArray<TArray<uint8>> TrainingPackets;
+	TArray<TArray<uint8>> BenchmarkPackets;
+	int32 NumSessions = 0;
+	FDateTime LastStartTime;
+
+	for (const FString& CaptureFile : CaptureFiles)
+	{
+		FDateTime StartTime;
+		bool bParsed = FDateTime::Parse(CaptureFile.Left(CaptureFile.Find(TEXT("_"))), StartTime);
+
+		if (NumSessions == 0 || !bParsed || (StartTime - LastStartTime).GetTotalSeconds() > SessionGapSeconds)
+			NumSessions++;
+
+		if (bParsed)
+			LastStartTime = StartTime;
+
+		FCSPacketCompressionComponent::LoadCapturedPackets(CaptureDir / CaptureFile, NumSessions % 2 == 1 ? TrainingPackets : BenchmarkPackets);
+	}
+
+	if (TrainingPackets.Num() == 0)
+	{
+		UE_LOG(LogCoop, Error, TEXT("Net: No captured packets in %s, play with COOP.PacketCapture 1 first."), *CaptureDir);
+		return 1;
+	}
+
+	UE_LOG(LogCoop, Display, TEXT("Net: Loaded %d training and %d benchmark packets from %d captures of %d sessions."),
+		TrainingPackets.Num(), BenchmarkPackets.Num(), CaptureFiles.Num(), NumSessions);
+
+	TArray<uint8> Dictionary;
+
+	if (FParse::Param(*Params, TEXT("Train")))
+	{
+		TrainDictionary(TrainingPackets, DictSize, Dictionary);
+
+		FString Path = FCSPacketDictionary::GetDefaultPath();
+		if (!FFileHelper::SaveArrayToFile(Dictionary, *Path))
+		{
+			UE_LOG(LogCoop, Error, TEXT("Net: Failed to write dictionary to %s."), *Path);
+			return 1;
+		}
+
+		UE_LOG(LogCoop, Display, TEXT("Net: Wrote %d byte dictionary to %s."), Dictionary.Num(), *Path);
+	}
+	else
+	{
+		Dictionary = FCSPacketDictionary::Get().Data;
+	}
+
+	if (FParse::Param(*Params, TEXT("Bench")))
+	{
+		if (BenchmarkPackets.Num() == 0)
+		{
+			UE_LOG(LogCoop, Error, TEXT("Net: Need captures of at least two sessions to benchmark on packets the dictionary was not trained on."));
+			return 1;
+		}
+
+		Benchmark(BenchmarkPackets, nullptr, Level, TEXT("No dictionary"));
+
+		if (Dictionary.Num() > 0)
+			Benchmark(BenchmarkPackets, &Dictionary, Level, TEXT("Dictionary"));
+	}
+
+	return 0;
+}
+
+void UCSPacketCompressionCommandlet::TrainDictionary(const TArray<TArray<uint8>>& Packets, int32 DictSize, TArray<uint8>& OutDictionary) const
+{
+	//Number of packets each sequence appears in, repeats within a packet are already cheap for deflate
+	TMap<uint64, int32> SegmentCounts;
+	TSet<uint64> PacketSegments;
+
+	for (const TArray<uint8>& Packet : Packets)
+	{
+		PacketSegments.Reset();
+
+		for (int32 i = 0; i + SegmentLength <= Packet.Num(); i++)
+		{
+			uint64 Segment = 0;
+			FMemory::Memcpy(&Segment, Packet.GetData() + i, SegmentLength);
+			PacketSegments.Add(Segment);
+		}
+
+		for (uint64 Segment : PacketSegments)
+			SegmentCounts.FindOrAdd(Segment)++;
+	}
+
+	SegmentCounts.ValueSort([](int32 A, int32 B) { return A > B; });
+
+	//Sequences found in a single packet do not help any other packet
+	TArray<uint64> Segments;
+	for (const TPair<uint64, int32>& SegmentCount : SegmentCounts)
+	{
+		if (SegmentCount.Value < 2 || Segments.Num() * SegmentLength >= DictSize)
+			break;
+
+		Segments.Add(SegmentCount.Key);
+	}
+
+	//Most common sequence last
+	OutDictionary.Reset(Segments.Num() * SegmentLength);
+	for (int32 i = Segments.Num() - 1; i >= 0; i--)
+		OutDictionary.Append((const uint8*)&Segments[i], SegmentLength);
+
+	UE_LOG(LogCoop, Display, TEXT("Net: Picked %d of %d distinct sequences for the dictionary."), Segments.Num(), SegmentCounts.Num());
+}
+
+void UCSPacketCompressionCommandlet::Benchmark(const TArray<TArray<uint8>>& Packets, const TArray<uint8>* Dictionary, int32 Level, const TCHAR* Label) const
+{
+	FCSPacketCodec Codec;
+	if (!Codec.Init(Dictionary, Level))
+	{
+		UE_LOG(LogCoop, Error, TEXT("Net: Failed to initialize the packet codec."));
+		return;
+	}
+
+	TArray<uint8> CompressedData;
+	TArray<uint8> DecompressedData;
+
+	int64 RawBytes = 0;
+	int64 CompressedBytes = 0;
+	uint64 CompressCycles = 0;
+	uint64 DecompressCycles = 0;
+	int32 Failures = 0;
+
+	for (const TArray<uint8>& Packet : Packets)
+	{
+		uint64 StartCycles = FPlatformTime::Cycles64();
+		bool bCompressed = Codec.Compress(Packet.GetData(), Packet.Num(), CompressedData);
+		CompressCycles += FPlatformTime::Cycles64() - StartCycles;
+
+		if (!bCompressed)
+		{
+			Failures++;
+			continue;
+		}
+
+		DecompressedData.SetNumUninitialized(Packet.Num(), false);
+
+		StartCycles = FPlatformTime::Cycles64();
+		bool bDecompressed = Codec.Decompress(CompressedData.GetData(), CompressedData.Num(), DecompressedData.GetData(), DecompressedData.Num());
+		DecompressCycles += FPlatformTime::Cycles64() - StartCycles;
+
+		if (!bDecompressed || DecompressedData != Packet)
+			Failures++;
+
+		//The component sends packets that do not shrink as they are
+		RawBytes += Packet.Num();
+		CompressedBytes += FMath::Min(CompressedData.Num() + 4, Packet.Num());
+	}
+
+	UE_LOG(LogCoop, Display, TEXT("Net: %s, level %d: %d packets, %.1f bytes raw on average, %.1f%% of raw size, compress %.2f us, decompress %.2f us per packet, %d failed."),
+		Label, Level, Packets.Num(), (double)RawBytes / Packets.Num(), RawBytes > 0 ? 100.0 * CompressedBytes / RawBytes : 0.0,
+		FPlatformTime::ToMilliseconds64(CompressCycles) * 1000.0 / Packets.Num(), FPlatformTime::ToMilliseconds64(DecompressCycles) * 1000.0 / Packets.Num(), Failures);
+}
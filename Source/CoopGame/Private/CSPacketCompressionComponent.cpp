@@ -0,0 +1,562 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CSPacketCompressionComponent.h"
+#include "CoopGame.h"
+#include "HAL/FileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/Archive.h"
+
+THIRD_PARTY_INCLUDES_START
+#include "zlib.h"
+THIRD_PARTY_INCLUDES_END
+
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Packet Bytes Raw"), STAT_PacketBytesRaw, STATGROUP_Coop);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Packet Bytes Sent"), STAT_PacketBytesSent, STATGROUP_Coop);
+DECLARE_CYCLE_STAT(TEXT("Packet Compress"), STAT_PacketCompress, STATGROUP_Coop);
+DECLARE_CYCLE_STAT(TEXT("Packet Decompress"), STAT_PacketDecompress, STATGROUP_Coop);
+
+static int32 PacketCompression = 1;
+FAutoConsoleVariableRef CVARPacketCompression(
+	TEXT("COOP.PacketCompression"),
+	PacketCompression,
+	TEXT("Compress outgoing packets. Incoming compressed packets are always decompressed"),
+	ECVF_Default);
+
+static int32 PacketCompressionLevel = 1;
+FAutoConsoleVariableRef CVARPacketCompressionLevel(
+	TEXT("COOP.PacketCompressionLevel"),
+	PacketCompressionLevel,
+	TEXT("zlib level of connections opened afterwards, 1 is fastest"),
+	ECVF_Default);
+
+static int32 PacketCompressionMinBytes = 16;
+FAutoConsoleVariableRef CVARPacketCompressionMinBytes(
+	TEXT("COOP.PacketCompressionMinBytes"),
+	PacketCompressionMinBytes,
+	TEXT("Packets smaller than this are sent uncompressed"),
+	ECVF_Default);
+
+static int32 PacketCapture = 0;
+FAutoConsoleVariableRef CVARPacketCapture(
+	TEXT("COOP.PacketCapture"),
+	PacketCapture,
+	TEXT("Record raw outgoing packets to Saved/NetCaptures for training the compression dictionary"),
+	ECVF_Default);
+
+//Bounds incoming packets, the engine never sends more than MAX_PACKET_SIZE
+static const int32 MaxUncompressedBytes = 4096;
+
+//Compressed flag, confirm flag and hash flag followed by the hash
+static const int32 HeaderBits = 3 + 32;
+
+//Hash table size of deflate, small tables are cheaper to copy and lose next to nothing on packet sized input
+static const int32 DeflateMemLevel = 4;
+
+//Deflate keeps this much of its window free for lookahead
+static const int32 DeflateMinLookahead = 262;
+
+static const int32 CopyArenaAlignment = 16;
+
+// Bits SerializeIntPacked writes for the value, 7 per byte
+static int32 GetPackedIntBits(uint32 Value)
+{
+	int32 NumBytes = 1;
+	while (Value >>= 7)
+		NumBytes++;
+
+	return NumBytes * 8;
+}
+
+//Captured packets are written out at most this often and when a connection closes
+static const double CaptureFlushInterval = 1.0;
+
+
+
+#pragma region Dictionary
+
+const FCSPacketDictionary& FCSPacketDictionary::Get()
+{
+	static FCSPacketDictionary Dictionary;
+	static bool bLoaded = false;
+
+	if (!bLoaded)
+	{
+		bLoaded = true;
+
+		FString Path = GetDefaultPath();
+		if (FPaths::FileExists(Path) && FFileHelper::LoadFileToArray(Dictionary.Data, *Path))
+		{
+			if (Dictionary.Data.Num() > MaxSize)
+				Dictionary.Data.RemoveAt(0, Dictionary.Data.Num() - MaxSize);
+
+			Dictionary.Hash = FCrc::MemCrc32(Dictionary.Data.GetData(), Dictionary.Data.Num());
+			UE_LOG(LogCoop, Log, TEXT("Net: Loaded packet dictionary %s, %d bytes."), *Path, Dictionary.Data.Num());
+		}
+		else
+		{
+			UE_LOG(LogCoop, Log, TEXT("Net: No packet dictionary at %s, packets are compressed without one."), *Path);
+		}
+	}
+
+	return Dictionary;
+}
+
+FString FCSPacketDictionary::GetDefaultPath()
+{
+	return FPaths::ProjectContentDir() / TEXT("Net/CoopPackets.dict");
+}
+
+#pragma endregion Dictionary
+
+
+
+#pragma region Codec
+
+static voidpf ZAlloc(voidpf Opaque, uInt Items, uInt Size)
+{
+	return FMemory::Malloc(Items * Size);
+}
+
+static void ZFree(voidpf Opaque, voidpf Address)
+{
+	FMemory::Free(Address);
+}
+
+FCSPacketCodec::FCSPacketCodec()
+{
+	DeflateTemplate = nullptr;
+	DeflateStream = nullptr;
+	bDeflateStreamCopied = false;
+	InflateStream = nullptr;
+	Dictionary = nullptr;
+
+	CopyArenaUsed = 0;
+	CopyArenaRequired = 0;
+}
+
+// Smallest deflate window that reaches from the end of the largest packet back to the start of the dictionary
+static int32 GetWindowBits(int32 DictionarySize)
+{
+	int32 WindowBits = 9;
+	while (WindowBits < MAX_WBITS && (1 << WindowBits) - DeflateMinLookahead < DictionarySize + MaxUncompressedBytes)
+		WindowBits++;
+
+	return WindowBits;
+}
+
+void* FCSPacketCodec::AllocCopy(void* Opaque, uint32 Items, uint32 Size)
+{
+	FCSPacketCodec* Codec = (FCSPacketCodec*)Opaque;
+
+	int32 Bytes = Align((int32)(Items * Size), CopyArenaAlignment);
+	Codec->CopyArenaRequired += Bytes;
+
+	if (Codec->CopyArenaUsed + Bytes > Codec->CopyArena.Num())
+		return FMemory::Malloc(Bytes, CopyArenaAlignment);
+
+	void* Address = Codec->CopyArena.GetData() + Codec->CopyArenaUsed;
+	Codec->CopyArenaUsed += Bytes;
+	return Address;
+}
+
+void FCSPacketCodec::FreeCopy(void* Opaque, void* Address)
+{
+	FCSPacketCodec* Codec = (FCSPacketCodec*)Opaque;
+
+	//Arena memory is handed out again with the next copy
+	const uint8* Byte = (const uint8*)Address;
+	if (Byte < Codec->CopyArena.GetData() || Byte >= Codec->CopyArena.GetData() + Codec->CopyArena.Num())
+		FMemory::Free(Address);
+}
+
+FCSPacketCodec::~FCSPacketCodec()
+{
+	Release();
+}
+
+bool FCSPacketCodec::Init(const TArray<uint8>* InDictionary, int32 Level)
+{
+	Release();
+
+	Dictionary = (InDictionary && InDictionary->Num() > 0) ? InDictionary : nullptr;
+
+	DeflateTemplate = new z_stream;
+	FMemory::Memzero(DeflateTemplate, sizeof(z_stream));
+	DeflateTemplate->zalloc = &ZAlloc;
+	DeflateTemplate->zfree = &ZFree;
+
+	//Initialized by copying the template
+	DeflateStream = new z_stream;
+	FMemory::Memzero(DeflateStream, sizeof(z_stream));
+
+	InflateStream = new z_stream;
+	FMemory::Memzero(InflateStream, sizeof(z_stream));
+	InflateStream->zalloc = &ZAlloc;
+	InflateStream->zfree = &ZFree;
+
+	//Raw deflate, the packet bit count already tells where the data ends. Inflate takes any window up to the largest
+	int32 WindowBits = GetWindowBits(Dictionary ? Dictionary->Num() : 0);
+	bool bDeflateValid = deflateInit2(DeflateTemplate, FMath::Clamp(Level, 1, 9), Z_DEFLATED, -WindowBits, DeflateMemLevel, Z_DEFAULT_STRATEGY) == Z_OK;
+	bool bInflateValid = inflateInit2(InflateStream, -MAX_WBITS) == Z_OK;
+
+	bool bPrimed = bDeflateValid && (Dictionary == nullptr || deflateSetDictionary(DeflateTemplate, Dictionary->GetData(), Dictionary->Num()) == Z_OK);
+
+	if (!bPrimed || !bInflateValid)
+	{
+		if (bDeflateValid)
+			deflateEnd(DeflateTemplate);
+		if (bInflateValid)
+			inflateEnd(InflateStream);
+
+		delete DeflateTemplate;
+		delete DeflateStream;
+		delete InflateStream;
+		DeflateTemplate = nullptr;
+		DeflateStream = nullptr;
+		InflateStream = nullptr;
+
+		return false;
+	}
+
+	//Copies take these, the template itself was allocated from the heap and is freed there again in Release
+	DeflateTemplate->zalloc = &AllocCopy;
+	DeflateTemplate->zfree = &FreeCopy;
+	DeflateTemplate->opaque = this;
+
+	return true;
+}
+
+void FCSPacketCodec::Release()
+{
+	if (DeflateStream)
+	{
+		if (bDeflateStreamCopied)
+			deflateEnd(DeflateStream);
+
+		delete DeflateStream;
+		DeflateStream = nullptr;
+		bDeflateStreamCopied = false;
+	}
+
+	if (DeflateTemplate)
+	{
+		DeflateTemplate->zalloc = &ZAlloc;
+		DeflateTemplate->zfree = &ZFree;
+		deflateEnd(DeflateTemplate);
+		delete DeflateTemplate;
+		DeflateTemplate = nullptr;
+	}
+
+	CopyArena.Empty();
+	CopyArenaUsed = 0;
+	CopyArenaRequired = 0;
+
+	if (InflateStream)
+	{
+		inflateEnd(InflateStream);
+		delete InflateStream;
+		InflateStream = nullptr;
+	}
+}
+
+bool FCSPacketCodec::Compress(const uint8* Src, int32 SrcSize, TArray<uint8>& OutData)
+{
+	if (!IsValid())
+		return false;
+
+	//Everything of the last copy is free again, the arena grows to fit the copy once
+	if (bDeflateStreamCopied)
+		deflateEnd(DeflateStream);
+
+	if (CopyArenaRequired > CopyArena.Num())
+		CopyArena.SetNumUninitialized(CopyArenaRequired);
+
+	CopyArenaUsed = 0;
+	CopyArenaRequired = 0;
+
+	//Much cheaper than hashing the dictionary into a reset stream for every packet
+	bDeflateStreamCopied = deflateCopy(DeflateStream, DeflateTemplate) == Z_OK;
+	if (!bDeflateStreamCopied)
+		return false;
+
+	OutData.SetNumUninitialized(deflateBound(DeflateStream, SrcSize), false);
+
+	DeflateStream->next_in = const_cast<Bytef*>(Src);
+	DeflateStream->avail_in = SrcSize;
+	DeflateStream->next_out = OutData.GetData();
+	DeflateStream->avail_out = OutData.Num();
+
+	if (deflate(DeflateStream, Z_FINISH) != Z_STREAM_END)
+		return false;
+
+	OutData.SetNum(OutData.Num() - DeflateStream->avail_out, false);
+	return true;
+}
+
+bool FCSPacketCodec::Decompress(const uint8* Src, int32 SrcSize, uint8* Dest, int32 DestSize)
+{
+	if (!IsValid())
+		return false;
+
+	inflateReset(InflateStream);
+	if (Dictionary)
+		inflateSetDictionary(InflateStream, Dictionary->GetData(), Dictionary->Num());
+
+	InflateStream->next_in = const_cast<Bytef*>(Src);
+	InflateStream->avail_in = SrcSize;
+	InflateStream->next_out = Dest;
+	InflateStream->avail_out = DestSize;
+
+	return inflate(InflateStream, Z_FINISH) == Z_STREAM_END && InflateStream->avail_out == 0;
+}
+
+#pragma endregion Codec
+
+
+
+#pragma region Component
+
+FCSPacketCompressionComponent::FCSPacketCompressionComponent()
+	: HandlerComponent(FName(TEXT("CSPacketCompressionComponent")))
+{
+	bPeerDictionaryMatches = false;
+	bReceivedPeerHash = false;
+	bPeerConfirmedDictionary = false;
+
+	RawBytesSent = 0;
+	BytesSent = 0;
+	PacketsSent = 0;
+	PacketsCompressed = 0;
+	CompressCycles = 0;
+}
+
+FCSPacketCompressionComponent::~FCSPacketCompressionComponent()
+{
+	if (PacketsSent > 0 && RawBytesSent > 0)
+	{
+		UE_LOG(LogCoop, Log, TEXT("Net: Packet compression sent %d packets, %d compressed, %.1f%% of raw size, %.2f us per packet."),
+			PacketsSent, PacketsCompressed, 100.0 * BytesSent / RawBytesSent, FPlatformTime::ToMilliseconds64(CompressCycles) * 1000.0 / PacketsSent);
+	}
+
+	FlushCapture();
+}
+
+void FCSPacketCompressionComponent::Initialize()
+{
+	const FCSPacketDictionary& Dictionary = FCSPacketDictionary::Get();
+
+	if (!Codec.Init(&Dictionary.Data, PacketCompressionLevel))
+		UE_LOG(LogCoop, Warning, TEXT("Net: Packet compression failed to initialize zlib, packets are sent uncompressed."));
+
+	SetActive(true);
+	Initialized();
+}
+
+bool FCSPacketCompressionComponent::IsValid() const
+{
+	return true;
+}
+
+int32 FCSPacketCompressionComponent::GetReservedPacketBits() const
+{
+	return HeaderBits;
+}
+
+void FCSPacketCompressionComponent::Outgoing(FBitWriter& Packet, FOutPacketTraits& Traits)
+{
+	const int32 NumBits = (int32)Packet.GetNumBits();
+	const int32 NumBytes = (int32)Packet.GetNumBytes();
+
+	if (PacketCapture > 0)
+		CapturePacket(Packet.GetData(), NumBits);
+
+	//Compressed packets carry their bit count and byte count on top of the data
+	bool bCompressed = false;
+	if (PacketCompression > 0 && bPeerDictionaryMatches && Traits.bAllowCompression && Codec.IsValid() && NumBytes >= PacketCompressionMinBytes)
+	{
+		SCOPE_CYCLE_COUNTER(STAT_PacketCompress);
+		uint64 StartCycles = FPlatformTime::Cycles64();
+
+		//Only worth it if the data and both packed lengths are smaller than the raw bits
+		bCompressed = Codec.Compress(Packet.GetData(), NumBytes, CompressedData)
+			&& CompressedData.Num() * 8 + GetPackedIntBits(NumBits) + GetPackedIntBits(CompressedData.Num()) < NumBits;
+
+		CompressCycles += FPlatformTime::Cycles64() - StartCycles;
+	}
+
+	bool bSendHash = !bPeerConfirmedDictionary;
+
+	FBitWriter NewPacket(NumBits + HeaderBits, true);
+	NewPacket.WriteBit(bCompressed ? 1 : 0);
+	NewPacket.WriteBit(bReceivedPeerHash ? 1 : 0);
+	NewPacket.WriteBit(bSendHash ? 1 : 0);
+
+	if (bSendHash)
+	{
+		uint32 Hash = FCSPacketDictionary::Get().Hash;
+		NewPacket << Hash;
+	}
+
+	if (bCompressed)
+	{
+		uint32 OriginalBits = NumBits;
+		uint32 CompressedBytes = CompressedData.Num();
+		NewPacket.SerializeIntPacked(OriginalBits);
+		NewPacket.SerializeIntPacked(CompressedBytes);
+		NewPacket.Serialize(CompressedData.GetData(), CompressedData.Num());
+		PacketsCompressed++;
+	}
+	else
+	{
+		NewPacket.SerializeBits(Packet.GetData(), NumBits);
+	}
+
+	PacketsSent++;
+	RawBytesSent += NumBytes;
+	BytesSent += NewPacket.GetNumBytes();
+	INC_DWORD_STAT_BY(STAT_PacketBytesRaw, NumBytes);
+	INC_DWORD_STAT_BY(STAT_PacketBytesSent, NewPacket.GetNumBytes());
+
+	Packet = NewPacket;
+}
+
+void FCSPacketCompressionComponent::Incoming(FBitReader& Packet)
+{
+	bool bCompressed = Packet.ReadBit() != 0;
+	bool bPeerConfirmed = Packet.ReadBit() != 0;
+	bool bHasHash = Packet.ReadBit() != 0;
+
+	if (bHasHash)
+	{
+		uint32 Hash = 0;
+		Packet << Hash;
+
+		//Hashes keep arriving until our confirmation got through, only the first one is checked
+		if (!Packet.IsError() && !bReceivedPeerHash)
+		{
+			bReceivedPeerHash = true;
+			bPeerDictionaryMatches = Hash == FCSPacketDictionary::Get().Hash;
+			if (!bPeerDictionaryMatches)
+				UE_LOG(LogCoop, Warning, TEXT("Net: Packet dictionary differs from the other end, packets to it are sent uncompressed."));
+		}
+	}
+
+	if (bPeerConfirmed)
+		bPeerConfirmedDictionary = true;
+
+	if (!bCompressed || Packet.IsError())
+		return;
+
+	SCOPE_CYCLE_COUNTER(STAT_PacketDecompress);
+
+	uint32 OriginalBits = 0;
+	uint32 CompressedBytes = 0;
+	Packet.SerializeIntPacked(OriginalBits);
+	Packet.SerializeIntPacked(CompressedBytes);
+
+	if (Packet.IsError() || OriginalBits == 0 || OriginalBits > MaxUncompressedBytes * 8 || CompressedBytes > Packet.GetBytesLeft())
+	{
+		Packet.SetError();
+		return;
+	}
+
+	CompressedData.SetNumUninitialized(CompressedBytes, false);
+	Packet.Serialize(CompressedData.GetData(), CompressedBytes);
+
+	DecompressedData.SetNumUninitialized((OriginalBits + 7) >> 3, false);
+	if (Packet.IsError() || !Codec.Decompress(CompressedData.GetData(), CompressedData.Num(), DecompressedData.GetData(), DecompressedData.Num()))
+	{
+		UE_LOG(LogCoop, Warning, TEXT("Net: Failed to decompress a packet of %d bytes."), CompressedBytes);
+		Packet.SetError();
+		return;
+	}
+
+	Packet = FBitReader(DecompressedData.GetData(), OriginalBits);
+}
+
+#pragma endregion Component
+
+
+
+#pragma region Capture
+
+FString FCSPacketCompressionComponent::GetCaptureDir()
+{
+	return FPaths::ProjectSavedDir() / TEXT("NetCaptures");
+}
+
+//One file per process, shared by all connections
+static FArchive* CaptureFile = nullptr;
+
+static double LastCaptureFlushTime = 0.0;
+
+void FCSPacketCompressionComponent::CapturePacket(const uint8* Data, int32 NumBits)
+{
+	static bool bCaptureOpened = false;
+
+	if (!bCaptureOpened)
+	{
+		bCaptureOpened = true;
+
+		FString Filename = GetCaptureDir() / FString::Printf(TEXT("%s_%d.bin"), *FDateTime::Now().ToString(), FPlatformProcess::GetCurrentProcessId());
+		CaptureFile = IFileManager::Get().CreateFileWriter(*Filename);
+
+		if (CaptureFile)
+			UE_LOG(LogCoop, Log, TEXT("Net: Capturing packets to %s."), *Filename);
+	}
+
+	if (CaptureFile == nullptr || NumBits <= 0)
+		return;
+
+	*CaptureFile << NumBits;
+	CaptureFile->Serialize(const_cast<uint8*>(Data), (NumBits + 7) >> 3);
+
+	//Flushing every packet would put a file write on every send
+	if (FPlatformTime::Seconds() - LastCaptureFlushTime >= CaptureFlushInterval)
+		FlushCapture();
+}
+
+void FCSPacketCompressionComponent::FlushCapture()
+{
+	if (CaptureFile)
+	{
+		CaptureFile->Flush();
+		LastCaptureFlushTime = FPlatformTime::Seconds();
+	}
+}
+
+bool FCSPacketCompressionComponent::LoadCapturedPackets(const FString& Filename, TArray<TArray<uint8>>& OutPackets)
+{
+	TArray<uint8> FileData;
+	if (!FFileHelper::LoadFileToArray(FileData, *Filename))
+		return false;
+
+	int32 Offset = 0;
+	while (Offset + (int32)sizeof(int32) <= FileData.Num())
+	{
+		int32 NumBits = 0;
+		FMemory::Memcpy(&NumBits, FileData.GetData() + Offset, sizeof(int32));
+		Offset += sizeof(int32);
+
+		int32 NumBytes = (NumBits + 7) >> 3;
+		if (NumBits <= 0 || NumBytes > MaxUncompressedBytes || Offset + NumBytes > FileData.Num())
+			break;
+
+		OutPackets.Emplace(FileData.GetData() + Offset, NumBytes);
+		Offset += NumBytes;
+	}
+
+	return true;
+}
+
+#pragma endregion Capture
+
+
+
+TSharedPtr<HandlerComponent> UCSPacketCompressionComponentFactory::CreateComponentInstance(FString& Options)
+{
+	return MakeShareable(new FCSPacketCompressionComponent());
+}
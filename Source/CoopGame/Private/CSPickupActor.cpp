@@ -2,20 +2,30 @@
 
 
 #include "CSPickupActor.h"
+#include "CoopGame.h"
 #include "GameFramework/Actor.h"
 #include "Components/SphereComponent.h"
 #include "Components/DecalComponent.h"
-#include "TimerManager.h"
+#include "CSGameplayScheduler.h"
+#include "CSTriggerManager.h"
 #include "CSPowerupActor.h"
 #include "CSCharacter.h"
+#include "CSNetStats.h"
+#include "CSRepProfiler.h"
+#include "CSActorPool.h"
 
 // Sets default values
 ACSPickupActor::ACSPickupActor()
 {
 	SetReplicates(true);
+	//Nothing of the pickup changes at runtime, its powerup replicates the pickup state
+	NetDormancy = DORM_Initial;
 	
 	SphereComp = CreateDefaultSubobject<USphereComponent>(TEXT("SphereComp"));
 	SphereComp->SetSphereRadius(75.0f);
+	//Kept as root for the placed transforms, the trigger manager replaces its overlaps
+	SphereComp->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	SphereComp->SetGenerateOverlapEvents(false);
 	RootComponent = SphereComp;
 
 	DecalComp = CreateAbstractDefaultSubobject<UDecalComponent>(TEXT("DecalComp"));
@@ -34,29 +44,50 @@ void ACSPickupActor::BeginPlay()
 	Super::BeginPlay();
 
 	if(Role == ROLE_Authority)
-		Respawn();	
+	{
+		if (!FCSNetStats::IsDormancyEnabled())
+			SetNetDormancy(DORM_Awake);
+
+		Respawn();
+
+		ACSTriggerManager* TriggerManager = ACSTriggerManager::Get(GetWorld());
+		if (TriggerManager)
+		{
+			PickupTrigger = TriggerManager->AddTrigger(this, SphereComp->GetScaledSphereRadius(), false,
+				FCSTriggerSignature::CreateUObject(this, &ACSPickupActor::OnPickupTriggerEnter));
+		}
+	}
+}
+
+void ACSPickupActor::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	ACSTriggerManager* TriggerManager = ACSTriggerManager::Get(GetWorld(), false);
+	if (TriggerManager)
+		TriggerManager->RemoveTrigger(PickupTrigger);
+
+	Super::EndPlay(EndPlayReason);
 }
 
 void ACSPickupActor::Respawn()
 {
 	if (PowerupClass == nullptr)
 	{
-		UE_LOG(LogTemp, Warning, TEXT("PowerupClass is nullptr in %s. Please update your blueprint"), *GetName());
+		UE_LOG(LogCoop, Warning, TEXT("PowerupClass is nullptr in %s. Please update your blueprint"), *GetName());
 		return;
 	}
 
 	FActorSpawnParameters SpawnParameters;
 	SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	//Powerups belong to the arena of their pickup
+	SpawnParameters.Owner = this;
 
-	PowerupInstance = GetWorld()->SpawnActor<ACSPowerupActor>(PowerupClass, GetTransform(), SpawnParameters);
+	PowerupInstance = ACSActorPool::SpawnPooledActor<ACSPowerupActor>(GetWorld(), PowerupClass, GetTransform(), SpawnParameters);
 }
 
 
 
-void ACSPickupActor::NotifyActorBeginOverlap(AActor* OtherActor)
+void ACSPickupActor::OnPickupTriggerEnter(AActor* OtherActor)
 {
-	Super::NotifyActorBeginOverlap(OtherActor);
-
 	if (Role == ROLE_Authority && PowerupInstance && Cast<ACSCharacter>(OtherActor))
 	{
 		PowerupInstance->ActivatePowerup(OtherActor);
@@ -64,7 +95,25 @@ void ACSPickupActor::NotifyActorBeginOverlap(AActor* OtherActor)
 		PowerupInstance = nullptr;
 
 		//Set timer to respawn
-		GetWorldTimerManager().SetTimer(TimerHandle_RespawnTimer, this, &ACSPickupActor::Respawn, CooldownDuration);
+		ACSGameplayScheduler::Get(GetWorld())->SetTimer(TimerHandle_RespawnTimer, this, &ACSPickupActor::Respawn, CooldownDuration);
 	}
 }
 
+void ACSPickupActor::Reset()
+{
+	Super::Reset();
+
+	if (Role == ROLE_Authority && PowerupInstance == nullptr)
+	{
+		ACSGameplayScheduler::Get(GetWorld())->ClearTimer(TimerHandle_RespawnTimer);
+		Respawn();
+	}
+}
+
+void ACSPickupActor::PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker)
+{
+	Super::PreReplication(ChangedPropertyTracker);
+
+	FCSNetStats::NotifyConsidered(this);
+	FCSRepProfiler::NotifyPreReplication(this);
+}
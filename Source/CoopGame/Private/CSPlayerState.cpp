@@ -2,8 +2,133 @@
 
 
 #include "CSPlayerState.h"
+#include "CoopGame.h"
+#include "CSMatchInstance.h"
+#include "CSRepProfiler.h"
+#include "Engine/World.h"
+#include "GameFramework/Controller.h"
+#include "Net/UnrealNetwork.h"
+
+
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Join Time To Playable (ms)"), STAT_JoinTimeToPlayable, STATGROUP_Coop);
+
+static float JoinStreamDuration = 4.0f;
+FAutoConsoleVariableRef CVARJoinStreamDuration(
+	TEXT("COOP.JoinStreamDuration"),
+	JoinStreamDuration,
+	TEXT("Seconds after login during which the world is streamed in to a joining client by distance. 0 sends everything at once"),
+	ECVF_Default);
+
+static float JoinStreamInitialRadius = 2500.0f;
+FAutoConsoleVariableRef CVARJoinStreamInitialRadius(
+	TEXT("COOP.JoinStreamInitialRadius"),
+	JoinStreamInitialRadius,
+	TEXT("Radius around a joining client that is replicated right after login"),
+	ECVF_Default);
+
+static float JoinStreamRadiusPerSecond = 2500.0f;
+FAutoConsoleVariableRef CVARJoinStreamRadiusPerSecond(
+	TEXT("COOP.JoinStreamRadiusPerSecond"),
+	JoinStreamRadiusPerSecond,
+	TEXT("Growth of the replicated radius around a joining client, bounds how much of the world is sent per second"),
+	ECVF_Default);
+
+
+ACSPlayerState::ACSPlayerState()
+{
+	MatchId = INDEX_NONE;
+
+	JoinTime = -1.0f;
+	TimeToPlayableMs = 0.0f;
+	bReportedPlayable = false;
+}
+
+bool ACSPlayerState::CallRemoteFunction(UFunction* Function, void* Parameters, FOutParmRec* OutParms, FFrame* Stack)
+{
+	FCSRepProfiler::NotifyRemoteFunction(this, Function, Parameters);
+
+	return Super::CallRemoteFunction(Function, Parameters, OutParms, Stack);
+}
+
+bool ACSPlayerState::IsNetRelevantFor(const AActor* RealViewer, const AActor* ViewTarget, const FVector& SrcLocation) const
+{
+	if (!ACSMatchInstance::IsSameMatch(this, RealViewer))
+		return false;
+
+	return Super::IsNetRelevantFor(RealViewer, ViewTarget, SrcLocation);
+}
 
 void ACSPlayerState::AddScore(float ScoreDelta)
 {
 	Score += ScoreDelta;
 }
+
+
+
+#pragma region Join In Progress
+
+void ACSPlayerState::NotifyLoggedIn()
+{
+	JoinTime = GetWorld()->GetRealTimeSeconds();
+	TimeToPlayableMs = 0.0f;
+}
+
+void ACSPlayerState::ReportPlayable()
+{
+	if (bReportedPlayable)
+		return;
+
+	bReportedPlayable = true;
+	ServerReportPlayable();
+}
+
+void ACSPlayerState::ServerReportPlayable_Implementation()
+{
+	if (JoinTime < 0.0f || TimeToPlayableMs > 0.0f)
+		return;
+
+	//Half the ping is the time the report spent on its way back
+	float ElapsedMs = (GetWorld()->GetRealTimeSeconds() - JoinTime) * 1000.0f;
+	TimeToPlayableMs = FMath::Max(ElapsedMs - ExactPing * 0.5f, 0.0f);
+
+	SET_FLOAT_STAT(STAT_JoinTimeToPlayable, TimeToPlayableMs);
+	UE_LOG(LogCoop, Log, TEXT("Join: %s playable after %.0fms (ping %.0fms)."), *GetPlayerName(), TimeToPlayableMs, ExactPing);
+}
+
+bool ACSPlayerState::ServerReportPlayable_Validate()
+{
+	return true;
+}
+
+bool ACSPlayerState::IsStreamingIn() const
+{
+	return JoinTime >= 0.0f && GetWorld()->GetRealTimeSeconds() - JoinTime < JoinStreamDuration;
+}
+
+float ACSPlayerState::GetJoinStreamRadius() const
+{
+	return JoinStreamInitialRadius + JoinStreamRadiusPerSecond * FMath::Max(GetWorld()->GetRealTimeSeconds() - JoinTime, 0.0f);
+}
+
+bool ACSPlayerState::IsJoinStreamRelevant(const AActor* Actor, const AActor* Viewer, const FVector& ViewLocation, float StreamRadius)
+{
+	//The viewer's own pawn and weapon go out first
+	for (const AActor* It = Actor; It; It = It->GetOwner())
+	{
+		if (It == Viewer)
+			return true;
+	}
+
+	return FVector::DistSquared(Actor->GetActorLocation(), ViewLocation) < FMath::Square(StreamRadius);
+}
+
+#pragma endregion Join In Progress
+
+
+
+void ACSPlayerState::GetLifetimeReplicatedProps(TArray< FLifetimeProperty > & OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME(ACSPlayerState, MatchId);
+}
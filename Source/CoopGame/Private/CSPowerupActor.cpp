@@ -2,14 +2,19 @@
 
 
 #include "CSPowerupActor.h"
-#include "TimerManager.h"
+#include "CSNetStats.h"
+#include "CSRepProfiler.h"
+#include "CSActorPool.h"
+#include "CSGameplayScheduler.h"
 #include "Net/UnrealNetwork.h"
 
 // Sets default values
 ACSPowerupActor::ACSPowerupActor()
 {
 	SetReplicates(true);
-	
+	//Dormant while waiting on its pickup, woken up when it is activated and when it expires
+	NetDormancy = DORM_DormantAll;
+
 	bIsPowerupActive = false;
 	PowerupInterval = 0.0f;
 	InstigatorActor = nullptr;
@@ -18,9 +23,17 @@ ACSPowerupActor::ACSPowerupActor()
 	TicksProcessed = 0;
 }
 
+void ACSPowerupActor::BeginPlay()
+{
+	Super::BeginPlay();
+
+	if (Role == ROLE_Authority && !FCSNetStats::IsDormancyEnabled())
+		SetNetDormancy(DORM_Awake);
+}
+
 void ACSPowerupActor::OnRep_PowerupActive()
 {
-	OnPowerupStateChanged(true);
+	OnPowerupStateChanged(bIsPowerupActive);
 }
 
 void ACSPowerupActor::OnTickPowerup()
@@ -32,28 +45,47 @@ void ACSPowerupActor::OnTickPowerup()
 	if (TicksProcessed >= TotalNumOfTicks)
 	{
 		OnExpired();
+		RemoveEffects();
 
+		FlushNetDormancy();
 		bIsPowerupActive = false;
 		InstigatorActor = nullptr;
 		OnRep_PowerupActive();
 
 		//Delete timer
-		GetWorldTimerManager().ClearTimer(TimerHandle_PowerupTick);
+		ACSGameplayScheduler::Get(GetWorld())->ClearTimer(TimerHandle_PowerupTick);
+
+		//The pickup takes its next powerup from the pool
+		if (Role == ROLE_Authority)
+			ACSActorPool::ReleaseToPool(this);
 	}
 }
 
 void ACSPowerupActor::ActivatePowerup(AActor* TriggeringActor)
 {
 	InstigatorActor = TriggeringActor;
+
+	UCSEffectComponent* EffectComp = (Role == ROLE_Authority && TriggeringActor && Effects.Num() > 0) ? TriggeringActor->FindComponentByClass<UCSEffectComponent>() : nullptr;
+	if (EffectComp)
+	{
+		EffectTarget = EffectComp;
+		for (const FCSEffectSpec& Spec : Effects)
+		{
+			int32 EffectId = EffectComp->AddEffect(Spec, this);
+			if (Spec.Duration <= 0.0f && EffectId != INDEX_NONE)
+				PowerupEffectIds.Add(EffectId);
+		}
+	}
 	
 	OnActivated();
+	FlushNetDormancy();
 	bIsPowerupActive = true;
 	//Call it on the server
 	OnRep_PowerupActive();
 
 	if (PowerupInterval > 0.0f)
 	{
-		GetWorldTimerManager().SetTimer(TimerHandle_PowerupTick, this, &ACSPowerupActor::OnTickPowerup, PowerupInterval, true);
+		ACSGameplayScheduler::Get(GetWorld())->SetTimer(TimerHandle_PowerupTick, this, &ACSPowerupActor::OnTickPowerup, PowerupInterval, true);
 	}
 	else
 	{
@@ -61,6 +93,50 @@ void ACSPowerupActor::ActivatePowerup(AActor* TriggeringActor)
 	}
 }
 
+void ACSPowerupActor::Reset()
+{
+	Super::Reset();
+
+	if (Role == ROLE_Authority && (bIsPowerupActive || TicksProcessed > 0))
+		ACSActorPool::ReleaseToPool(this);
+}
+
+void ACSPowerupActor::OnAcquiredFromPool_Implementation()
+{
+	bIsPowerupActive = false;
+	InstigatorActor = nullptr;
+	TicksProcessed = 0;
+}
+
+void ACSPowerupActor::OnReleasedToPool_Implementation()
+{
+	ACSGameplayScheduler::Get(GetWorld())->ClearTimer(TimerHandle_PowerupTick);
+
+	RemoveEffects();
+}
+
+void ACSPowerupActor::RemoveEffects()
+{
+	//Timed effects outlive the powerup and expire on their own
+	UCSEffectComponent* EffectComp = EffectTarget.Get();
+	if (EffectComp)
+	{
+		for (int32 EffectId : PowerupEffectIds)
+			EffectComp->RemoveEffect(EffectId);
+	}
+
+	PowerupEffectIds.Reset();
+	EffectTarget = nullptr;
+}
+
+void ACSPowerupActor::PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker)
+{
+	Super::PreReplication(ChangedPropertyTracker);
+
+	FCSNetStats::NotifyConsidered(this);
+	FCSRepProfiler::NotifyPreReplication(this);
+}
+
 
 void ACSPowerupActor::GetLifetimeReplicatedProps(TArray<FLifetimeProperty> & OutLifetimeProps) const
 {
@@ -2,12 +2,21 @@
 
 
 #include "CSProjectileWeapon.h"
+#include "CoopGame.h"
+#include "CSActorPool.h"
+#include "CSTeamFilter.h"
+#include "Components/PrimitiveComponent.h"
 #include "Components/SkeletalMeshComponent.h"
 #include "Engine/SkeletalMeshSocket.h"
 #include "Kismet/GameplayStatics.h"
 
+
+DECLARE_CYCLE_STAT(TEXT("Projectile Weapon Fire"), STAT_ProjectileWeaponFire, STATGROUP_Coop);
+
 void ACSProjectileWeapon::Fire()
 {
+	COOP_SCOPE_CYCLE_COUNTER(ProjectileWeaponFire);
+
 	APawn* MyPawn = Cast<APawn>(GetOwner());
 	
 	if (MagCount <= 0 && MyPawn->IsLocallyControlled()) return;
@@ -17,12 +26,18 @@ void ACSProjectileWeapon::Fire()
 	{
 		ServerFire();
 	}
+	else
+	{
+		NotifyNetFire();
+	}
 
 	//Trace the world from pawn eyes to crosshair location
 	AActor* MyOwner = GetOwner();
 	if (MyOwner)
 	{
 		MagCount--;
+
+		COOP_INC_COUNTER(Shots);
 		
 		FVector EyeLocation;
 		FRotator EyeRotation;
@@ -45,11 +60,43 @@ void ACSProjectileWeapon::Fire()
 			FActorSpawnParameters ActorSpawnParams;
 			ActorSpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButDontSpawnIfColliding;
 			ActorSpawnParams.Instigator = MyOwner->GetInstigatorController()->GetPawn();
+			ActorSpawnParams.Owner = this;
+
+			//Projectile blueprints implementing CSPoolableActor are recycled, the pool expires them after their InitialLifeSpan
+			AActor* Projectile = ACSActorPool::SpawnPooledActor<AActor>(GetWorld(), ProjectileClass, FTransform(AimDirection, MuzzleLocation), ActorSpawnParams);
 
-			AActor* Projectile = GetWorld()->SpawnActor(ProjectileClass, &MuzzleLocation, &AimDirection, ActorSpawnParams);
+			SpawnedProjectiles.RemoveAll([this](const TWeakObjectPtr<AActor>& SpawnedProjectile) { return !IsOwnProjectile(SpawnedProjectile); });
+			if (Projectile)
+			{
+				SpawnedProjectiles.Add(Projectile);
+
+				//Projectiles fly through teammates, their sweeps skip the team
+				UPrimitiveComponent* ProjectileRoot = Cast<UPrimitiveComponent>(Projectile->GetRootComponent());
+				if (ProjectileRoot)
+					ProjectileRoot->SetMoveIgnoreMask(FCSTeamFilter::GetQueryIgnoreMask(MyOwner));
+			}
 		}
 
 		//Since there is no Trail effect being used by this weapon class, the TracerEnd vector will not be used
 		PlayFireEffects(FVector::ZeroVector);
 	}
 }
+
+void ACSProjectileWeapon::Reset()
+{
+	//Pooled projectiles stay valid, skip the ones that expired or were acquired by another weapon since
+	for (TWeakObjectPtr<AActor>& Projectile : SpawnedProjectiles)
+	{
+		if (IsOwnProjectile(Projectile))
+			ACSActorPool::ReleaseToPool(Projectile.Get());
+	}
+
+	SpawnedProjectiles.Reset();
+
+	Super::Reset();
+}
+
+bool ACSProjectileWeapon::IsOwnProjectile(const TWeakObjectPtr<AActor>& Projectile) const
+{
+	return Projectile.IsValid() && !ACSActorPool::IsPooled(Projectile.Get()) && Projectile->GetOwner() == this;
+}
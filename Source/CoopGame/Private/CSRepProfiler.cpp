@@ -0,0 +1,616 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CSRepProfiler.h"
+#include "GameFramework/Actor.h"
+#include "Components/ActorComponent.h"
+#include "Engine/NetDriver.h"
+#include "Engine/NetConnection.h"
+#include "Engine/ActorChannel.h"
+#include "Net/UnrealNetwork.h"
+#include "UObject/CoreNet.h"
+#include "UObject/UnrealType.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/CommandLine.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+
+static FAutoConsoleCommand CmdRepProfileStart(
+	TEXT("COOP.RepProfile.Start"),
+	TEXT("Start attributing replication bandwidth to classes, properties and RPCs"),
+	FConsoleCommandDelegate::CreateStatic(&FCSRepProfiler::Start));
+
+static FAutoConsoleCommand CmdRepProfileStop(
+	TEXT("COOP.RepProfile.Stop"),
+	TEXT("Stop the replication profiler and write its report. Sorted by Bits, Sends, Changes or Reads"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args) { FCSRepProfiler::Stop(Args.Num() > 0 ? Args[0] : FString()); }));
+
+
+//Object references are sent as net GUIDs, their size depends on the package map
+static const int32 ObjectReferenceBits = 32;
+
+//Bits for the element count of dynamic arrays
+static const int32 ArrayHeaderBits = 16;
+
+static const float FlagMinChangesPerSecond = 1.0f;
+
+static const float FlagMaxReadsPerChange = 0.1f;
+
+static const int32 NumLoggedEntries = 20;
+
+
+// Replicated property of a class, static arrays have one per element
+struct FCSRepPropertyLayout
+{
+	UProperty* Property;
+	int32 ArrayIndex;
+	int32 ShadowOffset;
+	ELifetimeCondition Condition;
+};
+
+struct FCSRepClassLayout
+{
+	TArray<FCSRepPropertyLayout> Properties;
+
+	//Properties in the shadow memory with all of their elements
+	TArray<TPair<UProperty*, int32>> ShadowProperties;
+
+	int32 ShadowSize = 0;
+	int32 ShadowAlignment = 1;
+};
+
+// Values of an object the last time it was measured
+struct FCSRepShadow
+{
+	const FCSRepClassLayout* Layout;
+	uint8* Data;
+
+	//Connections the object was sent to before, new ones get the initial state
+	TArray<TWeakObjectPtr<UNetConnection>> Connections;
+};
+
+struct FCSRepProfileKey
+{
+	//NAME_None for the totals over all connections
+	FName Connection;
+	FName Class;
+	FName Name;
+	bool bRPC;
+
+	bool operator==(const FCSRepProfileKey& Other) const
+	{
+		return Connection == Other.Connection && Class == Other.Class && Name == Other.Name && bRPC == Other.bRPC;
+	}
+
+	friend uint32 GetTypeHash(const FCSRepProfileKey& Key)
+	{
+		return HashCombine(HashCombine(GetTypeHash(Key.Connection), GetTypeHash(Key.Class)), GetTypeHash(Key.Name) ^ (uint32)Key.bRPC);
+	}
+};
+
+struct FCSRepProfileEntry
+{
+	//Totals only, property changes or RPC calls and reads
+	int32 Changes = 0;
+	int32 Reads = 0;
+
+	//Times the property or RPC was sent to connections and its estimated size
+	int32 Sends = 0;
+	int64 Bits = 0;
+
+	//Class of the first object measured, to look up the property's read sites
+	TWeakObjectPtr<const UClass> Class;
+};
+
+
+static bool bProfiling = false;
+
+static double ProfileStartTime = 0.0;
+
+static double LastPruneTime = 0.0;
+
+//Layouts point into the map, it only grows while profiling
+static TMap<const UClass*, TUniquePtr<FCSRepClassLayout>> ClassLayouts;
+
+static TMap<TWeakObjectPtr<const UObject>, FCSRepShadow> Shadows;
+
+static TMap<TWeakObjectPtr<UNetConnection>, FName> ConnectionNames;
+
+static TMap<FCSRepProfileKey, FCSRepProfileEntry> Entries;
+
+//Properties with a COOP_REP_READ site that ran, kept over windows
+static TSet<const UProperty*> InstrumentedReads;
+
+
+// Estimated bits the value of the property takes on the wire
+static int32 EstimateBits(UProperty* Property, const void* Data)
+{
+	if (Property->IsA<UBoolProperty>())
+		return 1;
+
+	if (Property->IsA<UObjectPropertyBase>() || Property->IsA<UInterfaceProperty>())
+		return ObjectReferenceBits;
+
+	if (UArrayProperty* ArrayProperty = Cast<UArrayProperty>(Property))
+	{
+		FScriptArrayHelper ArrayHelper(ArrayProperty, Data);
+
+		int32 Bits = ArrayHeaderBits;
+		for (int32 i = 0; i < ArrayHelper.Num(); i++)
+			Bits += EstimateBits(ArrayProperty->Inner, ArrayHelper.GetRawPtr(i));
+
+		return Bits;
+	}
+
+	if (UStructProperty* StructProperty = Cast<UStructProperty>(Property))
+	{
+		//Native serializers of structs with object references need a package map, sum up the fields instead
+		TArray<const UStructProperty*> EncounteredStructProps;
+		if (!(StructProperty->Struct->StructFlags & STRUCT_NetSerializeNative) || StructProperty->ContainsObjectReference(EncounteredStructProps))
+		{
+			int32 Bits = 0;
+			for (TFieldIterator<UProperty> It(StructProperty->Struct); It; ++It)
+			{
+				if (It->PropertyFlags & CPF_RepSkip)
+					continue;
+
+				for (int32 i = 0; i < It->ArrayDim; i++)
+					Bits += EstimateBits(*It, It->ContainerPtrToValuePtr<void>(Data, i));
+			}
+
+			return Bits;
+		}
+	}
+
+	FNetBitWriter Writer(nullptr, 256);
+	Property->NetSerializeItem(Writer, nullptr, const_cast<void*>(Data));
+
+	return (int32)Writer.GetNumBits();
+}
+
+// Replication conditions that depend on the connection, the owner stands in for the autonomous proxy
+static bool IsConditionMet(ELifetimeCondition Condition, bool bInitial, bool bOwner)
+{
+	switch (Condition)
+	{
+	case COND_InitialOnly:
+		return bInitial;
+	case COND_OwnerOnly:
+	case COND_AutonomousOnly:
+		return bOwner;
+	case COND_SkipOwner:
+	case COND_SimulatedOnly:
+	case COND_SimulatedOnlyNoReplay:
+		return !bOwner;
+	case COND_InitialOrOwner:
+		return bInitial || bOwner;
+	case COND_ReplayOnly:
+		return false;
+	default:
+		return true;
+	}
+}
+
+static const FCSRepClassLayout& GetClassLayout(UObject* Object)
+{
+	UClass* Class = Object->GetClass();
+	if (const TUniquePtr<FCSRepClassLayout>* Found = ClassLayouts.Find(Class))
+		return **Found;
+
+	FCSRepClassLayout& Layout = *ClassLayouts.Add(Class, MakeUnique<FCSRepClassLayout>());
+
+	if (!Class->HasAnyClassFlags(CLASS_ReplicationDataIsSetUp))
+		Class->SetUpRuntimeReplicationData();
+
+	//Only properties registered for replication are sent, not every property marked Replicated
+	TArray<FLifetimeProperty> LifetimeProps;
+	Object->GetLifetimeReplicatedProps(LifetimeProps);
+
+	TMap<UProperty*, int32> ShadowOffsets;
+	for (const FLifetimeProperty& LifetimeProp : LifetimeProps)
+	{
+		if (!Class->ClassReps.IsValidIndex(LifetimeProp.RepIndex))
+			continue;
+
+		const FRepRecord& Record = Class->ClassReps[LifetimeProp.RepIndex];
+		UProperty* Property = Record.Property;
+
+		int32* ShadowOffset = ShadowOffsets.Find(Property);
+		if (ShadowOffset == nullptr)
+		{
+			int32 Alignment = Property->GetMinAlignment();
+			Layout.ShadowSize = Align(Layout.ShadowSize, Alignment);
+			Layout.ShadowAlignment = FMath::Max(Layout.ShadowAlignment, Alignment);
+
+			ShadowOffset = &ShadowOffsets.Add(Property, Layout.ShadowSize);
+			Layout.ShadowProperties.Emplace(Property, Layout.ShadowSize);
+			Layout.ShadowSize += Property->ElementSize * Property->ArrayDim;
+		}
+
+		Layout.Properties.Add({ Property, Record.Index, *ShadowOffset + Record.Index * Property->ElementSize, LifetimeProp.Condition });
+	}
+
+	return Layout;
+}
+
+static void DestroyShadow(FCSRepShadow& Shadow)
+{
+	for (const TPair<UProperty*, int32>& ShadowProperty : Shadow.Layout->ShadowProperties)
+		ShadowProperty.Key->DestroyValue(Shadow.Data + ShadowProperty.Value);
+
+	FMemory::Free(Shadow.Data);
+	Shadow.Data = nullptr;
+}
+
+static void PruneShadows()
+{
+	for (auto It = Shadows.CreateIterator(); It; ++It)
+	{
+		if (!It.Key().IsValid())
+		{
+			DestroyShadow(It.Value());
+			It.RemoveCurrent();
+		}
+	}
+}
+
+static FName GetConnectionName(UNetConnection* Connection)
+{
+	if (const FName* Name = ConnectionNames.Find(Connection))
+		return *Name;
+
+	//Addresses stay the same for the whole connection, player names may arrive later
+	return ConnectionNames.Add(Connection, FName(*Connection->LowLevelGetRemoteAddress(true)));
+}
+
+static FCSRepProfileEntry& GetEntry(FName Connection, const UObject* Object, FName Name, bool bRPC)
+{
+	FCSRepProfileEntry& Entry = Entries.FindOrAdd({ Connection, Object->GetClass()->GetFName(), Name, bRPC });
+	if (!Entry.Class.IsValid())
+		Entry.Class = Object->GetClass();
+
+	return Entry;
+}
+
+// Compares the object against its shadow and attributes what changed to the connections
+static void ProfileObject(UObject* Object, const TArray<UNetConnection*, TInlineAllocator<16>>& Connections, const TArray<bool, TInlineAllocator<16>>& OwnerFlags)
+{
+	const FCSRepClassLayout& Layout = GetClassLayout(Object);
+	if (Layout.Properties.Num() == 0)
+		return;
+
+	FCSRepShadow* Shadow = Shadows.Find(Object);
+	if (Shadow == nullptr)
+	{
+		Shadow = &Shadows.Add(Object);
+		Shadow->Layout = &Layout;
+		Shadow->Data = (uint8*)FMemory::Malloc(FMath::Max(Layout.ShadowSize, 1), Layout.ShadowAlignment);
+
+		for (const TPair<UProperty*, int32>& ShadowProperty : Layout.ShadowProperties)
+		{
+			ShadowProperty.Key->InitializeValue(Shadow->Data + ShadowProperty.Value);
+			ShadowProperty.Key->CopyCompleteValue(Shadow->Data + ShadowProperty.Value, ShadowProperty.Key->ContainerPtrToValuePtr<void>(Object));
+		}
+	}
+
+	TArray<bool, TInlineAllocator<16>> InitialFlags;
+	for (UNetConnection* Connection : Connections)
+	{
+		bool bInitial = !Shadow->Connections.Contains(Connection);
+		if (bInitial)
+			Shadow->Connections.Add(Connection);
+
+		InitialFlags.Add(bInitial);
+	}
+
+	//Initial bunches only carry properties that differ from the archetype
+	UObject* Archetype = Object->GetArchetype();
+
+	for (const FCSRepPropertyLayout& PropertyLayout : Layout.Properties)
+	{
+		UProperty* Property = PropertyLayout.Property;
+		const void* Value = Property->ContainerPtrToValuePtr<void>(Object, PropertyLayout.ArrayIndex);
+		void* ShadowValue = Shadow->Data + PropertyLayout.ShadowOffset;
+
+		bool bChanged = !Property->Identical(ShadowValue, Value);
+		if (bChanged)
+		{
+			Property->CopySingleValue(ShadowValue, Value);
+			GetEntry(NAME_None, Object, Property->GetFName(), false).Changes++;
+		}
+
+		bool bDiffersFromArchetype = Archetype == nullptr || !Property->Identical(Property->ContainerPtrToValuePtr<void>(Archetype, PropertyLayout.ArrayIndex), Value);
+
+		int32 Bits = -1;
+		for (int32 i = 0; i < Connections.Num(); i++)
+		{
+			bool bSend = InitialFlags[i] ? bDiffersFromArchetype : bChanged;
+			if (!bSend || !IsConditionMet(PropertyLayout.Condition, InitialFlags[i], OwnerFlags[i]))
+				continue;
+
+			if (Bits < 0)
+				Bits = EstimateBits(Property, Value);
+
+			FCSRepProfileEntry& Entry = GetEntry(GetConnectionName(Connections[i]), Object, Property->GetFName(), false);
+			Entry.Sends++;
+			Entry.Bits += Bits;
+		}
+	}
+}
+
+static void ProfileActor(AActor* Actor, const TArray<UNetConnection*, TInlineAllocator<16>>& Connections)
+{
+	TArray<bool, TInlineAllocator<16>> OwnerFlags;
+	UNetConnection* OwnerConnection = Actor->GetNetConnection();
+	for (UNetConnection* Connection : Connections)
+		OwnerFlags.Add(Connection == OwnerConnection);
+
+	ProfileObject(Actor, Connections, OwnerFlags);
+
+	for (UActorComponent* Component : Actor->GetReplicatedComponents())
+	{
+		if (Component && Component->GetIsReplicated())
+			ProfileObject(Component, Connections, OwnerFlags);
+	}
+
+	//Destroyed and pooled away objects keep their shadow until they are pruned
+	double Now = FPlatformTime::Seconds();
+	if (Now - LastPruneTime > 10.0)
+	{
+		PruneShadows();
+		LastPruneTime = Now;
+	}
+}
+
+
+
+void FCSRepProfiler::Startup()
+{
+	if (FParse::Param(FCommandLine::Get(), TEXT("RepProfile")))
+		Start();
+}
+
+void FCSRepProfiler::Shutdown()
+{
+	if (bProfiling)
+		Stop();
+}
+
+void FCSRepProfiler::Start()
+{
+	if (bProfiling)
+		Stop();
+
+	Entries.Reset();
+	bProfiling = true;
+	ProfileStartTime = FPlatformTime::Seconds();
+	LastPruneTime = ProfileStartTime;
+
+	UE_LOG(LogCoop, Log, TEXT("RepProfile: Started."));
+}
+
+bool FCSRepProfiler::IsProfiling()
+{
+	return bProfiling;
+}
+
+void FCSRepProfiler::NotifyPreReplication(AActor* Actor)
+{
+	if (!bProfiling || Actor == nullptr)
+		return;
+
+	UNetDriver* NetDriver = Actor->GetNetDriver();
+	if (NetDriver == nullptr || NetDriver->ServerConnection)
+		return;
+
+	//Connections without a channel yet get the initial state once they have one
+	TArray<UNetConnection*, TInlineAllocator<16>> Connections;
+	for (UNetConnection* Connection : NetDriver->ClientConnections)
+	{
+		if (Connection && Connection->FindActorChannelRef(Actor))
+			Connections.Add(Connection);
+	}
+
+	if (Connections.Num() > 0)
+		ProfileActor(Actor, Connections);
+}
+
+void FCSRepProfiler::NotifyPostNetReceive(AActor* Actor)
+{
+	if (!bProfiling || Actor == nullptr)
+		return;
+
+	UNetDriver* NetDriver = Actor->GetNetDriver();
+	if (NetDriver == nullptr || NetDriver->ServerConnection == nullptr)
+		return;
+
+	TArray<UNetConnection*, TInlineAllocator<16>> Connections;
+	Connections.Add(NetDriver->ServerConnection);
+
+	ProfileActor(Actor, Connections);
+}
+
+void FCSRepProfiler::NotifyRemoteFunction(AActor* Actor, UFunction* Function, void* Parameters)
+{
+	if (!bProfiling || Actor == nullptr || Function == nullptr)
+		return;
+
+	UNetDriver* NetDriver = Actor->GetNetDriver();
+	if (NetDriver == nullptr)
+		return;
+
+	//Multicasts go to every connection with a channel, server and client RPCs to the owning connection
+	TArray<UNetConnection*, TInlineAllocator<16>> Connections;
+	if (Function->HasAnyFunctionFlags(FUNC_NetMulticast))
+	{
+		for (UNetConnection* Connection : NetDriver->ClientConnections)
+		{
+			if (Connection && Connection->FindActorChannelRef(Actor))
+				Connections.Add(Connection);
+		}
+	}
+	else if (UNetConnection* OwnerConnection = Actor->GetNetConnection())
+	{
+		Connections.Add(OwnerConnection);
+	}
+
+	GetEntry(NAME_None, Actor, Function->GetFName(), true).Changes++;
+
+	if (Connections.Num() == 0)
+		return;
+
+	int32 Bits = 0;
+	for (TFieldIterator<UProperty> It(Function); It && (It->PropertyFlags & (CPF_Parm | CPF_ReturnParm)) == CPF_Parm; ++It)
+	{
+		for (int32 i = 0; i < It->ArrayDim; i++)
+			Bits += EstimateBits(*It, It->ContainerPtrToValuePtr<void>(Parameters, i));
+	}
+
+	for (UNetConnection* Connection : Connections)
+	{
+		FCSRepProfileEntry& Entry = GetEntry(GetConnectionName(Connection), Actor, Function->GetFName(), true);
+		Entry.Sends++;
+		Entry.Bits += Bits;
+	}
+}
+
+void FCSRepProfiler::NotifyRead(const UObject* Object, FName PropertyName)
+{
+	if (bProfiling && Object)
+		GetEntry(NAME_None, Object, PropertyName, false).Reads++;
+}
+
+void FCSRepProfiler::RegisterReadSite(const UClass* Class, FName PropertyName)
+{
+	if (UProperty* Property = FindField<UProperty>(Class, PropertyName))
+		InstrumentedReads.Add(Property);
+}
+
+// Returns true if a COOP_REP_READ site counts reads of the property
+static bool IsReadInstrumented(const FCSRepProfileEntry& Entry, FName PropertyName)
+{
+	const UClass* Class = Entry.Class.Get();
+	UProperty* Property = Class ? FindField<UProperty>(Class, PropertyName) : nullptr;
+
+	return Property && InstrumentedReads.Contains(Property);
+}
+
+void FCSRepProfiler::Stop(const FString& SortBy)
+{
+	if (!bProfiling)
+	{
+		UE_LOG(LogCoop, Warning, TEXT("RepProfile: Not running, start it with COOP.RepProfile.Start."));
+		return;
+	}
+
+	bProfiling = false;
+	float Duration = FMath::Max((float)(FPlatformTime::Seconds() - ProfileStartTime), KINDA_SMALL_NUMBER);
+
+	//Sum up the connections into the totals
+	TArray<TPair<FCSRepProfileKey, FCSRepProfileEntry>> ConnectionEntries;
+	for (const TPair<FCSRepProfileKey, FCSRepProfileEntry>& Entry : Entries)
+	{
+		if (Entry.Key.Connection != NAME_None)
+			ConnectionEntries.Add(Entry);
+	}
+
+	for (const TPair<FCSRepProfileKey, FCSRepProfileEntry>& Entry : ConnectionEntries)
+	{
+		FCSRepProfileKey TotalKey = Entry.Key;
+		TotalKey.Connection = NAME_None;
+
+		FCSRepProfileEntry& Total = Entries.FindOrAdd(TotalKey);
+		Total.Sends += Entry.Value.Sends;
+		Total.Bits += Entry.Value.Bits;
+
+		if (!Total.Class.IsValid())
+			Total.Class = Entry.Value.Class;
+	}
+
+	struct FReportRow
+	{
+		FCSRepProfileKey Key;
+		FCSRepProfileEntry Entry;
+		float ReadsPerChange;
+		bool bReadInstrumented;
+		bool bFlagged;
+	};
+
+	TArray<FReportRow> Rows;
+	for (const TPair<FCSRepProfileKey, FCSRepProfileEntry>& Entry : Entries)
+	{
+		//Connection rows show the changes and reads of the totals
+		FCSRepProfileKey TotalKey = Entry.Key;
+		TotalKey.Connection = NAME_None;
+		const FCSRepProfileEntry& Total = Entries.FindChecked(TotalKey);
+
+		FReportRow Row;
+		Row.Key = Entry.Key;
+		Row.Entry = Entry.Value;
+		Row.Entry.Changes = Total.Changes;
+		Row.Entry.Reads = Total.Reads;
+		Row.ReadsPerChange = Total.Changes > 0 ? Total.Reads / (float)Total.Changes : 0.0f;
+		Row.bReadInstrumented = !Entry.Key.bRPC && IsReadInstrumented(Total, Entry.Key.Name);
+
+		//Without a read site the read count says nothing, engine and blueprint reads are not seen
+		Row.bFlagged = Row.bReadInstrumented && Total.Changes / Duration > FlagMinChangesPerSecond && Row.ReadsPerChange < FlagMaxReadsPerChange;
+
+		Rows.Add(Row);
+	}
+
+	Rows.Sort([&SortBy](const FReportRow& A, const FReportRow& B)
+	{
+		if (SortBy == TEXT("Sends"))
+			return A.Entry.Sends > B.Entry.Sends;
+		if (SortBy == TEXT("Changes"))
+			return A.Entry.Changes > B.Entry.Changes;
+		if (SortBy == TEXT("Reads"))
+			return A.Entry.Reads > B.Entry.Reads;
+
+		return A.Entry.Bits > B.Entry.Bits;
+	});
+
+	FString Report = TEXT("Connection,Class,Kind,Name,Changes,ChangesPerSec,ReadsInstrumented,Reads,ReadsPerChange,Sends,Bits,KBps,ChangesOftenRarelyRead\n");
+	for (const FReportRow& Row : Rows)
+	{
+		Report += FString::Printf(TEXT("%s,%s,%s,%s,%d,%.2f,%d,%d,%.3f,%d,%lld,%.3f,%d\n"),
+			Row.Key.Connection == NAME_None ? TEXT("All") : *Row.Key.Connection.ToString(), *Row.Key.Class.ToString(),
+			Row.Key.bRPC ? TEXT("RPC") : TEXT("Property"), *Row.Key.Name.ToString(),
+			Row.Entry.Changes, Row.Entry.Changes / Duration, Row.bReadInstrumented ? 1 : 0, Row.Entry.Reads, Row.ReadsPerChange,
+			Row.Entry.Sends, Row.Entry.Bits, Row.Entry.Bits / 8.0f / 1024.0f / Duration, Row.bFlagged ? 1 : 0);
+	}
+
+	UE_LOG(LogCoop, Log, TEXT("RepProfile: %.1fs profiled, most expensive over all connections:"), Duration);
+
+	int32 NumLogged = 0;
+	for (const FReportRow& Row : Rows)
+	{
+		if (Row.Key.Connection != NAME_None)
+			continue;
+
+		FString Reads = Row.Key.bRPC ? FString() : Row.bReadInstrumented ? FString::Printf(TEXT(", %.2f reads/change"), Row.ReadsPerChange) : FString(TEXT(", reads not instrumented"));
+
+		UE_LOG(LogCoop, Log, TEXT("RepProfile: %s.%s%s %.2fKB/s, %d sends, %.1f changes/s%s%s"),
+			*Row.Key.Class.ToString(), *Row.Key.Name.ToString(), Row.Key.bRPC ? TEXT("()") : TEXT(""),
+			Row.Entry.Bits / 8.0f / 1024.0f / Duration, Row.Entry.Sends, Row.Entry.Changes / Duration, *Reads,
+			Row.bFlagged ? TEXT(" - changes often, rarely read") : TEXT(""));
+
+		if (++NumLogged >= NumLoggedEntries)
+			break;
+	}
+
+	FString ReportPath = FPaths::ProjectSavedDir() / TEXT("RepProfile") / FString::Printf(TEXT("RepProfile-%s.csv"), *FDateTime::Now().ToString());
+	if (FFileHelper::SaveStringToFile(Report, *ReportPath))
+		UE_LOG(LogCoop, Log, TEXT("RepProfile: Report written to %s"), *ReportPath);
+	else
+		UE_LOG(LogCoop, Error, TEXT("RepProfile: Failed to write report to %s"), *ReportPath);
+
+	for (TPair<TWeakObjectPtr<const UObject>, FCSRepShadow>& Shadow : Shadows)
+		DestroyShadow(Shadow.Value);
+
+	Shadows.Empty();
+	ClassLayouts.Empty();
+	ConnectionNames.Empty();
+	Entries.Empty();
+}
@@ -0,0 +1,413 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CSReplicationGraph.h"
+#include "CSGameMode.h"
+#include "CSMatchInstance.h"
+#include "CSPlayerState.h"
+#include "CSWeapon.h"
+#include "CSPickupActor.h"
+#include "CSPowerupActor.h"
+#include "CSExplosiveActor.h"
+#include "AI/CSTrackerBot.h"
+#include "Engine/LevelScriptActor.h"
+#include "Engine/NetDriver.h"
+#include "Engine/World.h"
+#include "GameFramework/GameStateBase.h"
+#include "GameFramework/Info.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/PlayerState.h"
+#include "GameFramework/Pawn.h"
+#include "ReplicationGraphTypes.h"
+#include "UObject/UObjectIterator.h"
+
+
+static float RepGraphCellSize = 10000.0f;
+FAutoConsoleVariableRef CVARRepGraphCellSize(
+	TEXT("COOP.RepGraph.CellSize"),
+	RepGraphCellSize,
+	TEXT("Cell size of the replication graph's spatial grid. Only read when the graph is created"),
+	ECVF_Default);
+
+static float RepGraphSpatialBias = -150000.0f;
+FAutoConsoleVariableRef CVARRepGraphSpatialBias(
+	TEXT("COOP.RepGraph.SpatialBias"),
+	RepGraphSpatialBias,
+	TEXT("World X and Y the spatial grid starts at. Actors below it are clamped into the first cell"),
+	ECVF_Default);
+
+static int32 RepGraphDisableSpatialRebuilds = 1;
+FAutoConsoleVariableRef CVARRepGraphDisableSpatialRebuilds(
+	TEXT("COOP.RepGraph.DisableSpatialRebuilds"),
+	RepGraphDisableSpatialRebuilds,
+	TEXT("Clamp actors outside the spatial grid instead of rebuilding it"),
+	ECVF_Default);
+
+
+UCSReplicationGraph::UCSReplicationGraph()
+{
+	GridNode = nullptr;
+	AlwaysRelevantNode = nullptr;
+}
+
+
+
+#pragma region Class Settings
+
+void UCSReplicationGraph::InitGlobalActorClassSettings()
+{
+	Super::InitGlobalActorClassSettings();
+
+	auto AddPolicy = [&](UClass* Class, ECSClassRepNodeMapping Mapping) { ClassRepNodePolicies.Set(Class, Mapping); };
+
+	//Weapons replicate as dependents of their character, match instances and player states through the connection nodes of their match
+	AddPolicy(ACSWeapon::StaticClass(), ECSClassRepNodeMapping::NotRouted);
+	AddPolicy(ACSMatchInstance::StaticClass(), ECSClassRepNodeMapping::NotRouted);
+	AddPolicy(APlayerState::StaticClass(), ECSClassRepNodeMapping::NotRouted);
+	AddPolicy(ALevelScriptActor::StaticClass(), ECSClassRepNodeMapping::NotRouted);
+	AddPolicy(AReplicationGraphDebugActor::StaticClass(), ECSClassRepNodeMapping::NotRouted);
+
+	//Game state
+	AddPolicy(AInfo::StaticClass(), ECSClassRepNodeMapping::RelevantAllConnections);
+
+	//Placed in the level and unchanged most of the time, pooled bots are dormant
+	AddPolicy(ACSPickupActor::StaticClass(), ECSClassRepNodeMapping::Spatialize_Dormancy);
+	AddPolicy(ACSPowerupActor::StaticClass(), ECSClassRepNodeMapping::Spatialize_Dormancy);
+	AddPolicy(ACSExplosiveActor::StaticClass(), ECSClassRepNodeMapping::Spatialize_Dormancy);
+	AddPolicy(ACSTrackerBot::StaticClass(), ECSClassRepNodeMapping::Spatialize_Dormancy);
+
+	//Everything else is routed by its legacy relevancy settings
+	TArray<UClass*> AllReplicatedClasses;
+
+	for (TObjectIterator<UClass> It; It; ++It)
+	{
+		UClass* Class = *It;
+		AActor* ActorCDO = Cast<AActor>(Class->GetDefaultObject());
+		if (ActorCDO == nullptr || !ActorCDO->GetIsReplicated())
+			continue;
+
+		//Skip Blueprint skeleton and reinstanced classes
+		if (Class->GetName().StartsWith(TEXT("SKEL_")) || Class->GetName().StartsWith(TEXT("REINST_")))
+			continue;
+
+		AllReplicatedClasses.Add(Class);
+
+		if (ClassRepNodePolicies.Contains(Class, false))
+			continue;
+
+		//Subclasses with the same settings as their parent use its policy
+		AActor* SuperCDO = Cast<AActor>(Class->GetSuperClass()->GetDefaultObject());
+		if (SuperCDO && SuperCDO->GetIsReplicated()
+			&& SuperCDO->bAlwaysRelevant == ActorCDO->bAlwaysRelevant
+			&& SuperCDO->bOnlyRelevantToOwner == ActorCDO->bOnlyRelevantToOwner
+			&& SuperCDO->bNetUseOwnerRelevancy == ActorCDO->bNetUseOwnerRelevancy)
+		{
+			continue;
+		}
+
+		if (!ActorCDO->bAlwaysRelevant && !ActorCDO->bOnlyRelevantToOwner && !ActorCDO->bNetUseOwnerRelevancy)
+			AddPolicy(Class, ECSClassRepNodeMapping::Spatialize_Dynamic);
+		else if (ActorCDO->bAlwaysRelevant && !ActorCDO->bOnlyRelevantToOwner)
+			AddPolicy(Class, ECSClassRepNodeMapping::RelevantAllConnections);
+	}
+
+	//Update rate and cull distance come from the class defaults, player states are sent regardless of distance
+	FClassReplicationInfo PlayerStateRepInfo;
+	PlayerStateRepInfo.DistancePriorityScale = 0.0f;
+	PlayerStateRepInfo.ActorChannelFrameTimeout = 0;
+	GlobalActorReplicationInfoMap.SetClassInfo(APlayerState::StaticClass(), PlayerStateRepInfo);
+
+	for (UClass* ReplicatedClass : AllReplicatedClasses)
+	{
+		if (ReplicatedClass->IsChildOf(APlayerState::StaticClass()))
+			continue;
+
+		FClassReplicationInfo ClassInfo;
+		InitClassReplicationInfo(ClassInfo, ReplicatedClass, IsSpatialized(GetMappingPolicy(ReplicatedClass)), NetDriver->NetServerMaxTickRate);
+		GlobalActorReplicationInfoMap.SetClassInfo(ReplicatedClass, ClassInfo);
+	}
+}
+
+void UCSReplicationGraph::InitClassReplicationInfo(FClassReplicationInfo& Info, UClass* Class, bool bSpatialize, float ServerMaxTickRate) const
+{
+	AActor* CDO = Class->GetDefaultObject<AActor>();
+
+	if (bSpatialize)
+		Info.CullDistanceSquared = CDO->NetCullDistanceSquared;
+
+	Info.ReplicationPeriodFrame = FMath::Max<uint32>((uint32)FMath::RoundToFloat(ServerMaxTickRate / CDO->NetUpdateFrequency), 1);
+}
+
+ECSClassRepNodeMapping UCSReplicationGraph::GetMappingPolicy(UClass* Class)
+{
+	ECSClassRepNodeMapping* Policy = ClassRepNodePolicies.Get(Class);
+	return Policy ? *Policy : ECSClassRepNodeMapping::NotRouted;
+}
+
+#pragma endregion Class Settings
+
+
+
+void UCSReplicationGraph::InitGlobalGraphNodes()
+{
+	PreAllocateRepList(3, 12);
+	PreAllocateRepList(6, 12);
+	PreAllocateRepList(128, 64);
+	PreAllocateRepList(512, 16);
+
+	GridNode = CreateNewNode<UCSReplicationGraphNode_MatchGrid>();
+	GridNode->CellSize = RepGraphCellSize;
+	GridNode->SpatialBias = FVector2D(RepGraphSpatialBias, RepGraphSpatialBias);
+
+	if (RepGraphDisableSpatialRebuilds)
+		GridNode->AddSpatialRebuildBlacklistClass(AActor::StaticClass());
+
+	AddGlobalGraphNode(GridNode);
+
+	AlwaysRelevantNode = CreateNewNode<UReplicationGraphNode_ActorList>();
+	AddGlobalGraphNode(AlwaysRelevantNode);
+}
+
+void UCSReplicationGraph::InitConnectionGraphNodes(UNetReplicationGraphConnection* RepGraphConnection)
+{
+	Super::InitConnectionGraphNodes(RepGraphConnection);
+
+	UCSReplicationGraphNode_AlwaysRelevant_ForConnection* AlwaysRelevantConnectionNode = CreateNewNode<UCSReplicationGraphNode_AlwaysRelevant_ForConnection>();
+	AddConnectionGraphNode(AlwaysRelevantConnectionNode, RepGraphConnection);
+}
+
+
+
+void UCSReplicationGraph::RouteAddNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo, FGlobalActorReplicationInfo& GlobalInfo)
+{
+	//Weapons are spawned with their character as owner
+	if (ACSWeapon* Weapon = Cast<ACSWeapon>(ActorInfo.Actor))
+		AddDependentActor(Weapon->GetOwner(), Weapon);
+
+	switch (GetMappingPolicy(ActorInfo.Class))
+	{
+	case ECSClassRepNodeMapping::RelevantAllConnections:
+		AlwaysRelevantNode->NotifyAddNetworkActor(ActorInfo);
+		break;
+
+	case ECSClassRepNodeMapping::Spatialize_Static:
+		GridNode->AddActor_Static(ActorInfo, GlobalInfo);
+		break;
+
+	case ECSClassRepNodeMapping::Spatialize_Dynamic:
+		GridNode->AddActor_Dynamic(ActorInfo, GlobalInfo);
+		break;
+
+	case ECSClassRepNodeMapping::Spatialize_Dormancy:
+		GridNode->AddActor_Dormancy(ActorInfo, GlobalInfo);
+		break;
+
+	default:
+		break;
+	}
+}
+
+void UCSReplicationGraph::RouteRemoveNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo)
+{
+	if (ACSWeapon* Weapon = Cast<ACSWeapon>(ActorInfo.Actor))
+		RemoveDependentActor(Weapon->GetOwner(), Weapon);
+
+	switch (GetMappingPolicy(ActorInfo.Class))
+	{
+	case ECSClassRepNodeMapping::RelevantAllConnections:
+		AlwaysRelevantNode->NotifyRemoveNetworkActor(ActorInfo);
+		break;
+
+	case ECSClassRepNodeMapping::Spatialize_Static:
+		GridNode->RemoveActor_Static(ActorInfo);
+		break;
+
+	case ECSClassRepNodeMapping::Spatialize_Dynamic:
+		GridNode->RemoveActor_Dynamic(ActorInfo);
+		break;
+
+	case ECSClassRepNodeMapping::Spatialize_Dormancy:
+		GridNode->RemoveActor_Dormancy(ActorInfo);
+		break;
+
+	default:
+		break;
+	}
+}
+
+void UCSReplicationGraph::AddDependentActor(AActor* Parent, AActor* Child)
+{
+	if (Parent == nullptr || Child == nullptr)
+		return;
+
+	FGlobalActorReplicationInfo& ParentInfo = GlobalActorReplicationInfoMap.Get(Parent);
+	ParentInfo.DependentActorList.PrepareForWrite();
+
+	if (!ParentInfo.DependentActorList.Contains(Child))
+		ParentInfo.DependentActorList.Add(Child);
+}
+
+void UCSReplicationGraph::RemoveDependentActor(AActor* Parent, AActor* Child)
+{
+	if (Parent == nullptr || Child == nullptr)
+		return;
+
+	FGlobalActorReplicationInfo* ParentInfo = GlobalActorReplicationInfoMap.Find(Parent);
+	if (ParentInfo)
+	{
+		ParentInfo->DependentActorList.PrepareForWrite();
+		ParentInfo->DependentActorList.Remove(Child);
+	}
+}
+
+void UCSReplicationGraph::SetActorNetUpdateFrequency(AActor* Actor, float NewFrequency)
+{
+	if (Actor == nullptr || NewFrequency <= 0.0f || Actor->NetUpdateFrequency == NewFrequency)
+		return;
+
+	Actor->NetUpdateFrequency = NewFrequency;
+
+	UNetDriver* NetDriver = Actor->GetNetDriver();
+	UCSReplicationGraph* Graph = NetDriver ? Cast<UCSReplicationGraph>(NetDriver->GetReplicationDriver()) : nullptr;
+	if (Graph == nullptr)
+		return;
+
+	FGlobalActorReplicationInfo* GlobalInfo = Graph->GlobalActorReplicationInfoMap.Find(Actor);
+	if (GlobalInfo)
+		GlobalInfo->Settings.ReplicationPeriodFrame = FMath::Max<uint32>((uint32)FMath::RoundToFloat(NetDriver->NetServerMaxTickRate / NewFrequency), 1);
+}
+
+void UCSReplicationGraph::NotifyDependentOwnerChanged(AActor* Actor, AActor* OldOwner)
+{
+	UNetDriver* NetDriver = Actor ? Actor->GetNetDriver() : nullptr;
+	UCSReplicationGraph* Graph = NetDriver ? Cast<UCSReplicationGraph>(NetDriver->GetReplicationDriver()) : nullptr;
+	if (Graph == nullptr)
+		return;
+
+	Graph->RemoveDependentActor(OldOwner, Actor);
+	Graph->AddDependentActor(Actor->GetOwner(), Actor);
+}
+
+
+
+#pragma region Match Grid
+
+UCSReplicationGraphNode_MatchGrid::UCSReplicationGraphNode_MatchGrid()
+{
+	ViewerMatchId = INDEX_NONE;
+	JoinStreamRadius = 0.0f;
+}
+
+void UCSReplicationGraphNode_MatchGrid::GatherActorListsForConnection(const FConnectionGatherActorListParameters& Params)
+{
+	ViewerMatchId = ACSMatchInstance::FindMatchId(Params.Viewer.InViewer);
+
+	APlayerController* PC = Cast<APlayerController>(Params.Viewer.InViewer);
+	ACSPlayerState* PS = PC ? Cast<ACSPlayerState>(PC->PlayerState) : nullptr;
+	JoinStreamRadius = PS && PS->IsStreamingIn() ? PS->GetJoinStreamRadius() : 0.0f;
+
+	if (ViewerMatchId == INDEX_NONE && JoinStreamRadius <= 0.0f)
+	{
+		Super::GatherActorListsForConnection(Params);
+		return;
+	}
+
+	OtherArenaTags.Reset();
+
+	ACSGameMode* GM = GraphGlobals->World ? GraphGlobals->World->GetAuthGameMode<ACSGameMode>() : nullptr;
+	for (int32 i = 0; GM && i < GM->GetNumMatches(); i++)
+	{
+		ACSMatchInstance* Match = GM->GetMatch(i);
+		if (Match && i != ViewerMatchId && Match->GetArenaTag() != NAME_None)
+			OtherArenaTags.Add(Match->GetArenaTag());
+	}
+
+	GridLists.Reset();
+
+	FConnectionGatherActorListParameters GridParams(Params.Viewer, Params.ConnectionManager, Params.ClientVisibleLevelNamesRef, Params.ReplicationFrameNum, GridLists);
+	Super::GatherActorListsForConnection(GridParams);
+
+	ReplicationActorList.Reset();
+
+	for (const auto& List : GridLists.GetLists(EActorRepListTypeFlags::Default))
+	{
+		for (int32 i = 0; i < List.Num(); i++)
+		{
+			if (IsRelevantForConnection(List[i], Params))
+				ReplicationActorList.Add(List[i]);
+		}
+	}
+
+	Params.OutGatheredReplicationLists.AddReplicationActorList(ReplicationActorList);
+}
+
+bool UCSReplicationGraphNode_MatchGrid::IsRelevantForConnection(const AActor* Actor, const FConnectionGatherActorListParameters& Params) const
+{
+	if (JoinStreamRadius > 0.0f && !ACSPlayerState::IsJoinStreamRelevant(Actor, Params.Viewer.InViewer, Params.Viewer.ViewLocation, JoinStreamRadius))
+		return false;
+
+	if (ViewerMatchId == INDEX_NONE)
+		return true;
+
+	int32 MatchId = ACSMatchInstance::FindMatchId(Actor);
+	if (MatchId != INDEX_NONE)
+		return MatchId == ViewerMatchId;
+
+	//Pickups, barrels and other level actors of another arena
+	for (const FName& Tag : Actor->Tags)
+	{
+		if (OtherArenaTags.Contains(Tag))
+			return false;
+	}
+
+	return true;
+}
+
+#pragma endregion Match Grid
+
+
+
+#pragma region Connection Node
+
+void UCSReplicationGraphNode_AlwaysRelevant_ForConnection::GatherActorListsForConnection(const FConnectionGatherActorListParameters& Params)
+{
+	ReplicationActorList.Reset();
+
+	ReplicationActorList.ConditionalAdd(Params.Viewer.InViewer);
+	ReplicationActorList.ConditionalAdd(Params.Viewer.ViewTarget);
+
+	APlayerController* PC = Cast<APlayerController>(Params.Viewer.InViewer);
+	if (PC)
+	{
+		//The pawn is relevant even while the viewer looks through another actor
+		if (PC->GetPawn() && PC->GetPawn() != Params.Viewer.ViewTarget)
+			ReplicationActorList.ConditionalAdd(PC->GetPawn());
+
+		ACSGameMode* GM = PC->GetWorld()->GetAuthGameMode<ACSGameMode>();
+		if (GM)
+			ReplicationActorList.ConditionalAdd(GM->GetMatchForController(PC));
+	}
+
+	//Players of other matches stay out of the player array and scoreboard, players without a match are seen by everyone
+	AGameStateBase* GameState = GraphGlobals->World ? GraphGlobals->World->GetGameState() : nullptr;
+	if (GameState)
+	{
+		for (APlayerState* PlayerState : GameState->PlayerArray)
+		{
+			if (ACSMatchInstance::IsSameMatch(Params.Viewer.InViewer, PlayerState))
+				ReplicationActorList.ConditionalAdd(PlayerState);
+		}
+	}
+
+	Params.OutGatheredReplicationLists.AddReplicationActorList(ReplicationActorList);
+}
+
+void UCSReplicationGraphNode_AlwaysRelevant_ForConnection::LogNode(FReplicationGraphDebugInfo& DebugInfo, const FString& NodeName) const
+{
+	DebugInfo.Log(NodeName);
+	DebugInfo.PushIndent();
+	LogActorRepList(DebugInfo, NodeName, ReplicationActorList);
+	DebugInfo.PopIndent();
+}
+
+#pragma endregion Connection Node
@@ -0,0 +1,184 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CSTeamFilter.h"
+#include "CoopGame.h"
+#include "Components/CSHealthComponent.h"
+#include "Components/PrimitiveComponent.h"
+#include "GameFramework/Actor.h"
+#include "GameFramework/DamageType.h"
+#include "Engine/World.h"
+#include "CollisionQueryParams.h"
+#include "WorldCollision.h"
+#include "CSFrameScratch.h"
+#include "Algo/Sort.h"
+
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Friendly Events Discarded"), STAT_FriendlyEventsDiscarded, STATGROUP_Coop);
+
+static int32 TeamCollisionFilter = 1;
+FAutoConsoleVariableRef CVARTeamCollisionFilter(
+	TEXT("COOP.TeamCollisionFilter"),
+	TeamCollisionFilter,
+	TEXT("Let weapon traces, radial damage and bot triggers skip friendlies in the query itself"),
+	ECVF_Default);
+
+static int32 LogFriendlyDiscards = 0;
+FAutoConsoleVariableRef CVARLogFriendlyDiscards(
+	TEXT("COOP.LogFriendlyDiscards"),
+	LogFriendlyDiscards,
+	TEXT("Log per source how many friendly events were discarded per minute"),
+	ECVF_Default);
+
+
+TMap<FName, int32> FCSTeamFilter::DiscardCounts;
+
+double FCSTeamFilter::CountStartTime = 0.0;
+
+
+FMaskFilter FCSTeamFilter::GetTeamMask(uint8 TeamNum)
+{
+	//The physics scene keeps only a few bits for the mask filter
+	return TeamNum < NumExtraFilterBits ? (FMaskFilter)(1 << TeamNum) : 0;
+}
+
+FMaskFilter FCSTeamFilter::GetTeamMask(const AActor* Actor)
+{
+	if (Actor == nullptr)
+		return 0;
+
+	UCSHealthComponent* HealthComp = Cast<UCSHealthComponent>(Actor->GetComponentByClass(UCSHealthComponent::StaticClass()));
+	return HealthComp ? GetTeamMask(HealthComp->TeamNum) : 0;
+}
+
+FMaskFilter FCSTeamFilter::GetQueryIgnoreMask(const AActor* Actor)
+{
+	return IsEnabled() ? GetTeamMask(Actor) : 0;
+}
+
+void FCSTeamFilter::ApplyTeamMask(AActor* Actor, FMaskFilter TeamMask)
+{
+	if (Actor == nullptr)
+		return;
+
+	TInlineComponentArray<UPrimitiveComponent*> Primitives(Actor);
+	for (UPrimitiveComponent* Primitive : Primitives)
+		Primitive->SetMaskFilterOnBodyInstance(TeamMask);
+}
+
+bool FCSTeamFilter::IsEnabled()
+{
+	return TeamCollisionFilter != 0;
+}
+
+
+
+// Same test as the engine's radial damage, the line of sight to the component decides
+static bool IsComponentDamageableFrom(UPrimitiveComponent* VictimComp, const FVector& Origin, const FCollisionQueryParams& LineParams, ECollisionChannel TraceChannel, FHitResult& OutHitResult)
+{
+	FVector TraceStart = Origin;
+	FVector TraceEnd = VictimComp->Bounds.Origin;
+	if (TraceStart == TraceEnd)
+		TraceStart.Z += 0.01f;
+
+	COOP_INC_COUNTER(Traces);
+	if (VictimComp->GetWorld()->LineTraceSingleByChannel(OutHitResult, TraceStart, TraceEnd, TraceChannel, LineParams))
+		return OutHitResult.Component == VictimComp;
+
+	//Nothing in between, make up a hit on the component
+	FVector FakeHitLocation = VictimComp->GetComponentLocation();
+	OutHitResult = FHitResult(VictimComp->GetOwner(), VictimComp, FakeHitLocation, (Origin - FakeHitLocation).GetSafeNormal());
+	return true;
+}
+
+bool FCSTeamFilter::ApplyRadialDamage(AActor* DamageCauser, float BaseDamage, const FVector& Origin, float DamageRadius, TSubclassOf<UDamageType> DamageTypeClass,
+	TArrayView<AActor* const> IgnoreActors, AController* InstigatedByController, bool bDoFullDamage, ECollisionChannel DamagePreventionChannel)
+{
+	UWorld* World = DamageCauser ? DamageCauser->GetWorld() : nullptr;
+	if (World == nullptr)
+		return false;
+
+	FCollisionQueryParams SphereParams(SCENE_QUERY_STAT(CoopRadialDamage), false, DamageCauser);
+	FCollisionQueryParams LineParams(SCENE_QUERY_STAT(CoopRadialDamageVisibility), true, DamageCauser);
+	for (AActor* IgnoreActor : IgnoreActors)
+	{
+		SphereParams.AddIgnoredActor(IgnoreActor);
+		LineParams.AddIgnoredActor(IgnoreActor);
+	}
+
+	SphereParams.IgnoreMask = GetQueryIgnoreMask(DamageCauser);
+
+	//Only called on the game thread, the overlap results keep their memory between calls
+	static TArray<FOverlapResult> Overlaps;
+	Overlaps.Reset();
+
+	World->OverlapMultiByObjectType(Overlaps, Origin, FQuat::Identity, FCollisionObjectQueryParams(FCollisionObjectQueryParams::InitType::AllDynamicObjects),
+		FCollisionShape::MakeSphere(DamageRadius), SphereParams);
+
+	//Every actor takes the damage once, with the hits on all its components
+	TCSFrameArray<TPair<AActor*, FHitResult>> ComponentHits;
+	for (const FOverlapResult& Overlap : Overlaps)
+	{
+		AActor* OverlapActor = Overlap.GetActor();
+		UPrimitiveComponent* OverlapComp = Overlap.Component.Get();
+		if (OverlapActor == nullptr || OverlapComp == nullptr || !OverlapActor->bCanBeDamaged || OverlapActor == DamageCauser)
+			continue;
+
+		FHitResult Hit;
+		if (IsComponentDamageableFrom(OverlapComp, Origin, LineParams, DamagePreventionChannel, Hit))
+			ComponentHits.Emplace(OverlapActor, Hit);
+	}
+
+	//Hits of an actor end up next to each other
+	Algo::SortBy(ComponentHits, [](const TPair<AActor*, FHitResult>& ComponentHit) { return ComponentHit.Key; });
+
+	FRadialDamageEvent DamageEvent;
+	DamageEvent.DamageTypeClass = DamageTypeClass ? DamageTypeClass : TSubclassOf<UDamageType>(UDamageType::StaticClass());
+	DamageEvent.Origin = Origin;
+	DamageEvent.Params = FRadialDamageParams(BaseDamage, 0.0f, 0.0f, DamageRadius, bDoFullDamage ? 0.0f : 1.0f);
+
+	for (int32 Start = 0; Start < ComponentHits.Num();)
+	{
+		AActor* Victim = ComponentHits[Start].Key;
+
+		//The damage event has to hold the hits in a regular array
+		DamageEvent.ComponentHits.Reset();
+		int32 End = Start;
+		for (; End < ComponentHits.Num() && ComponentHits[End].Key == Victim; End++)
+			DamageEvent.ComponentHits.Add(ComponentHits[End].Value);
+
+		Victim->TakeDamage(BaseDamage, DamageEvent, InstigatedByController, DamageCauser);
+		Start = End;
+	}
+
+	return ComponentHits.Num() > 0;
+}
+
+
+
+void FCSTeamFilter::NotifyFriendlyDiscarded(FName Source)
+{
+	INC_DWORD_STAT(STAT_FriendlyEventsDiscarded);
+
+	if (LogFriendlyDiscards == 0)
+		return;
+
+	DiscardCounts.FindOrAdd(Source)++;
+
+	double Now = FPlatformTime::Seconds();
+	if (CountStartTime <= 0.0)
+		CountStartTime = Now;
+	else if (Now - CountStartTime >= 60.0)
+		LogDiscardCounts(Now);
+}
+
+void FCSTeamFilter::LogDiscardCounts(double Now)
+{
+	float Minutes = (float)(Now - CountStartTime) / 60.0f;
+
+	for (const TPair<FName, int32>& Count : DiscardCounts)
+		UE_LOG(LogCoop, Log, TEXT("Team: %s discarded %.1f friendly events/min (filter %s)"), *Count.Key.ToString(), Count.Value / Minutes, IsEnabled() ? TEXT("on") : TEXT("off"));
+
+	DiscardCounts.Reset();
+	CountStartTime = Now;
+}
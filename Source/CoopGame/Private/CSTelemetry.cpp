@@ -0,0 +1,264 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CSTelemetry.h"
+#include "CoopGame.h"
+#include "CSMatchInstance.h"
+#include "GameFramework/Actor.h"
+#include "Engine/World.h"
+#include "Async/Async.h"
+#include "HAL/PlatformFilemanager.h"
+#include "Misc/CoreDelegates.h"
+#include "Misc/DateTime.h"
+#include "Misc/Paths.h"
+
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Telemetry Records"), STAT_TelemetryRecords, STATGROUP_Coop);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Telemetry Records Dropped"), STAT_TelemetryRecordsDropped, STATGROUP_Coop);
+
+static int32 TelemetryEnabled = 1;
+FAutoConsoleVariableRef CVARTelemetry(
+	TEXT("COOP.Telemetry"),
+	TelemetryEnabled,
+	TEXT("Record damage, kill, spawn and wave events to Saved/Telemetry"),
+	ECVF_Default);
+
+static int32 TelemetryBufferSize = 8192;
+FAutoConsoleVariableRef CVARTelemetryBufferSize(
+	TEXT("COOP.TelemetryBufferSize"),
+	TelemetryBufferSize,
+	TEXT("Records the telemetry ring buffer holds, read on startup"),
+	ECVF_Default);
+
+static float TelemetryFlushInterval = 2.0f;
+FAutoConsoleVariableRef CVARTelemetryFlushInterval(
+	TEXT("COOP.TelemetryFlushInterval"),
+	TelemetryFlushInterval,
+	TEXT("Seconds between telemetry writes if the buffer does not fill up before"),
+	ECVF_Default);
+
+
+static const uint32 TelemetryMagic = 'C' | ('S' << 8) | ('T' << 16) | ('L' << 24);
+
+static const uint16 TelemetryVersion = 1;
+
+//Class index of records without another actor
+static const uint16 NoClass = MAX_uint16;
+
+
+TArray<FCSTelemetryRecord> FCSTelemetry::Ring;
+
+uint64 FCSTelemetry::NumRecorded = 0;
+
+uint64 FCSTelemetry::NumFlushed = 0;
+
+uint64 FCSTelemetry::NumDropped = 0;
+
+TMap<const UClass*, uint16> FCSTelemetry::ClassIndices;
+
+TArray<FString> FCSTelemetry::NewClassNames;
+
+IFileHandle* FCSTelemetry::FileHandle = nullptr;
+
+TFuture<void> FCSTelemetry::PendingWrite;
+
+double FCSTelemetry::LastFlushTime = 0.0;
+
+FDelegateHandle FCSTelemetry::EndFrameHandle;
+
+
+void FCSTelemetry::Startup()
+{
+	Ring.SetNumZeroed(FMath::Max(TelemetryBufferSize, 64));
+
+	LastFlushTime = FPlatformTime::Seconds();
+
+	EndFrameHandle = FCoreDelegates::OnEndFrame.AddStatic(&FCSTelemetry::OnEndFrame);
+}
+
+void FCSTelemetry::Shutdown()
+{
+	FCoreDelegates::OnEndFrame.Remove(EndFrameHandle);
+
+	if (PendingWrite.IsValid())
+		PendingWrite.Wait();
+
+	//Write the rest and wait for it, the file is closed right after
+	Flush();
+	if (PendingWrite.IsValid())
+		PendingWrite.Wait();
+
+	if (FileHandle)
+	{
+		delete FileHandle;
+		FileHandle = nullptr;
+
+		UE_LOG(LogCoop, Log, TEXT("Telemetry: %llu records written, %llu dropped."), NumFlushed - NumDropped, NumDropped);
+	}
+
+	Ring.Empty();
+	ClassIndices.Empty();
+	NewClassNames.Empty();
+}
+
+bool FCSTelemetry::IsEnabled()
+{
+	return TelemetryEnabled != 0 && Ring.Num() > 0;
+}
+
+void FCSTelemetry::Record(ECSTelemetryEvent Event, const AActor* Subject, const AActor* Other, float Value)
+{
+	if (!IsEnabled() || Subject == nullptr)
+		return;
+
+	check(IsInGameThread());
+
+	FCSTelemetryRecord& Record = AddRecord(Event);
+
+	const UWorld* World = Subject->GetWorld();
+	Record.Time = World ? World->GetTimeSeconds() : 0.0f;
+
+	int32 MatchId = ACSMatchInstance::FindMatchId(Subject);
+	Record.MatchId = (int8)FMath::Clamp(MatchId, -1, 127);
+
+	Record.SubjectClass = GetClassIndex(Subject->GetClass());
+	Record.SubjectId = Subject->GetUniqueID();
+	Record.OtherClass = Other ? GetClassIndex(Other->GetClass()) : NoClass;
+	Record.OtherId = Other ? Other->GetUniqueID() : 0;
+	Record.Reserved = 0;
+	Record.Value = Value;
+
+	FVector Location = Subject->GetActorLocation();
+	Record.X = Location.X;
+	Record.Y = Location.Y;
+	Record.Z = Location.Z;
+
+	INC_DWORD_STAT(STAT_TelemetryRecords);
+
+	//Hand a quarter of the buffer to the writer at once, it has the rest of the buffer as time to catch up
+	if (NumRecorded - NumFlushed >= (uint64)(Ring.Num() / 4))
+		Flush();
+}
+
+FCSTelemetryRecord& FCSTelemetry::AddRecord(ECSTelemetryEvent Event)
+{
+	//Buffer full, overwrite the oldest record the writer has not taken yet
+	if (NumRecorded - NumFlushed >= (uint64)Ring.Num())
+	{
+		NumFlushed++;
+		NumDropped++;
+
+		INC_DWORD_STAT(STAT_TelemetryRecordsDropped);
+	}
+
+	FCSTelemetryRecord& Record = Ring[NumRecorded % Ring.Num()];
+	NumRecorded++;
+
+	Record.Event = Event;
+	return Record;
+}
+
+uint16 FCSTelemetry::GetClassIndex(const UClass* Class)
+{
+	if (const uint16* Index = ClassIndices.Find(Class))
+		return *Index;
+
+	if (ClassIndices.Num() >= NoClass)
+		return NoClass;
+
+	//The name goes out with the next block, before any record using it
+	uint16 NewIndex = (uint16)ClassIndices.Num();
+	ClassIndices.Add(Class, NewIndex);
+	NewClassNames.Add(Class->GetName());
+
+	return NewIndex;
+}
+
+void FCSTelemetry::Flush()
+{
+	if (Ring.Num() == 0 || (NumRecorded == NumFlushed && NewClassNames.Num() == 0))
+		return;
+
+	//One write at a time keeps the blocks in order, the ring holds the records meanwhile
+	if (PendingWrite.IsValid() && !PendingWrite.IsReady())
+		return;
+
+	LastFlushTime = FPlatformTime::Seconds();
+
+	if (FileHandle == nullptr && !OpenFile())
+	{
+		//Nowhere to write to, the records are lost
+		NumFlushed = NumRecorded;
+		NewClassNames.Reset();
+		return;
+	}
+
+	uint32 NumNames = NewClassNames.Num();
+	uint32 NumRecords = (uint32)(NumRecorded - NumFlushed);
+
+	TArray<uint8> Block;
+	Block.Reserve(sizeof(uint32) * 2 + NumNames * 32 + NumRecords * sizeof(FCSTelemetryRecord));
+
+	Block.Append((const uint8*)&NumNames, sizeof(NumNames));
+	for (const FString& Name : NewClassNames)
+	{
+		FTCHARToUTF8 NameUTF8(*Name);
+		uint16 Length = (uint16)NameUTF8.Length();
+
+		Block.Append((const uint8*)&Length, sizeof(Length));
+		Block.Append((const uint8*)NameUTF8.Get(), Length);
+	}
+	NewClassNames.Reset();
+
+	Block.Append((const uint8*)&NumRecords, sizeof(NumRecords));
+
+	//The pending records may wrap around the end of the ring
+	int32 First = (int32)(NumFlushed % Ring.Num());
+	int32 NumToEnd = FMath::Min((int32)NumRecords, Ring.Num() - First);
+	Block.Append((const uint8*)&Ring[First], NumToEnd * sizeof(FCSTelemetryRecord));
+	Block.Append((const uint8*)Ring.GetData(), (NumRecords - NumToEnd) * sizeof(FCSTelemetryRecord));
+
+	NumFlushed = NumRecorded;
+
+	IFileHandle* Handle = FileHandle;
+	PendingWrite = Async(EAsyncExecution::ThreadPool, [Handle, Block = MoveTemp(Block)]()
+	{
+		Handle->Write(Block.GetData(), Block.Num());
+		Handle->Flush();
+	});
+}
+
+bool FCSTelemetry::OpenFile()
+{
+	FString Directory = FPaths::ProjectSavedDir() / TEXT("Telemetry");
+	FString FilePath = Directory / FString::Printf(TEXT("Telemetry-%s.cstl"), *FDateTime::Now().ToString());
+
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	PlatformFile.CreateDirectoryTree(*Directory);
+
+	FileHandle = PlatformFile.OpenWrite(*FilePath);
+	if (FileHandle == nullptr)
+	{
+		UE_LOG(LogCoop, Warning, TEXT("Telemetry: Could not open %s, telemetry turned off."), *FilePath);
+
+		TelemetryEnabled = 0;
+		return false;
+	}
+
+	uint16 RecordSize = sizeof(FCSTelemetryRecord);
+
+	uint8 Header[8];
+	FMemory::Memcpy(Header, &TelemetryMagic, 4);
+	FMemory::Memcpy(Header + 4, &TelemetryVersion, 2);
+	FMemory::Memcpy(Header + 6, &RecordSize, 2);
+	FileHandle->Write(Header, sizeof(Header));
+
+	UE_LOG(LogCoop, Log, TEXT("Telemetry: Writing to %s"), *FilePath);
+	return true;
+}
+
+void FCSTelemetry::OnEndFrame()
+{
+	if (FPlatformTime::Seconds() - LastFlushTime >= TelemetryFlushInterval)
+		Flush();
+}
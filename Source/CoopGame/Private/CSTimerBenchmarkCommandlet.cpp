@@ -0,0 +1,157 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CSTimerBenchmarkCommandlet.h"
+#include "CoopGame.h"
+#include "CSTimingWheel.h"
+#include "TimerManager.h"
+
+
+struct FCSTimerBenchmarkParams
+{
+	int32 NumTimers = 5000;
+	int32 NumFrames = 1800;
+
+	//Timers set again per frame, like a bot refreshing its path
+	int32 NumResetPerFrame = 500;
+
+	//Timers cleared and set anew per frame, like powerups and pickups coming and going
+	int32 NumClearPerFrame = 50;
+
+	float DeltaTime = 1.0f / 60.0f;
+};
+
+struct FCSTimerBenchmarkResult
+{
+	uint64 SetCycles = 0;
+	uint64 ClearCycles = 0;
+	uint64 TickCycles = 0;
+	int32 NumFired = 0;
+};
+
+
+// Same calls on FTimerManager and FCSTimingWheel
+struct FCSTimerManagerBenchmark
+{
+	FTimerManager TimerManager;
+	TArray<FTimerHandle> Handles;
+
+	void SetTimer(int32 Index, const FTimerDelegate& Delegate, double Now, float Rate, bool bLoop) { TimerManager.SetTimer(Handles[Index], Delegate, Rate, bLoop); }
+
+	void ClearTimer(int32 Index) { TimerManager.ClearTimer(Handles[Index]); }
+
+	void Tick(double Now, float DeltaTime)
+	{
+		//The timer manager ticks once per engine frame only
+		GFrameCounter++;
+		TimerManager.Tick(DeltaTime);
+	}
+};
+
+struct FCSTimingWheelBenchmark
+{
+	FCSTimingWheel Wheel;
+	TArray<FCSTimerHandle> Handles;
+
+	explicit FCSTimingWheelBenchmark(float Resolution) : Wheel(Resolution) { }
+
+	void SetTimer(int32 Index, const FTimerDelegate& Delegate, double Now, float Rate, bool bLoop) { Wheel.SetTimer(Handles[Index], nullptr, Delegate, Now, Rate, bLoop); }
+
+	void ClearTimer(int32 Index) { Wheel.ClearTimer(Handles[Index]); }
+
+	void Tick(double Now, float DeltaTime) { Wheel.Advance(Now); }
+};
+
+template<class BenchmarkType>
+static FCSTimerBenchmarkResult RunTimerBenchmark(BenchmarkType& Benchmark, const FCSTimerBenchmarkParams& Params)
+{
+	FCSTimerBenchmarkResult Result;
+
+	FTimerDelegate Delegate = FTimerDelegate::CreateLambda([&Result]() { Result.NumFired++; });
+
+	//Same seed for both, they run the same workload
+	FRandomStream Random(1234);
+	Benchmark.Handles.SetNum(Params.NumTimers);
+
+	double Now = 0.0;
+
+	uint64 StartCycles = FPlatformTime::Cycles64();
+	for (int32 i = 0; i < Params.NumTimers; i++)
+		Benchmark.SetTimer(i, Delegate, Now, Random.FRandRange(0.05f, 10.0f), Random.FRand() < 0.5f);
+	Result.SetCycles += FPlatformTime::Cycles64() - StartCycles;
+
+	for (int32 Frame = 0; Frame < Params.NumFrames; Frame++)
+	{
+		Now += Params.DeltaTime;
+
+		StartCycles = FPlatformTime::Cycles64();
+		Benchmark.Tick(Now, Params.DeltaTime);
+		Result.TickCycles += FPlatformTime::Cycles64() - StartCycles;
+
+		StartCycles = FPlatformTime::Cycles64();
+		for (int32 i = 0; i < Params.NumResetPerFrame; i++)
+			Benchmark.SetTimer(Random.RandHelper(Params.NumTimers), Delegate, Now, Random.FRandRange(0.05f, 10.0f), false);
+		Result.SetCycles += FPlatformTime::Cycles64() - StartCycles;
+
+		for (int32 i = 0; i < Params.NumClearPerFrame; i++)
+		{
+			int32 Index = Random.RandHelper(Params.NumTimers);
+			float Rate = Random.FRandRange(0.05f, 10.0f);
+			bool bLoop = Random.FRand() < 0.5f;
+
+			StartCycles = FPlatformTime::Cycles64();
+			Benchmark.ClearTimer(Index);
+			Result.ClearCycles += FPlatformTime::Cycles64() - StartCycles;
+
+			StartCycles = FPlatformTime::Cycles64();
+			Benchmark.SetTimer(Index, Delegate, Now, Rate, bLoop);
+			Result.SetCycles += FPlatformTime::Cycles64() - StartCycles;
+		}
+	}
+
+	return Result;
+}
+
+static void LogTimerBenchmark(const TCHAR* Label, const FCSTimerBenchmarkResult& Result, const FCSTimerBenchmarkParams& Params)
+{
+	int32 NumSets = Params.NumTimers + Params.NumFrames * (Params.NumResetPerFrame + Params.NumClearPerFrame);
+	int32 NumClears = Params.NumFrames * Params.NumClearPerFrame;
+
+	UE_LOG(LogCoop, Display, TEXT("Timers: %s: set %.3f us, clear %.3f us, tick %.3f ms per frame, %d fired."),
+		Label,
+		FPlatformTime::ToMilliseconds64(Result.SetCycles) * 1000.0 / FMath::Max(NumSets, 1),
+		FPlatformTime::ToMilliseconds64(Result.ClearCycles) * 1000.0 / FMath::Max(NumClears, 1),
+		FPlatformTime::ToMilliseconds64(Result.TickCycles) / FMath::Max(Params.NumFrames, 1),
+		Result.NumFired);
+}
+
+
+
+int32 UCSTimerBenchmarkCommandlet::Main(const FString& Params)
+{
+	FCSTimerBenchmarkParams BenchmarkParams;
+	FParse::Value(*Params, TEXT("Timers="), BenchmarkParams.NumTimers);
+	FParse::Value(*Params, TEXT("Frames="), BenchmarkParams.NumFrames);
+	FParse::Value(*Params, TEXT("Reset="), BenchmarkParams.NumResetPerFrame);
+	FParse::Value(*Params, TEXT("Clear="), BenchmarkParams.NumClearPerFrame);
+
+	BenchmarkParams.NumTimers = FMath::Max(BenchmarkParams.NumTimers, 1);
+
+	float Resolution = 1.0f / 120.0f;
+	FParse::Value(*Params, TEXT("Resolution="), Resolution);
+
+	UE_LOG(LogCoop, Display, TEXT("Timers: %d timers, %d frames, %d set again and %d cleared per frame."),
+		BenchmarkParams.NumTimers, BenchmarkParams.NumFrames, BenchmarkParams.NumResetPerFrame, BenchmarkParams.NumClearPerFrame);
+
+	{
+		FCSTimerManagerBenchmark Benchmark;
+		LogTimerBenchmark(TEXT("FTimerManager"), RunTimerBenchmark(Benchmark, BenchmarkParams), BenchmarkParams);
+	}
+
+	{
+		FCSTimingWheelBenchmark Benchmark(Resolution);
+		LogTimerBenchmark(*FString::Printf(TEXT("Timing wheel (%.2f ms ticks)"), Resolution * 1000.0f), RunTimerBenchmark(Benchmark, BenchmarkParams), BenchmarkParams);
+	}
+
+	return 0;
+}
@@ -0,0 +1,370 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CSTimingWheel.h"
+
+
+FCSTimingWheel::FCSTimingWheel(float InResolution)
+{
+	Resolution = FMath::Max(InResolution, KINDA_SMALL_NUMBER);
+
+	Reset(0.0);
+}
+
+void FCSTimingWheel::Reset(double Time)
+{
+	Timers.Reset();
+	OwnerHeads.Reset();
+	FiringTimers.Reset();
+
+	FreeHead = INDEX_NONE;
+	NumTimers = 0;
+
+	for (int32& Head : Buckets)
+		Head = INDEX_NONE;
+
+	//Ticks up to the given time count as fired
+	NextTick = (uint64)FMath::FloorToDouble(FMath::Max(Time, 0.0) / Resolution) + 1;
+}
+
+uint64 FCSTimingWheel::TimeToTick(double Time) const
+{
+	return (uint64)FMath::CeilToDouble(FMath::Max(Time, 0.0) / Resolution);
+}
+
+
+
+void FCSTimingWheel::SetTimer(FCSTimerHandle& InOutHandle, const void* Owner, const FTimerDelegate& Delegate, double Now, float Rate, bool bLoop, float FirstDelay)
+{
+	if (Rate <= 0.0f)
+	{
+		ClearTimer(InOutHandle);
+		return;
+	}
+
+	//Setting an active timer again only moves it, its handle stays the same
+	int32 Index = FindTimer(InOutHandle) ? InOutHandle.Index : INDEX_NONE;
+	bool bLinkOwner = true;
+
+	if (Index == INDEX_NONE)
+	{
+		Index = AllocTimer();
+	}
+	else
+	{
+		if (Timers[Index].Bucket >= 0)
+			UnlinkTimer(Index);
+
+		if (Timers[Index].Owner != Owner)
+			UnlinkOwner(Index);
+		else
+			bLinkOwner = false;
+	}
+
+	FTimer& Timer = Timers[Index];
+
+	float Delay = FirstDelay >= 0.0f ? FirstDelay : Rate;
+	Timer.Delegate = Delegate;
+	Timer.ExpireTick = FMath::Max(TimeToTick(Now + Delay), NextTick);
+	Timer.IntervalTicks = bLoop ? (uint32)FMath::Max(FMath::RoundToInt(Rate / Resolution), 1) : 0;
+
+	LinkTimer(Index);
+
+	if (bLinkOwner)
+	{
+		Timer.Owner = Owner;
+		LinkOwner(Index);
+	}
+
+	InOutHandle.Index = Index;
+	InOutHandle.Serial = Timer.Serial;
+}
+
+void FCSTimingWheel::ClearTimer(FCSTimerHandle& InOutHandle)
+{
+	if (FindTimer(InOutHandle))
+		FreeTimer(InOutHandle.Index);
+
+	InOutHandle.Invalidate();
+}
+
+int32 FCSTimingWheel::ClearAllTimersForOwner(const void* Owner)
+{
+	const int32* Head = OwnerHeads.Find(Owner);
+	if (Head == nullptr)
+		return 0;
+
+	int32 NumCleared = 0;
+	int32 Index = *Head;
+
+	while (Index != INDEX_NONE)
+	{
+		int32 Next = Timers[Index].OwnerNext;
+		FreeTimer(Index);
+		Index = Next;
+		NumCleared++;
+	}
+
+	return NumCleared;
+}
+
+bool FCSTimingWheel::IsTimerActive(const FCSTimerHandle& Handle) const
+{
+	return FindTimer(Handle) != nullptr;
+}
+
+float FCSTimingWheel::GetTimerRemaining(const FCSTimerHandle& Handle, double Now) const
+{
+	const FTimer* Timer = FindTimer(Handle);
+	if (Timer == nullptr)
+		return -1.0f;
+
+	return FMath::Max((float)(Timer->ExpireTick * Resolution - Now), 0.0f);
+}
+
+const FCSTimingWheel::FTimer* FCSTimingWheel::FindTimer(const FCSTimerHandle& Handle) const
+{
+	if (!Timers.IsValidIndex(Handle.Index))
+		return nullptr;
+
+	const FTimer& Timer = Timers[Handle.Index];
+	return Timer.Serial == Handle.Serial && Timer.Bucket != BucketFree ? &Timer : nullptr;
+}
+
+
+
+int32 FCSTimingWheel::Advance(double Now)
+{
+	uint64 LastTick = (uint64)FMath::FloorToDouble(FMath::Max(Now, 0.0) / Resolution);
+
+	//Nothing to cascade or fire, skip the idle ticks
+	if (NumTimers == 0)
+	{
+		NextTick = FMath::Max(NextTick, LastTick + 1);
+		return 0;
+	}
+
+	int32 NumFired = 0;
+	while (NextTick <= LastTick)
+		NumFired += FireTick(NextTick);
+
+	return NumFired;
+}
+
+int32 FCSTimingWheel::FireTick(uint64 Tick)
+{
+	check(Tick == NextTick);
+
+	//Entering a new span of an upper level, move its timers down
+	int32 Slot = (int32)(Tick & SlotMask);
+	if (Slot == 0)
+	{
+		for (int32 Level = 1; Level < NumLevels; Level++)
+		{
+			if (Cascade(Level) != 0)
+				break;
+		}
+	}
+
+	int32& Head = Buckets[Slot];
+	for (int32 Index = Head; Index != INDEX_NONE; Index = Timers[Index].Next)
+	{
+		Timers[Index].Bucket = BucketFiring;
+		FiringTimers.Emplace(Index, Timers[Index].Serial);
+	}
+	Head = INDEX_NONE;
+
+	//Timers set while firing go to the ticks after this one
+	NextTick = Tick + 1;
+
+	int32 NumFired = 0;
+	for (int32 i = 0; i < FiringTimers.Num(); i++)
+	{
+		int32 Index = FiringTimers[i].Key;
+		FTimer& Timer = Timers[Index];
+
+		//Cleared or set again by a timer fired before it
+		if (Timer.Serial != FiringTimers[i].Value || Timer.Bucket != BucketFiring)
+			continue;
+
+		if (!Timer.Delegate.IsBound())
+		{
+			FreeTimer(Index);
+			continue;
+		}
+
+		FTimerDelegate Delegate;
+		if (Timer.IntervalTicks > 0)
+		{
+			//Looping timers are placed again before they fire so they can be cleared from their own callback
+			Delegate = Timer.Delegate;
+			Timer.ExpireTick = FMath::Max(Timer.ExpireTick + Timer.IntervalTicks, NextTick);
+			LinkTimer(Index);
+		}
+		else
+		{
+			Delegate = MoveTemp(Timer.Delegate);
+			FreeTimer(Index);
+		}
+
+		Delegate.ExecuteIfBound();
+		NumFired++;
+	}
+
+	FiringTimers.Reset();
+
+	return NumFired;
+}
+
+int32 FCSTimingWheel::Cascade(int32 Level)
+{
+	int32 Slot = (int32)(NextTick >> (Level * SlotBits)) & SlotMask;
+
+	int32& Head = Buckets[Level * SlotsPerLevel + Slot];
+	int32 Index = Head;
+	Head = INDEX_NONE;
+
+	while (Index != INDEX_NONE)
+	{
+		int32 Next = Timers[Index].Next;
+		LinkTimer(Index);
+		Index = Next;
+	}
+
+	return Slot;
+}
+
+
+
+int32 FCSTimingWheel::AllocTimer()
+{
+	int32 Index = FreeHead;
+	if (Index != INDEX_NONE)
+	{
+		FreeHead = Timers[Index].Next;
+	}
+	else
+	{
+		Index = Timers.AddDefaulted();
+		Timers[Index].Serial = 1;
+	}
+
+	FTimer& Timer = Timers[Index];
+	Timer.Owner = nullptr;
+	Timer.Bucket = BucketFree;
+	Timer.Prev = INDEX_NONE;
+	Timer.Next = INDEX_NONE;
+	Timer.OwnerPrev = INDEX_NONE;
+	Timer.OwnerNext = INDEX_NONE;
+
+	NumTimers++;
+
+	return Index;
+}
+
+void FCSTimingWheel::FreeTimer(int32 Index)
+{
+	FTimer& Timer = Timers[Index];
+
+	if (Timer.Bucket >= 0)
+		UnlinkTimer(Index);
+
+	UnlinkOwner(Index);
+
+	Timer.Delegate.Unbind();
+	Timer.Owner = nullptr;
+	Timer.Bucket = BucketFree;
+	Timer.Serial = FMath::Max(Timer.Serial + 1, 1u);
+
+	Timer.Next = FreeHead;
+	FreeHead = Index;
+
+	NumTimers--;
+}
+
+void FCSTimingWheel::LinkTimer(int32 Index)
+{
+	FTimer& Timer = Timers[Index];
+
+	uint64 Delta = Timer.ExpireTick - NextTick;
+
+	//Find the lowest level whose span reaches the expire tick, the last level holds everything further out
+	int32 Level = 0;
+	while (Level < NumLevels - 1 && Delta >= (1ull << ((Level + 1) * SlotBits)))
+		Level++;
+
+	uint64 SlotTick = Timer.ExpireTick;
+	if (Delta >= (1ull << (NumLevels * SlotBits)))
+		SlotTick = NextTick + (1ull << (NumLevels * SlotBits)) - 1;
+
+	int32 Bucket = Level * SlotsPerLevel + (int32)((SlotTick >> (Level * SlotBits)) & SlotMask);
+
+	Timer.Bucket = Bucket;
+	Timer.Prev = INDEX_NONE;
+	Timer.Next = Buckets[Bucket];
+
+	if (Timer.Next != INDEX_NONE)
+		Timers[Timer.Next].Prev = Index;
+
+	Buckets[Bucket] = Index;
+}
+
+void FCSTimingWheel::UnlinkTimer(int32 Index)
+{
+	FTimer& Timer = Timers[Index];
+
+	if (Timer.Prev != INDEX_NONE)
+		Timers[Timer.Prev].Next = Timer.Next;
+	else
+		Buckets[Timer.Bucket] = Timer.Next;
+
+	if (Timer.Next != INDEX_NONE)
+		Timers[Timer.Next].Prev = Timer.Prev;
+
+	Timer.Prev = INDEX_NONE;
+	Timer.Next = INDEX_NONE;
+	Timer.Bucket = BucketFree;
+}
+
+void FCSTimingWheel::LinkOwner(int32 Index)
+{
+	FTimer& Timer = Timers[Index];
+
+	int32* Head = OwnerHeads.Find(Timer.Owner);
+	if (Head == nullptr)
+		Head = &OwnerHeads.Add(Timer.Owner, INDEX_NONE);
+
+	Timer.OwnerPrev = INDEX_NONE;
+	Timer.OwnerNext = *Head;
+
+	if (Timer.OwnerNext != INDEX_NONE)
+		Timers[Timer.OwnerNext].OwnerPrev = Index;
+
+	*Head = Index;
+}
+
+void FCSTimingWheel::UnlinkOwner(int32 Index)
+{
+	FTimer& Timer = Timers[Index];
+
+	if (Timer.OwnerPrev != INDEX_NONE)
+	{
+		Timers[Timer.OwnerPrev].OwnerNext = Timer.OwnerNext;
+	}
+	else if (int32* Head = OwnerHeads.Find(Timer.Owner))
+	{
+		if (*Head == Index)
+		{
+			if (Timer.OwnerNext != INDEX_NONE)
+				*Head = Timer.OwnerNext;
+			else
+				OwnerHeads.Remove(Timer.Owner);
+		}
+	}
+
+	if (Timer.OwnerNext != INDEX_NONE)
+		Timers[Timer.OwnerNext].OwnerPrev = Timer.OwnerPrev;
+
+	Timer.OwnerPrev = INDEX_NONE;
+	Timer.OwnerNext = INDEX_NONE;
+}
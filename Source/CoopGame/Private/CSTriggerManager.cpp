@@ -0,0 +1,322 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CSTriggerManager.h"
+#include "CoopGame.h"
+#include "CSTeamFilter.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "Algo/Sort.h"
+
+
+DECLARE_CYCLE_STAT(TEXT("Trigger Manager Tick"), STAT_TriggerManagerTick, STATGROUP_Coop);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Triggers"), STAT_Triggers, STATGROUP_Coop);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Trigger Occupants"), STAT_TriggerOccupants, STATGROUP_Coop);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Trigger Events"), STAT_TriggerEvents, STATGROUP_Coop);
+
+static float TriggerCellSize = 500.0f;
+FAutoConsoleVariableRef CVARTriggerCellSize(
+	TEXT("COOP.TriggerCellSize"),
+	TriggerCellSize,
+	TEXT("Size of the grid cells occupants are sorted into for the trigger tests. Applies to trigger managers created afterwards"),
+	ECVF_Default);
+
+
+ACSTriggerManager::ACSTriggerManager()
+{
+	PrimaryActorTick.bCanEverTick = true;
+	//Characters and bots have moved for this frame
+	PrimaryActorTick.TickGroup = TG_PostPhysics;
+
+	NextSerial = 1;
+	MaxOccupantRadius = 0.0f;
+	CellSize = FMath::Max(TriggerCellSize, 1.0f);
+}
+
+ACSTriggerManager* ACSTriggerManager::Get(UWorld* World, bool bCreateIfMissing)
+{
+	if (World == nullptr)
+		return nullptr;
+
+	for (TActorIterator<ACSTriggerManager> It(World); It; ++It)
+	{
+		if (!It->IsPendingKill())
+			return *It;
+	}
+
+	if (!bCreateIfMissing || World->bIsTearingDown)
+		return nullptr;
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	return World->SpawnActor<ACSTriggerManager>(SpawnParams);
+}
+
+void ACSTriggerManager::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	Triggers.Empty();
+	Occupants.Empty();
+	PendingEvents.Empty();
+
+	Super::EndPlay(EndPlayReason);
+}
+
+
+
+FCSTriggerHandle ACSTriggerManager::AddTrigger(AActor* Owner, float Radius, bool bMovesWithOwner, const FCSTriggerSignature& OnEnter, const FCSTriggerSignature& OnExit)
+{
+	FCSTriggerHandle Handle;
+	if (Owner == nullptr)
+		return Handle;
+
+	FTrigger Trigger;
+	Trigger.Owner = Owner;
+	Trigger.Location = Owner->GetActorLocation();
+	Trigger.Radius = Radius;
+	Trigger.bMovesWithOwner = bMovesWithOwner;
+	Trigger.bEnabled = true;
+	Trigger.IgnoreMask = 0;
+	Trigger.Serial = NextSerial++;
+	Trigger.OnEnter = OnEnter;
+	Trigger.OnExit = OnExit;
+
+	Handle.Index = Triggers.Add(MoveTemp(Trigger));
+	Handle.Serial = Triggers[Handle.Index].Serial;
+
+	return Handle;
+}
+
+void ACSTriggerManager::RemoveTrigger(FCSTriggerHandle& InOutHandle)
+{
+	if (FindTrigger(InOutHandle))
+		Triggers.RemoveAt(InOutHandle.Index);
+
+	InOutHandle.Invalidate();
+}
+
+void ACSTriggerManager::SetTriggerEnabled(const FCSTriggerHandle& Handle, bool bEnabled)
+{
+	FTrigger* Trigger = FindTrigger(Handle);
+	if (Trigger == nullptr || Trigger->bEnabled == bEnabled)
+		return;
+
+	Trigger->bEnabled = bEnabled;
+	Trigger->Inside.Reset();
+}
+
+void ACSTriggerManager::SetTriggerIgnoreMask(const FCSTriggerHandle& Handle, FMaskFilter IgnoreMask)
+{
+	FTrigger* Trigger = FindTrigger(Handle);
+	if (Trigger)
+		Trigger->IgnoreMask = IgnoreMask;
+}
+
+ACSTriggerManager::FTrigger* ACSTriggerManager::FindTrigger(const FCSTriggerHandle& Handle)
+{
+	if (!Handle.IsValid() || !Triggers.IsAllocated(Handle.Index))
+		return nullptr;
+
+	FTrigger& Trigger = Triggers[Handle.Index];
+	return Trigger.Serial == Handle.Serial ? &Trigger : nullptr;
+}
+
+void ACSTriggerManager::AddOccupant(AActor* Actor)
+{
+	if (Actor == nullptr || Occupants.ContainsByPredicate([Actor](const FOccupant& Occupant) { return Occupant.Actor == Actor; }))
+		return;
+
+	FOccupant& Occupant = Occupants.AddDefaulted_GetRef();
+	Occupant.Actor = Actor;
+	Occupant.Location = Actor->GetActorLocation();
+	Actor->GetSimpleCollisionCylinder(Occupant.Radius, Occupant.HalfHeight);
+	Occupant.TeamMask = FCSTeamFilter::GetTeamMask(Actor);
+}
+
+void ACSTriggerManager::RemoveOccupant(AActor* Actor)
+{
+	int32 Index = Occupants.IndexOfByPredicate([Actor](const FOccupant& Occupant) { return Occupant.Actor == Actor; });
+	if (Index == INDEX_NONE)
+		return;
+
+	Occupants.RemoveAtSwap(Index, 1, false);
+
+	//The grid is built again next tick, only the triggers need to forget the occupant
+	TWeakObjectPtr<AActor> WeakActor = Actor;
+	for (auto It = Triggers.CreateIterator(); It; ++It)
+	{
+		if (It->Inside.RemoveSingleSwap(WeakActor, false) > 0)
+			PendingEvents.Add({ It.GetIndex(), It->Serial, WeakActor, false });
+	}
+
+	DispatchEvents();
+}
+
+
+
+int64 ACSTriggerManager::GetCellKey(int32 CellX, int32 CellY) const
+{
+	return ((int64)CellX << 32) | (uint32)CellY;
+}
+
+void ACSTriggerManager::BuildOccupantGrid()
+{
+	MaxOccupantRadius = 0.0f;
+
+	for (int32 i = Occupants.Num() - 1; i >= 0; i--)
+	{
+		FOccupant& Occupant = Occupants[i];
+
+		AActor* Actor = Occupant.Actor.Get();
+		if (Actor == nullptr || Actor->IsPendingKill())
+		{
+			Occupants.RemoveAtSwap(i, 1, false);
+			continue;
+		}
+
+		//Crouching changes the cylinder, read it every pass
+		Occupant.Location = Actor->GetActorLocation();
+		Actor->GetSimpleCollisionCylinder(Occupant.Radius, Occupant.HalfHeight);
+
+		MaxOccupantRadius = FMath::Max(MaxOccupantRadius, Occupant.Radius);
+	}
+
+	CellKeys.SetNumUninitialized(Occupants.Num(), false);
+	SortedOccupantIndices.SetNumUninitialized(Occupants.Num(), false);
+
+	for (int32 i = 0; i < Occupants.Num(); i++)
+	{
+		//Triggers reach far enough up and down, a 2D grid is enough
+		CellKeys[i] = GetCellKey(FMath::FloorToInt(Occupants[i].Location.X / CellSize), FMath::FloorToInt(Occupants[i].Location.Y / CellSize));
+		SortedOccupantIndices[i] = i;
+	}
+
+	Algo::Sort(SortedOccupantIndices, [this](int32 A, int32 B) { return CellKeys[A] < CellKeys[B]; });
+
+	CellRanges.Reset();
+	for (int32 Start = 0; Start < SortedOccupantIndices.Num();)
+	{
+		int64 Key = CellKeys[SortedOccupantIndices[Start]];
+
+		int32 End = Start + 1;
+		while (End < SortedOccupantIndices.Num() && CellKeys[SortedOccupantIndices[End]] == Key)
+			End++;
+
+		CellRanges.Add(Key, FIntPoint(Start, End - Start));
+		Start = End;
+	}
+}
+
+bool ACSTriggerManager::IsOverlapping(const FTrigger& Trigger, const FOccupant& Occupant) const
+{
+	//Sphere against the capsule of the occupant, the distance to its segment decides
+	float SegmentHalfLength = FMath::Max(Occupant.HalfHeight - Occupant.Radius, 0.0f);
+
+	FVector Delta = Trigger.Location - Occupant.Location;
+	Delta.Z -= FMath::Clamp(Delta.Z, -SegmentHalfLength, SegmentHalfLength);
+
+	float Reach = Trigger.Radius + Occupant.Radius;
+	return Delta.SizeSquared() <= Reach * Reach;
+}
+
+void ACSTriggerManager::UpdateTrigger(int32 TriggerIndex, FTrigger& Trigger)
+{
+	if (Trigger.bMovesWithOwner)
+	{
+		AActor* Owner = Trigger.Owner.Get();
+		if (Owner == nullptr)
+			return;
+
+		Trigger.Location = Owner->GetActorLocation();
+	}
+
+	Overlapping.Reset();
+
+	//Friendly occupants are rejected before the shape test
+	FMaskFilter IgnoreMask = FCSTeamFilter::IsEnabled() ? Trigger.IgnoreMask : 0;
+
+	float Reach = Trigger.Radius + MaxOccupantRadius;
+	int32 MinCellX = FMath::FloorToInt((Trigger.Location.X - Reach) / CellSize);
+	int32 MaxCellX = FMath::FloorToInt((Trigger.Location.X + Reach) / CellSize);
+	int32 MinCellY = FMath::FloorToInt((Trigger.Location.Y - Reach) / CellSize);
+	int32 MaxCellY = FMath::FloorToInt((Trigger.Location.Y + Reach) / CellSize);
+
+	for (int32 CellX = MinCellX; CellX <= MaxCellX; CellX++)
+	{
+		for (int32 CellY = MinCellY; CellY <= MaxCellY; CellY++)
+		{
+			const FIntPoint* Range = CellRanges.Find(GetCellKey(CellX, CellY));
+			if (Range == nullptr)
+				continue;
+
+			for (int32 SortedIndex = Range->X; SortedIndex < Range->X + Range->Y; SortedIndex++)
+			{
+				const FOccupant& Occupant = Occupants[SortedOccupantIndices[SortedIndex]];
+				if ((Occupant.TeamMask & IgnoreMask) == 0 && Occupant.Actor != Trigger.Owner && IsOverlapping(Trigger, Occupant))
+					Overlapping.Add(Occupant.Actor);
+			}
+		}
+	}
+
+	for (const TWeakObjectPtr<AActor>& Actor : Trigger.Inside)
+	{
+		if (!Overlapping.Contains(Actor))
+			PendingEvents.Add({ TriggerIndex, Trigger.Serial, Actor, false });
+	}
+
+	for (const TWeakObjectPtr<AActor>& Actor : Overlapping)
+	{
+		if (!Trigger.Inside.Contains(Actor))
+			PendingEvents.Add({ TriggerIndex, Trigger.Serial, Actor, true });
+	}
+
+	Trigger.Inside.Reset();
+	Trigger.Inside.Append(Overlapping);
+}
+
+void ACSTriggerManager::DispatchEvents()
+{
+	//Handlers may add or remove triggers and occupants, everything is looked up again per event
+	for (int32 i = 0; i < PendingEvents.Num(); i++)
+	{
+		FTriggerEvent Event = PendingEvents[i];
+
+		AActor* Actor = Event.Actor.Get();
+		if (Actor == nullptr || !Triggers.IsAllocated(Event.TriggerIndex))
+			continue;
+
+		FTrigger& Trigger = Triggers[Event.TriggerIndex];
+		if (Trigger.Serial != Event.Serial || !Trigger.bEnabled)
+			continue;
+
+		if (Event.bEnter)
+			Trigger.OnEnter.ExecuteIfBound(Actor);
+		else
+			Trigger.OnExit.ExecuteIfBound(Actor);
+	}
+
+	PendingEvents.Reset();
+}
+
+
+
+void ACSTriggerManager::Tick(float DeltaSeconds)
+{
+	SCOPE_CYCLE_COUNTER(STAT_TriggerManagerTick);
+
+	Super::Tick(DeltaSeconds);
+
+	BuildOccupantGrid();
+
+	for (auto It = Triggers.CreateIterator(); It; ++It)
+	{
+		if (It->bEnabled)
+			UpdateTrigger(It.GetIndex(), *It);
+	}
+
+	SET_DWORD_STAT(STAT_Triggers, Triggers.Num());
+	SET_DWORD_STAT(STAT_TriggerOccupants, Occupants.Num());
+	SET_DWORD_STAT(STAT_TriggerEvents, PendingEvents.Num());
+
+	DispatchEvents();
+}
@@ -3,6 +3,13 @@
 
 #include "CSWeapon.h"
 #include "CoopGame.h"
+#include "CSNetStats.h"
+#include "CSRepProfiler.h"
+#include "CSActorPool.h"
+#include "CSGameplayScheduler.h"
+#include "Components/CSEffectComponent.h"
+#include "CSReplicationGraph.h"
+#include "CSTeamFilter.h"
 #include "Engine/World.h"
 #include "CollisionQueryParams.h"
 #include "DrawDebugHelpers.h"
@@ -16,7 +23,6 @@
 #include "PhysicalMaterials/PhysicalMaterial.h"
 #include "Camera/CameraShake.h"
 #include "Net/UnrealNetwork.h"
-#include "TimerManager.h"
 #include "GameFramework/Pawn.h"
 
 static int32 DebugWeaponDrawing = 0;
@@ -26,6 +32,8 @@ FAutoConsoleVariableRef CVARDebugWeaponDrawing(
 	TEXT("Draw debug lines for weapons"), 
 	ECVF_Cheat);
 
+DECLARE_CYCLE_STAT(TEXT("Weapon Fire"), STAT_WeaponFire, STATGROUP_Coop);
+
 // Sets default values
 ACSWeapon::ACSWeapon()
 {
@@ -34,6 +42,13 @@ ACSWeapon::ACSWeapon()
 	SetReplicates(true);
 	NetUpdateFrequency = 66.0f;
 	MinNetUpdateFrequency = 33.0f;
+
+	//Replication
+	FiringNetUpdateFrequency = 0.0f;
+	IdleNetUpdateFrequency = 10.0f;
+	IdleNetUpdateDelay = 1.0f;
+	bNetUpdateIdle = false;
+	LastNetFireTime = 0.0f;
 	
 	MeshComp = CreateDefaultSubobject<USkeletalMeshComponent>(TEXT("MeshComp"));
 	RootComponent = MeshComp;
@@ -45,6 +60,7 @@ ACSWeapon::ACSWeapon()
 	BaseDamage = 20.0f;
 	BaseDamageMultiplier = 1.0f;
 	CriticalHitMultiplier = 2.5f;
+	OwnerEffectComp = nullptr;
 	RateOfFire = 600;
 
 	//Spread
@@ -68,6 +84,21 @@ void ACSWeapon::BeginPlay()
 	Super::BeginPlay();
 
 	TimeBetweenShots = 60 / RateOfFire;
+
+	//Taken before the idle rate replaces it, so blueprint defaults of NetUpdateFrequency apply
+	if (FiringNetUpdateFrequency <= 0.0f)
+		FiringNetUpdateFrequency = NetUpdateFrequency;
+
+	//Held weapons are idle most of the time
+	if (Role == ROLE_Authority)
+		SetNetUpdateIdle(true);
+}
+
+void ACSWeapon::Reset()
+{
+	Super::Reset();
+
+	ACSActorPool::ReleaseToPool(this);
 }
 
 void ACSWeapon::Tick(float DeltaSeconds)
@@ -78,6 +109,96 @@ void ACSWeapon::Tick(float DeltaSeconds)
 	{
 		DecreaseSpread(SpreadDecreaseSpeed * DeltaSeconds);
 	}
+
+	if (Role == ROLE_Authority && !bNetUpdateIdle && GetWorld()->TimeSeconds - LastNetFireTime > IdleNetUpdateDelay)
+		SetNetUpdateIdle(true);
+}
+
+void ACSWeapon::PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker)
+{
+	Super::PreReplication(ChangedPropertyTracker);
+
+	FCSNetStats::NotifyConsidered(this);
+	FCSRepProfiler::NotifyPreReplication(this);
+}
+
+void ACSWeapon::PostNetReceive()
+{
+	Super::PostNetReceive();
+
+	FCSRepProfiler::NotifyPostNetReceive(this);
+}
+
+bool ACSWeapon::CallRemoteFunction(UFunction* Function, void* Parameters, FOutParmRec* OutParms, FFrame* Stack)
+{
+	FCSRepProfiler::NotifyRemoteFunction(this, Function, Parameters);
+
+	return Super::CallRemoteFunction(Function, Parameters, OutParms, Stack);
+}
+
+void ACSWeapon::SetOwner(AActor* NewOwner)
+{
+	AActor* OldOwner = GetOwner();
+
+	Super::SetOwner(NewOwner);
+
+	OwnerEffectComp = NewOwner ? NewOwner->FindComponentByClass<UCSEffectComponent>() : nullptr;
+
+	//The weapon is part of its owner's team, shots of teammates pass through it
+	FCSTeamFilter::ApplyTeamMask(this, FCSTeamFilter::GetTeamMask(NewOwner));
+
+	if (OldOwner != NewOwner)
+		UCSReplicationGraph::NotifyDependentOwnerChanged(this, OldOwner);
+}
+
+void ACSWeapon::OnAcquiredFromPool_Implementation()
+{
+	//Hand out a recycled weapon as if it was just spawned
+	const ACSWeapon* Defaults = GetClass()->GetDefaultObject<ACSWeapon>();
+	MagCount = Defaults->MagCount;
+	AmmoCount = Defaults->AmmoCount;
+	BaseDamageMultiplier = Defaults->BaseDamageMultiplier;
+	CriticalHitMultiplier = Defaults->CriticalHitMultiplier;
+	bCanFire = Defaults->bCanFire;
+	SpreadCurrent = SpreadAngleMin;
+	LastFiredTime = 0.0f;
+
+	if (Role == ROLE_Authority)
+		SetNetUpdateIdle(true);
+}
+
+void ACSWeapon::OnReleasedToPool_Implementation()
+{
+	StopFire();
+	ACSGameplayScheduler::Get(GetWorld())->ClearTimer(TimerHandle_TimeBetweenShots);
+
+	//Let go of the owner, it is usually a dead character about to be destroyed. The replication graph stops gathering the weapon
+	//without an owner, so clients drop it and the next owner opens a new channel, the pool only saves the spawn on the server
+	DetachFromActor(FDetachmentTransformRules::KeepWorldTransform);
+	SetOwner(nullptr);
+}
+
+void ACSWeapon::NotifyNetFire()
+{
+	if (Role != ROLE_Authority)
+		return;
+
+	LastNetFireTime = GetWorld()->TimeSeconds;
+
+	if (bNetUpdateIdle)
+	{
+		SetNetUpdateIdle(false);
+		ForceNetUpdate();
+	}
+}
+
+void ACSWeapon::SetNetUpdateIdle(bool bNewIdle)
+{
+	bNetUpdateIdle = bNewIdle;
+
+	float NewFrequency = bNetUpdateIdle ? IdleNetUpdateFrequency : FiringNetUpdateFrequency;
+	MinNetUpdateFrequency = NewFrequency * 0.5f;
+	UCSReplicationGraph::SetActorNetUpdateFrequency(this, NewFrequency);
 }
 
 
@@ -118,26 +239,29 @@ void ACSWeapon::EndReload()
 
 void ACSWeapon::StartFire()
 {
-	bool bIsTimerActive = GetWorldTimerManager().IsTimerActive(TimerHandle_TimeBetweenShots);
+	bool bIsTimerActive = ACSGameplayScheduler::Get(GetWorld())->IsTimerActive(TimerHandle_TimeBetweenShots);
 
 	if (!bIsTimerActive && MagCount > 0)
 	{
 		//TODO Play pulled trigger sound
 		float FirstDelay = FMath::Max(LastFiredTime + TimeBetweenShots - GetWorld()->TimeSeconds, 0.0f);
-		GetWorldTimerManager().SetTimer(TimerHandle_TimeBetweenShots, this, &ACSWeapon::Fire, TimeBetweenShots, true, FirstDelay);
+		ACSGameplayScheduler::Get(GetWorld())->SetTimer(TimerHandle_TimeBetweenShots, this, &ACSWeapon::Fire, TimeBetweenShots, true, FirstDelay);
 	}
 }
 
 void ACSWeapon::StopFire()
 {
-	GetWorldTimerManager().ClearTimer(TimerHandle_TimeBetweenShots);
+	ACSGameplayScheduler::Get(GetWorld())->ClearTimer(TimerHandle_TimeBetweenShots);
 }
 
 
 void ACSWeapon::Fire()
 {
+	COOP_SCOPE_CYCLE_COUNTER(WeaponFire);
+
 	APawn* MyPawn = Cast<APawn>(GetOwner());
 	
+	COOP_REP_READ(MagCount);
 	if (MagCount <= 0 && MyPawn->IsLocallyControlled()) return;
 	
 	//Call Server to replicate this on other clients
@@ -145,6 +269,10 @@ void ACSWeapon::Fire()
 	{
 		ServerFire();
 	}
+	else
+	{
+		NotifyNetFire();
+	}
 
 	//Trace the world from pawn eyes to crosshair location
 	AActor* MyOwner = GetOwner();
@@ -152,6 +280,8 @@ void ACSWeapon::Fire()
 	{
 		//Update weapon magazine
 		MagCount--;
+
+		COOP_INC_COUNTER(Shots);
 		
 		FVector EyeLocation;
 		FRotator EyeRotation;
@@ -163,11 +293,16 @@ void ACSWeapon::Fire()
 
 		FVector TraceEnd = EyeLocation + (ShotDirection * 10000);
 
-		FCollisionQueryParams QueryParams;
-		QueryParams.AddIgnoredActor(MyOwner);
-		QueryParams.AddIgnoredActor(this);
-		QueryParams.bTraceComplex = true;
-		QueryParams.bReturnPhysicalMaterial = true;
+		if (FireQueryParamsOwner != MyOwner)
+		{
+			FireQueryParams = FCollisionQueryParams(SCENE_QUERY_STAT(WeaponFire), true, this);
+			FireQueryParams.AddIgnoredActor(MyOwner);
+			FireQueryParams.bReturnPhysicalMaterial = true;
+			FireQueryParamsOwner = MyOwner;
+		}
+
+		//Teammates are skipped by the trace itself
+		FireQueryParams.IgnoreMask = FCSTeamFilter::GetQueryIgnoreMask(MyOwner);
 
 		//Trace hit location
 		FVector TracerEndPoint = TraceEnd;
@@ -176,8 +311,10 @@ void ACSWeapon::Fire()
 		EPhysicalSurface SurfaceType = SurfaceType_Default;
 		bool bHasHit = false;
 
+		COOP_INC_COUNTER(Traces);
+
 		FHitResult Hit;
-		if (GetWorld()->LineTraceSingleByChannel(Hit, EyeLocation, TraceEnd, COLLISION_WEAPON, QueryParams))
+		if (GetWorld()->LineTraceSingleByChannel(Hit, EyeLocation, TraceEnd, COLLISION_WEAPON, FireQueryParams))
 		{
 			AActor* HitActor = Hit.GetActor();
 			SurfaceType = UPhysicalMaterial::DetermineSurfaceType(Hit.PhysMaterial.Get());
@@ -185,11 +322,11 @@ void ACSWeapon::Fire()
 			//Damage is only dealt on Server
 			if (Role == ROLE_Authority)
 			{
-				float DamageDelt = BaseDamage * BaseDamageMultiplier;
+				float DamageDelt = BaseDamage * GetDamageMultiplier();
 
 				//Deal more damage if it is a critical hit
 				if (SurfaceType == SURFACE_FLESHVULNERABLE)
-					DamageDelt *= CriticalHitMultiplier;
+					DamageDelt *= GetCriticalHitMultiplier();
 
 				//Apply damage to the hit actor
 				UGameplayStatics::ApplyPointDamage(HitActor, DamageDelt, ShotDirection, Hit, MyOwner->GetInstigatorController(), MyOwner, DamageType);
@@ -262,6 +399,8 @@ bool ACSWeapon::AddAmmoMag_Validate(int amount)
 //Replication Events
 void ACSWeapon::OnRep_HitScanTrace()
 {
+	COOP_REP_READ(HitScanTrace);
+
 	//Play cosmetic effects
 	PlayFireEffects(HitScanTrace.TraceTo);
 	if(HitScanTrace.bHasHit)
@@ -297,9 +436,13 @@ void ACSWeapon::DecreaseSpread(float amount)
 
 void ACSWeapon::PlayFireEffects(FVector TraceEndPoint)
 {
+#if COOP_WITH_COSMETICS
 	//Muzzle Effect
 	if (MuzzleEffect)
+	{
 		UGameplayStatics::SpawnEmitterAttached(MuzzleEffect, MeshComp, MuzzleSocketName);
+		COOP_INC_COUNTER(SpawnedEffects);
+	}
 
 	//Bullet Trail Effect
 	if (TrailEffect)
@@ -307,24 +450,27 @@ void ACSWeapon::PlayFireEffects(FVector TraceEndPoint)
 		FVector MuzzleLocation = MeshComp->GetSocketLocation(MuzzleSocketName);
 
 		UParticleSystemComponent* TrailEffectComp = UGameplayStatics::SpawnEmitterAtLocation(GetWorld(), TrailEffect, MuzzleLocation);
+		COOP_INC_COUNTER(SpawnedEffects);
 		if (TrailEffectComp)
 		{
 			TrailEffectComp->SetVectorParameter(TrailTargetName, TraceEndPoint);
 		}
 	}
 
-	//Camera Shake
+	//Camera Shake, only for the local player. The owning client shakes its camera when it fires, an RPC from the server would shake it twice
 	APawn* MyPawn = Cast<APawn>(GetOwner());
 	if (MyPawn)
 	{
 		APlayerController* PC = Cast<APlayerController>(MyPawn->GetController());
-		if (PC)
+		if (PC && PC->IsLocalController())
 			PC->ClientPlayCameraShake(FireCamShake);
 	}
+#endif
 }
 
 void ACSWeapon::PlayImpactEffects(EPhysicalSurface SurfaceType, FVector ImpactPoint)
 {
+#if COOP_WITH_COSMETICS
 	//Spawn Impact particle effect
 	UParticleSystem* SelectedEffect = nullptr;
 	switch (SurfaceType)
@@ -346,7 +492,9 @@ void ACSWeapon::PlayImpactEffects(EPhysicalSurface SurfaceType, FVector ImpactPo
 		ShotDirection.Normalize();
 
 		UGameplayStatics::SpawnEmitterAtLocation(GetWorld(), SelectedEffect, ImpactPoint, ShotDirection.Rotation());
+		COOP_INC_COUNTER(SpawnedEffects);
 	}
+#endif
 }
 
 
@@ -354,6 +502,24 @@ void ACSWeapon::PlayImpactEffects(EPhysicalSurface SurfaceType, FVector ImpactPo
 
 #pragma region Setter Methods
 
+float ACSWeapon::GetDamageMultiplier() const
+{
+	float Multiplier = BaseDamageMultiplier;
+	if (OwnerEffectComp)
+		Multiplier += OwnerEffectComp->GetStatPercent(ECSEffectStat::Damage) / 100.0f;
+
+	return FMath::Max(Multiplier, 0.0f);
+}
+
+float ACSWeapon::GetCriticalHitMultiplier() const
+{
+	float Multiplier = CriticalHitMultiplier;
+	if (OwnerEffectComp)
+		Multiplier += OwnerEffectComp->GetStatPercent(ECSEffectStat::CriticalHit) / 100.0f;
+
+	return FMath::Max(Multiplier, 0.0f);
+}
+
 void ACSWeapon::AddBaseDamage_Implementation(float amount)
 {
 	BaseDamage += amount;
@@ -0,0 +1,222 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Components/CSEffectComponent.h"
+#include "Engine/World.h"
+#include "CSGameplayScheduler.h"
+#include "Net/UnrealNetwork.h"
+
+
+void FCSActiveEffect::PostReplicatedAdd(const FCSActiveEffectArray& InArraySerializer)
+{
+	if (InArraySerializer.Owner)
+		InArraySerializer.Owner->UpdateStats();
+}
+
+void FCSActiveEffect::PostReplicatedChange(const FCSActiveEffectArray& InArraySerializer)
+{
+	if (InArraySerializer.Owner)
+		InArraySerializer.Owner->UpdateStats();
+}
+
+void FCSActiveEffect::PreReplicatedRemove(const FCSActiveEffectArray& InArraySerializer)
+{
+	//Still in the array while this is called, zeroed so the sum leaves it out
+	Percent = 0.0f;
+
+	if (InArraySerializer.Owner)
+		InArraySerializer.Owner->UpdateStats();
+}
+
+
+
+UCSEffectComponent::UCSEffectComponent()
+{
+	SetIsReplicated(true);
+
+	ActiveEffects.Owner = this;
+	NextEffectId = 0;
+
+	FMemory::Memzero(StatPercents);
+}
+
+void UCSEffectComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	ActiveEffects.Owner = this;
+}
+
+void UCSEffectComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	//The scheduler is gone when the world tears down
+	ACSGameplayScheduler* Scheduler = ACSGameplayScheduler::Get(GetWorld(), false);
+	if (Scheduler)
+		Scheduler->ClearAllTimersForObject(this);
+
+	Super::EndPlay(EndPlayReason);
+}
+
+
+
+int32 UCSEffectComponent::AddEffect(const FCSEffectSpec& Spec, const UObject* Source)
+{
+	if (GetOwnerRole() != ROLE_Authority || Spec.Stat >= ECSEffectStat::MAX)
+		return INDEX_NONE;
+
+	FCSActiveEffect& Effect = ActiveEffects.Items.AddDefaulted_GetRef();
+	Effect.EffectId = NextEffectId++;
+	Effect.Stat = Spec.Stat;
+	Effect.Percent = Spec.Percent;
+	Effect.ExpireTime = Spec.Duration > 0.0f ? GetWorld()->GetTimeSeconds() + Spec.Duration : 0.0f;
+	Effect.Source = Source;
+
+	int32 EffectId = Effect.EffectId;
+	ActiveEffects.MarkItemDirty(Effect);
+
+	UpdateStats();
+
+	if (Spec.Duration > 0.0f)
+		ScheduleExpiry();
+
+	return EffectId;
+}
+
+bool UCSEffectComponent::RemoveEffect(int32 EffectId)
+{
+	if (GetOwnerRole() != ROLE_Authority)
+		return false;
+
+	int32 Index = ActiveEffects.Items.IndexOfByPredicate([EffectId](const FCSActiveEffect& Effect) { return Effect.EffectId == EffectId; });
+	if (Index == INDEX_NONE)
+		return false;
+
+	RemoveEffectAt(Index);
+	ActiveEffects.MarkArrayDirty();
+
+	UpdateStats();
+	ScheduleExpiry();
+
+	return true;
+}
+
+int32 UCSEffectComponent::RemoveEffectsFromSource(const UObject* Source)
+{
+	if (GetOwnerRole() != ROLE_Authority || Source == nullptr)
+		return 0;
+
+	int32 NumRemoved = 0;
+	for (int32 i = ActiveEffects.Items.Num() - 1; i >= 0; i--)
+	{
+		if (ActiveEffects.Items[i].Source.Get() == Source)
+		{
+			RemoveEffectAt(i);
+			NumRemoved++;
+		}
+	}
+
+	if (NumRemoved > 0)
+	{
+		ActiveEffects.MarkArrayDirty();
+		UpdateStats();
+		ScheduleExpiry();
+	}
+
+	return NumRemoved;
+}
+
+void UCSEffectComponent::ClearEffects()
+{
+	if (GetOwnerRole() != ROLE_Authority || ActiveEffects.Items.Num() == 0)
+		return;
+
+	ActiveEffects.Items.Reset();
+	ActiveEffects.MarkArrayDirty();
+
+	UpdateStats();
+	ScheduleExpiry();
+}
+
+void UCSEffectComponent::RemoveEffectAt(int32 Index)
+{
+	//Order does not matter to the fast array, items are matched by their replication id
+	ActiveEffects.Items.RemoveAtSwap(Index, 1, false);
+}
+
+
+
+void UCSEffectComponent::ExpireEffects()
+{
+	float Now = GetWorld()->GetTimeSeconds();
+
+	bool bRemoved = false;
+	for (int32 i = ActiveEffects.Items.Num() - 1; i >= 0; i--)
+	{
+		float ExpireTime = ActiveEffects.Items[i].ExpireTime;
+		if (ExpireTime > 0.0f && ExpireTime <= Now)
+		{
+			RemoveEffectAt(i);
+			bRemoved = true;
+		}
+	}
+
+	if (bRemoved)
+	{
+		ActiveEffects.MarkArrayDirty();
+		UpdateStats();
+	}
+
+	ScheduleExpiry();
+}
+
+void UCSEffectComponent::ScheduleExpiry()
+{
+	float NextExpireTime = MAX_flt;
+	for (const FCSActiveEffect& Effect : ActiveEffects.Items)
+	{
+		if (Effect.ExpireTime > 0.0f)
+			NextExpireTime = FMath::Min(NextExpireTime, Effect.ExpireTime);
+	}
+
+	ACSGameplayScheduler* Scheduler = ACSGameplayScheduler::Get(GetWorld());
+	if (Scheduler == nullptr)
+		return;
+
+	if (NextExpireTime == MAX_flt)
+	{
+		Scheduler->ClearTimer(TimerHandle_ExpireEffects);
+		return;
+	}
+
+	//Effects that expire in the same scheduler tick go together
+	float Delay = FMath::Max(NextExpireTime - GetWorld()->GetTimeSeconds(), KINDA_SMALL_NUMBER);
+	Scheduler->SetTimer(TimerHandle_ExpireEffects, this, &UCSEffectComponent::ExpireEffects, Delay, false);
+}
+
+void UCSEffectComponent::UpdateStats()
+{
+	float NewStatPercents[(uint8)ECSEffectStat::MAX];
+	FMemory::Memzero(NewStatPercents);
+
+	for (const FCSActiveEffect& Effect : ActiveEffects.Items)
+	{
+		if (Effect.Stat < ECSEffectStat::MAX)
+			NewStatPercents[(uint8)Effect.Stat] += Effect.Percent;
+	}
+
+	if (FMemory::Memcmp(NewStatPercents, StatPercents, sizeof(StatPercents)) == 0)
+		return;
+
+	FMemory::Memcpy(StatPercents, NewStatPercents, sizeof(StatPercents));
+
+	OnStatsChanged.Broadcast(this);
+}
+
+
+
+void UCSEffectComponent::GetLifetimeReplicatedProps(TArray<FLifetimeProperty> & OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME(UCSEffectComponent, ActiveEffects);
+}
@@ -2,10 +2,17 @@
 
 
 #include "Components/CSHealthComponent.h"
+#include "CoopGame.h"
 #include "GameFramework/Actor.h"
 #include "Net/UnrealNetwork.h"
 #include "Engine/World.h"
 #include "CSGameMode.h"
+#include "CSTeamFilter.h"
+#include "CSTelemetry.h"
+#include "CSRepProfiler.h"
+
+
+DECLARE_CYCLE_STAT(TEXT("Handle Take Any Damage"), STAT_HandleTakeAnyDamage, STATGROUP_Coop);
 
 UCSHealthComponent::UCSHealthComponent()
 {
@@ -29,6 +36,9 @@ void UCSHealthComponent::BeginPlay()
 		if (MyOwner)
 			MyOwner->OnTakeAnyDamage.AddDynamic(this, &UCSHealthComponent::HandleTakeAnyDamage);
 	}
+
+	//Queries of the other team skip the owner inside the physics scene, traces for client effects too
+	FCSTeamFilter::ApplyTeamMask(GetOwner(), FCSTeamFilter::GetTeamMask(TeamNum));
 	
 	Health = DefaultHealth;
 }
@@ -38,25 +48,32 @@ void UCSHealthComponent::HandleTakeAnyDamage(AActor* DamagedActor, float Damage,
 	if (Damage <= 0.0f || bIsDead)
 		return;
 
+	COOP_SCOPE_CYCLE_COUNTER(HandleTakeAnyDamage);
+	COOP_INC_COUNTER(DamageEvents);
+
 	if (IsFriendly(DamagedActor, DamageCauser) && DamagedActor != DamageCauser)
 	{
 		//@TODO: Add friendly fire option :)
+		FCSTeamFilter::NotifyFriendlyDiscarded("Damage");
 		return;
 	}
 
 
-	FString Prefix = Damage < 0 ? "+" : "-";
-
 	Health = FMath::Clamp(Health - Damage, 0.0f, DefaultHealth);
 
 	bIsDead = Health <= 0.0f;
 
-	UE_LOG(LogTemp, Log, TEXT("%s took damage: %s%s (%sHP)"), *GetOwner()->GetName(), *Prefix, *FString::SanitizeFloat(Damage), *FString::SanitizeFloat(Health));
+	FCSTelemetry::Record(ECSTelemetryEvent::Damage, GetOwner(), DamageCauser, Damage);
+
+	//Formatted by the log only, no strings are built when the category is quiet
+	UE_LOG(LogCoop, Verbose, TEXT("%s took damage: -%.1f (%.1fHP)"), *GetOwner()->GetName(), Damage, Health);
 
 	OnHealthChanged.Broadcast(this, Health, Damage, DamageType, InstigatedBy, DamageCauser);
 
 	if (bIsDead)
 	{
+		FCSTelemetry::Record(ECSTelemetryEvent::Kill, GetOwner(), DamageCauser, Damage);
+
 		ACSGameMode* GM = Cast<ACSGameMode>(GetWorld()->GetAuthGameMode());
 		if (GM)
 		{
@@ -70,9 +87,8 @@ void UCSHealthComponent::HandleTakeAnyDamage(AActor* DamagedActor, float Damage,
 void UCSHealthComponent::OnRep_Health(float OldHealth)
 {
 	float Delta = Health - OldHealth;
-	FString Prefix = Delta < 0 ? "" : "+";
 
-	UE_LOG(LogTemp, Log, TEXT("Client: %s Health: %s%s"), *GetOwner()->GetName(), *Prefix, *FString::SanitizeFloat(Delta));
+	UE_LOG(LogCoop, Verbose, TEXT("Client: %s Health: %+.1f"), *GetOwner()->GetName(), Delta);
 
 
 	OnHealthChanged.Broadcast(this, Health, Delta, nullptr, nullptr, nullptr);
@@ -82,6 +98,8 @@ void UCSHealthComponent::OnRep_Health(float OldHealth)
 
 float UCSHealthComponent::GetHealth() const
 {
+	COOP_REP_READ(Health);
+
 	return Health;
 }
 
@@ -92,11 +110,22 @@ void UCSHealthComponent::Heal(float HealAmount)
 
 	Health = FMath::Clamp(Health + HealAmount, 0.0f, DefaultHealth);
 
-	UE_LOG(LogTemp, Log, TEXT("%s got healed: +%s (%sHP)"), *GetOwner()->GetName(), *FString::SanitizeFloat(HealAmount), *FString::SanitizeFloat(Health));
+	FCSTelemetry::Record(ECSTelemetryEvent::Heal, GetOwner(), nullptr, HealAmount);
+
+	UE_LOG(LogCoop, Verbose, TEXT("%s got healed: +%.1f (%.1fHP)"), *GetOwner()->GetName(), HealAmount, Health);
 
 	OnHealthChanged.Broadcast(this, Health, -HealAmount, nullptr, nullptr, nullptr);
 }
 
+void UCSHealthComponent::ResetHealth()
+{
+	if (GetOwnerRole() != ROLE_Authority)
+		return;
+
+	bIsDead = false;
+	Health = DefaultHealth;
+}
+
 
 
 
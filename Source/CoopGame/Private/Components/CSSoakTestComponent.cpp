@@ -0,0 +1,451 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Components/CSSoakTestComponent.h"
+#include "CoopGame.h"
+#include "AI/CSSoakPlayerController.h"
+#include "AI/CSTrackerBotSwarm.h"
+#include "CSFrameScratch.h"
+#include "Engine/World.h"
+#include "Engine/NetDriver.h"
+#include "Engine/NetConnection.h"
+#include "GameFramework/GameModeBase.h"
+#include "Kismet/GameplayStatics.h"
+#include "HAL/PlatformMemory.h"
+#include "Misc/App.h"
+#include "Misc/CommandLine.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "UObject/Package.h"
+
+
+void FCSSoakPhysicsTickFunction::ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent)
+{
+	if (Target == nullptr || Target->IsPendingKill())
+		return;
+
+	if (bPhysicsStart)
+		Target->OnPhysicsStart();
+	else
+		Target->OnPhysicsEnd();
+}
+
+FString FCSSoakPhysicsTickFunction::DiagnosticMessage()
+{
+	return FString::Printf(TEXT("FCSSoakPhysicsTickFunction[%s]"), bPhysicsStart ? TEXT("Start") : TEXT("End"));
+}
+
+
+
+UCSSoakTestComponent::UCSSoakTestComponent()
+{
+	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.bStartWithTickEnabled = false;
+
+	NumWaves = 50;
+	NumStandInPlayers = 4;
+	StandInControllerClass = ACSSoakPlayerController::StaticClass();
+	FixedFrameRate = 30.0f;
+	TimeDilation = 1.0f;
+	bMortalStandIns = false;
+	MaxHeapAllocsPerFrame = 0;
+	NumClients = 0;
+	ClientTimeout = 120.0f;
+	HitchThresholdMs = 100.0f;
+	RandomSeed = 1;
+
+	bSoakRunning = false;
+	WavesPlayed = 0;
+	NumGameOvers = 0;
+	WaveStartTime = 0.0f;
+	bWaveRunning = false;
+	PhysicsTimeTotalMs = 0.0f;
+	NumPhysicsSteps = 0;
+	HeapAllocsTotal = 0;
+	NumHeapAllocFrames = 0;
+	NetOutKBpsTotal = 0.0f;
+	NumNetSamples = 0;
+	bClientsJoined = true;
+	ClientWaitStartTime = 0.0;
+	LastFrameTime = 0.0;
+	PhysicsStartTime = 0.0;
+}
+
+
+void UCSSoakTestComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	if (GetOwnerRole() != ROLE_Authority || !FParse::Param(FCommandLine::Get(), TEXT("Soak")))
+		return;
+
+	ParseCommandLine();
+
+	bSoakRunning = true;
+
+	//Same shots, spread and targets on every run
+	FMath::RandInit(RandomSeed);
+	FMath::SRandInit(RandomSeed);
+
+	bClientsJoined = NumClients == 0;
+	ClientWaitStartTime = FPlatformTime::Seconds();
+
+	//Step the game by a fixed delta time as fast as the CPU allows
+	if (FixedFrameRate > 0.0f)
+	{
+		FApp::SetUseFixedTimeStep(true);
+		FApp::SetFixedDeltaTime(1.0 / FixedFrameRate);
+	}
+
+	if (!FMath::IsNearlyEqual(TimeDilation, 1.0f))
+		UGameplayStatics::SetGlobalTimeDilation(this, TimeDilation);
+
+	RegisterPhysicsTickFunctions();
+
+	LastFrameTime = FPlatformTime::Seconds();
+	SetComponentTickEnabled(true);
+
+	UE_LOG(LogCoop, Log, TEXT("Soak: Running %d waves with %d stand-in players and %d remote clients at %.0f fps, time dilation %.2f."), NumWaves, NumStandInPlayers, NumClients, FixedFrameRate, TimeDilation);
+}
+
+void UCSSoakTestComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	UnregisterPhysicsTickFunctions();
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void UCSSoakTestComponent::ParseCommandLine()
+{
+	const TCHAR* CommandLine = FCommandLine::Get();
+
+	FParse::Value(CommandLine, TEXT("SoakWaves="), NumWaves);
+	FParse::Value(CommandLine, TEXT("SoakPlayers="), NumStandInPlayers);
+	FParse::Value(CommandLine, TEXT("SoakFPS="), FixedFrameRate);
+	FParse::Value(CommandLine, TEXT("SoakTimeDilation="), TimeDilation);
+	FParse::Value(CommandLine, TEXT("SoakMaxHeapAllocs="), MaxHeapAllocsPerFrame);
+	FParse::Value(CommandLine, TEXT("SoakClients="), NumClients);
+	FParse::Value(CommandLine, TEXT("SoakClientTimeout="), ClientTimeout);
+	FParse::Value(CommandLine, TEXT("SoakHitchMs="), HitchThresholdMs);
+	FParse::Value(CommandLine, TEXT("SoakSeed="), RandomSeed);
+
+	if (FParse::Param(CommandLine, TEXT("SoakMortal")))
+		bMortalStandIns = true;
+
+	NumWaves = FMath::Max(NumWaves, 1);
+	NumStandInPlayers = FMath::Max(NumStandInPlayers, 1);
+	FixedFrameRate = FMath::Max(FixedFrameRate, 0.0f);
+	TimeDilation = FMath::Max(TimeDilation, 0.1f);
+	MaxHeapAllocsPerFrame = FMath::Max(MaxHeapAllocsPerFrame, 0);
+	NumClients = FMath::Max(NumClients, 0);
+	ClientTimeout = FMath::Max(ClientTimeout, 1.0f);
+	HitchThresholdMs = FMath::Max(HitchThresholdMs, 1.0f);
+}
+
+
+
+#pragma region Physics Time
+
+void UCSSoakTestComponent::RegisterPhysicsTickFunctions()
+{
+	UWorld* World = GetWorld();
+
+	PhysicsStartTickFunction.Target = this;
+	PhysicsStartTickFunction.bPhysicsStart = true;
+	PhysicsStartTickFunction.bCanEverTick = true;
+	//Right after the simulation was kicked off, prephysics ticks like the swarm are not part of the physics frame
+	PhysicsStartTickFunction.TickGroup = TG_StartPhysics;
+	PhysicsStartTickFunction.AddPrerequisite(World, World->StartPhysicsTickFunction);
+	PhysicsStartTickFunction.RegisterTickFunction(World->PersistentLevel);
+
+	PhysicsEndTickFunction.Target = this;
+	PhysicsEndTickFunction.bPhysicsStart = false;
+	PhysicsEndTickFunction.bCanEverTick = true;
+	PhysicsEndTickFunction.TickGroup = TG_EndPhysics;
+	PhysicsEndTickFunction.AddPrerequisite(World, World->EndPhysicsTickFunction);
+	PhysicsEndTickFunction.RegisterTickFunction(World->PersistentLevel);
+}
+
+void UCSSoakTestComponent::UnregisterPhysicsTickFunctions()
+{
+	if (PhysicsStartTickFunction.IsTickFunctionRegistered())
+		PhysicsStartTickFunction.UnRegisterTickFunction();
+
+	if (PhysicsEndTickFunction.IsTickFunctionRegistered())
+		PhysicsEndTickFunction.UnRegisterTickFunction();
+}
+
+void UCSSoakTestComponent::OnPhysicsStart()
+{
+	PhysicsStartTime = FPlatformTime::Seconds();
+}
+
+void UCSSoakTestComponent::OnPhysicsEnd()
+{
+	if (!bWaveRunning || PhysicsStartTime <= 0.0)
+		return;
+
+	//Includes the work done during physics while waiting for the simulation
+	float PhysicsTimeMs = (float)((FPlatformTime::Seconds() - PhysicsStartTime) * 1000.0);
+
+	PhysicsTimeTotalMs += PhysicsTimeMs;
+	NumPhysicsSteps++;
+	CurrentWave.PhysicsTimeMaxMs = FMath::Max(CurrentWave.PhysicsTimeMaxMs, PhysicsTimeMs);
+}
+
+#pragma endregion Physics Time
+
+
+
+void UCSSoakTestComponent::SpawnStandInPlayers()
+{
+	AGameModeBase* GM = Cast<AGameModeBase>(GetOwner());
+	if (!bSoakRunning || GM == nullptr || StandInControllerClass == nullptr)
+		return;
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	for (int32 i = 0; i < NumStandInPlayers; i++)
+	{
+		ACSSoakPlayerController* Controller = GetWorld()->SpawnActor<ACSSoakPlayerController>(StandInControllerClass, SpawnParams);
+		if (Controller)
+		{
+			Controller->SetInvulnerable(!bMortalStandIns);
+			GM->RestartPlayer(Controller);
+		}
+	}
+}
+
+void UCSSoakTestComponent::SampleMemory()
+{
+	FPlatformMemoryStats MemoryStats = FPlatformMemory::GetStats();
+
+	CurrentWave.UsedMemoryMB = MemoryStats.UsedPhysical / (1024.0f * 1024.0f);
+	CurrentWave.PeakUsedMemoryMB = FMath::Max(CurrentWave.PeakUsedMemoryMB, CurrentWave.UsedMemoryMB);
+	CurrentWave.MemoryHighWaterMB = MemoryStats.PeakUsedPhysical / (1024.0f * 1024.0f);
+}
+
+void UCSSoakTestComponent::SampleNetwork()
+{
+	UNetDriver* NetDriver = GetWorld()->GetNetDriver();
+	if (NetDriver == nullptr || NetDriver->ClientConnections.Num() == 0)
+		return;
+
+	//Connections update their rates once per stat period
+	float NetOutKBps = 0.0f;
+	for (UNetConnection* Connection : NetDriver->ClientConnections)
+	{
+		if (Connection)
+			NetOutKBps += Connection->OutBytesPerSecond / 1024.0f;
+	}
+	NetOutKBps /= NetDriver->ClientConnections.Num();
+
+	NetOutKBpsTotal += NetOutKBps;
+	NumNetSamples++;
+	CurrentWave.NetOutKBpsMax = FMath::Max(CurrentWave.NetOutKBpsMax, NetOutKBps);
+}
+
+int32 UCSSoakTestComponent::GetNumClients() const
+{
+	UNetDriver* NetDriver = GetWorld()->GetNetDriver();
+	return NetDriver ? NetDriver->ClientConnections.Num() : 0;
+}
+
+void UCSSoakTestComponent::UpdateClientsJoined()
+{
+	int32 NumJoined = GetNumClients();
+	if (NumJoined >= NumClients)
+	{
+		bClientsJoined = true;
+
+		UE_LOG(LogCoop, Log, TEXT("Soak: %d remote clients joined after %.1fs."), NumJoined, FPlatformTime::Seconds() - ClientWaitStartTime);
+		return;
+	}
+
+	if (FPlatformTime::Seconds() - ClientWaitStartTime > ClientTimeout)
+	{
+		UE_LOG(LogCoop, Error, TEXT("Soak: Only %d of %d remote clients joined within %.0fs."), NumJoined, NumClients, ClientTimeout);
+		FinishRun();
+	}
+}
+
+
+
+void UCSSoakTestComponent::NotifyWaveStarted(int32 Wave, int32 WaveSize)
+{
+	if (!bSoakRunning)
+		return;
+
+	CurrentWave = FCSSoakWaveReport();
+	CurrentWave.Wave = Wave;
+	CurrentWave.WaveSize = WaveSize;
+
+	WaveStartTime = GetWorld()->TimeSeconds;
+	FrameTimesMs.Reset();
+	PhysicsTimeTotalMs = 0.0f;
+	NumPhysicsSteps = 0;
+	HeapAllocsTotal = 0;
+	NumHeapAllocFrames = 0;
+	NetOutKBpsTotal = 0.0f;
+	NumNetSamples = 0;
+
+	bWaveRunning = true;
+}
+
+void UCSSoakTestComponent::NotifyWaveCompleted(int32 Wave)
+{
+	if (!bSoakRunning || !bWaveRunning)
+		return;
+
+	bWaveRunning = false;
+	WavesPlayed++;
+
+	CurrentWave.Duration = GetWorld()->TimeSeconds - WaveStartTime;
+	CurrentWave.NumFrames = FrameTimesMs.Num();
+	CurrentWave.PhysicsTimeAvgMs = NumPhysicsSteps > 0 ? PhysicsTimeTotalMs / NumPhysicsSteps : 0.0f;
+
+	if (NumHeapAllocFrames > 0)
+		CurrentWave.HeapAllocsAvg = HeapAllocsTotal / (float)NumHeapAllocFrames;
+
+	CurrentWave.NumClients = GetNumClients();
+	CurrentWave.NetOutKBpsAvg = NumNetSamples > 0 ? NetOutKBpsTotal / NumNetSamples : 0.0f;
+
+	if (FrameTimesMs.Num() > 0)
+	{
+		FrameTimesMs.Sort();
+
+		auto GetPercentile = [this](float Percentile)
+		{
+			int32 Index = FMath::Clamp(FMath::CeilToInt(Percentile * FrameTimesMs.Num()) - 1, 0, FrameTimesMs.Num() - 1);
+			return FrameTimesMs[Index];
+		};
+
+		CurrentWave.FrameTimeP50Ms = GetPercentile(0.5f);
+		CurrentWave.FrameTimeP90Ms = GetPercentile(0.9f);
+		CurrentWave.FrameTimeP99Ms = GetPercentile(0.99f);
+		CurrentWave.FrameTimeMaxMs = FrameTimesMs.Last();
+	}
+
+	SampleMemory();
+	WaveReports.Add(CurrentWave);
+
+	UE_LOG(LogCoop, Log, TEXT("Soak: Wave %d (%d bots) took %.1fs over %d frames. Frame p50 %.2fms p90 %.2fms p99 %.2fms max %.2fms, physics avg %.2fms max %.2fms, peak bots %d, memory %.0fMB."),
+		CurrentWave.Wave, CurrentWave.WaveSize, CurrentWave.Duration, CurrentWave.NumFrames,
+		CurrentWave.FrameTimeP50Ms, CurrentWave.FrameTimeP90Ms, CurrentWave.FrameTimeP99Ms, CurrentWave.FrameTimeMaxMs,
+		CurrentWave.PhysicsTimeAvgMs, CurrentWave.PhysicsTimeMaxMs, CurrentWave.PeakLiveBots, CurrentWave.UsedMemoryMB);
+
+	UE_LOG(LogCoop, Log, TEXT("Soak: Wave %d had %d hitches, %d clients at %.1fKB/s avg %.1fKB/s max each, memory high water %.0fMB."),
+		CurrentWave.Wave, CurrentWave.NumHitches, CurrentWave.NumClients, CurrentWave.NetOutKBpsAvg, CurrentWave.NetOutKBpsMax, CurrentWave.MemoryHighWaterMB);
+
+	if (CurrentWave.HeapAllocsAvg >= 0.0f)
+	{
+		UE_LOG(LogCoop, Log, TEXT("Soak: Wave %d heap allocations per frame avg %.1f max %d."), CurrentWave.Wave, CurrentWave.HeapAllocsAvg, CurrentWave.HeapAllocsMax);
+
+		if (MaxHeapAllocsPerFrame > 0 && CurrentWave.HeapAllocsAvg > MaxHeapAllocsPerFrame)
+			UE_LOG(LogCoop, Error, TEXT("Soak: Wave %d averaged %.1f heap allocations per frame, the budget is %d."), CurrentWave.Wave, CurrentWave.HeapAllocsAvg, MaxHeapAllocsPerFrame);
+	}
+
+	if (WavesPlayed >= NumWaves)
+		FinishRun();
+}
+
+void UCSSoakTestComponent::NotifyGameOver()
+{
+	if (!bSoakRunning)
+		return;
+
+	//Wave is dropped from the report, the match restarts from the first wave
+	bWaveRunning = false;
+	NumGameOvers++;
+
+	UE_LOG(LogCoop, Warning, TEXT("Soak: Game over in wave %d after %d waves played."), CurrentWave.Wave, WavesPlayed);
+}
+
+void UCSSoakTestComponent::FinishRun()
+{
+	bSoakRunning = false;
+	SetComponentTickEnabled(false);
+	UnregisterPhysicsTickFunctions();
+
+	WriteReport();
+
+	FPlatformMisc::RequestExit(false);
+}
+
+void UCSSoakTestComponent::WriteReport() const
+{
+	FString ReportPath;
+	if (!FParse::Value(FCommandLine::Get(), TEXT("SoakReport="), ReportPath))
+		ReportPath = FPaths::ProjectSavedDir() / TEXT("Soak") / FString::Printf(TEXT("Soak-%s.csv"), *FDateTime::Now().ToString());
+
+	FString Report = TEXT("Wave,WaveSize,Duration,Frames,FrameP50Ms,FrameP90Ms,FrameP99Ms,FrameMaxMs,PhysicsAvgMs,PhysicsMaxMs,PeakLiveBots,UsedMemoryMB,PeakUsedMemoryMB,HeapAllocsAvg,HeapAllocsMax,Hitches,Clients,NetOutKBpsAvg,NetOutKBpsMax,MemoryHighWaterMB,");
+	Report += TEXT("SettingMap,SettingGame,SettingClients,SettingPlayers,SettingWaves,SettingFPS,SettingSeed,SettingHitchMs\n");
+
+	//Every row carries the settings of the run, results are only comparable between runs with the same ones
+	FString Settings = FString::Printf(TEXT("%s,%s,%d,%d,%d,%g,%d,%g"),
+		*GetWorld()->GetOutermost()->GetName(), *GetOwner()->GetClass()->GetPathName(),
+		NumClients, NumStandInPlayers, NumWaves, FixedFrameRate, RandomSeed, HitchThresholdMs);
+
+	for (const FCSSoakWaveReport& Wave : WaveReports)
+	{
+		Report += FString::Printf(TEXT("%d,%d,%.2f,%d,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%d,%.1f,%.1f,%.1f,%d,%d,%d,%.2f,%.2f,%.1f,%s\n"),
+			Wave.Wave, Wave.WaveSize, Wave.Duration, Wave.NumFrames,
+			Wave.FrameTimeP50Ms, Wave.FrameTimeP90Ms, Wave.FrameTimeP99Ms, Wave.FrameTimeMaxMs,
+			Wave.PhysicsTimeAvgMs, Wave.PhysicsTimeMaxMs, Wave.PeakLiveBots, Wave.UsedMemoryMB, Wave.PeakUsedMemoryMB,
+			Wave.HeapAllocsAvg, Wave.HeapAllocsMax,
+			Wave.NumHitches, Wave.NumClients, Wave.NetOutKBpsAvg, Wave.NetOutKBpsMax, Wave.MemoryHighWaterMB, *Settings);
+	}
+
+	if (FFileHelper::SaveStringToFile(Report, *ReportPath))
+		UE_LOG(LogCoop, Log, TEXT("Soak: %d waves played, %d game overs. Report written to %s"), WavesPlayed, NumGameOvers, *ReportPath);
+	else
+		UE_LOG(LogCoop, Error, TEXT("Soak: Failed to write report to %s"), *ReportPath);
+}
+
+
+
+void UCSSoakTestComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	//Real time between frames, the game delta time is fixed while soaking
+	double Now = FPlatformTime::Seconds();
+	float FrameTimeMs = (float)((Now - LastFrameTime) * 1000.0);
+	LastFrameTime = Now;
+
+	if (!bClientsJoined)
+	{
+		UpdateClientsJoined();
+		return;
+	}
+
+	if (!bWaveRunning)
+		return;
+
+	FrameTimesMs.Add(FrameTimeMs);
+
+	if (FrameTimeMs > HitchThresholdMs)
+		CurrentWave.NumHitches++;
+
+	if (!Swarm.IsValid())
+		Swarm = ACSTrackerBotSwarm::Get(GetWorld());
+
+	if (Swarm.IsValid())
+		CurrentWave.PeakLiveBots = FMath::Max(CurrentWave.PeakLiveBots, Swarm->GetNumBots());
+
+	int32 FrameHeapAllocs = FCSFrameScratch::GetLastFrameHeapAllocs();
+	if (FrameHeapAllocs >= 0)
+	{
+		HeapAllocsTotal += FrameHeapAllocs;
+		NumHeapAllocFrames++;
+		CurrentWave.HeapAllocsMax = FMath::Max(CurrentWave.HeapAllocsMax, FrameHeapAllocs);
+	}
+
+	//Memory stats are not free, sample them once a second of game time
+	if (FrameTimesMs.Num() % FMath::Max(FMath::RoundToInt(1.0f / FMath::Max(DeltaTime, KINDA_SMALL_NUMBER)), 1) == 0)
+	{
+		SampleMemory();
+		SampleNetwork();
+	}
+}
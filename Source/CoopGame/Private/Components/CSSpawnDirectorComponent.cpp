@@ -0,0 +1,316 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Components/CSSpawnDirectorComponent.h"
+#include "AI/CSTrackerBot.h"
+#include "AI/CSTrackerBotSwarm.h"
+#include "CoopGame.h"
+#include "CSActorPool.h"
+#include "CSMatchInstance.h"
+#include "CSTelemetry.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "GameFramework/PlayerStart.h"
+#include "GameFramework/PlayerController.h"
+#include "Kismet/GameplayStatics.h"
+#include "NavigationSystem.h"
+#include "Engine/NetDriver.h"
+#include "Engine/NetConnection.h"
+#include "Misc/App.h"
+
+
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Spawn Director Frame Time (ms)"), STAT_SpawnDirectorFrameTime, STATGROUP_Coop);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Spawn Director Net Saturation"), STAT_SpawnDirectorNetSaturation, STATGROUP_Coop);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Spawn Director Load"), STAT_SpawnDirectorLoad, STATGROUP_Coop);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Spawn Director Interval Scale"), STAT_SpawnDirectorIntervalScale, STATGROUP_Coop);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Spawn Director Live Bots"), STAT_SpawnDirectorLiveBots, STATGROUP_Coop);
+
+
+UCSSpawnDirectorComponent::UCSSpawnDirectorComponent()
+{
+	PrimaryComponentTick.bCanEverTick = true;
+
+	ReleaseDelay = 2.0f;
+
+	SpawnOriginTag = "BotSpawn";
+	CandidatesPerOrigin = 32;
+	CandidateRadius = 3000.0f;
+	MinDistanceToPlayers = 1000.0f;
+	SpawnHeightOffset = 50.0f;
+
+	NumActiveBots = 0;
+
+	//Budget
+	bAdaptiveSpawning = true;
+	FrameBudgetMs = 25.0f;
+	MaxNetSaturation = 0.25f;
+	MaxLiveBots = 40;
+	AccelerateBelowLoad = 0.5f;
+	DeferAboveLoad = 1.5f;
+	MinSpawnIntervalScale = 0.5f;
+	MaxSpawnIntervalScale = 4.0f;
+	LoadSmoothingHalfLife = 0.5f;
+
+	//Metrics
+	FrameTimeMs = 0.0f;
+	NetSaturation = 0.0f;
+	LiveBots = 0;
+	Load = 0.0f;
+	SpawnIntervalScale = 1.0f;
+	NumDeferredSpawns = 0;
+}
+
+
+void UCSSpawnDirectorComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	if (GetOwnerRole() == ROLE_Authority)
+		BuildSpawnCandidates();
+}
+
+void UCSSpawnDirectorComponent::BuildSpawnCandidates()
+{
+	UNavigationSystemV1* NavSys = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld());
+	if (NavSys == nullptr)
+	{
+		UE_LOG(LogCoop, Warning, TEXT("Spawn Director: No navigation system, bots can't be spawned natively."));
+		return;
+	}
+
+	TArray<AActor*> SpawnOrigins;
+	UGameplayStatics::GetAllActorsWithTag(this, SpawnOriginTag, SpawnOrigins);
+
+	if (SpawnOrigins.Num() == 0)
+		UGameplayStatics::GetAllActorsOfClass(this, APlayerStart::StaticClass(), SpawnOrigins);
+
+	SpawnCandidates.Reset();
+	for (AActor* Origin : SpawnOrigins)
+	{
+		for (int32 i = 0; i < CandidatesPerOrigin; i++)
+		{
+			FNavLocation NavLocation;
+			if (NavSys->GetRandomReachablePointInRadius(Origin->GetActorLocation(), CandidateRadius, NavLocation))
+				SpawnCandidates.Add(NavLocation.Location + FVector(0, 0, SpawnHeightOffset));
+		}
+	}
+
+	UE_LOG(LogCoop, Log, TEXT("Spawn Director: %d spawn candidates around %d origins."), SpawnCandidates.Num(), SpawnOrigins.Num());
+}
+
+bool UCSSpawnDirectorComponent::PickSpawnLocation(FVector& OutLocation) const
+{
+	if (SpawnCandidates.Num() == 0)
+		return false;
+
+	//Start at a random candidate and take the first one that is far enough away from all players
+	int32 FirstCandidate = FMath::RandHelper(SpawnCandidates.Num());
+
+	for (int32 i = 0; i < SpawnCandidates.Num(); i++)
+	{
+		const FVector& Candidate = SpawnCandidates[(FirstCandidate + i) % SpawnCandidates.Num()];
+
+		bool bTooClose = false;
+		for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+		{
+			APlayerController* PC = It->Get();
+			if (PC && PC->GetPawn() && FVector::DistSquared(PC->GetPawn()->GetActorLocation(), Candidate) < FMath::Square(MinDistanceToPlayers))
+			{
+				bTooClose = true;
+				break;
+			}
+		}
+
+		if (!bTooClose)
+		{
+			OutLocation = Candidate;
+			return true;
+		}
+	}
+
+	//Every candidate is close to a player, still better than not spawning
+	OutLocation = SpawnCandidates[FirstCandidate];
+	return true;
+}
+
+
+
+bool UCSSpawnDirectorComponent::CanSpawnBots() const
+{
+	return BotClass != nullptr && SpawnCandidates.Num() > 0;
+}
+
+ACSTrackerBot* UCSSpawnDirectorComponent::SpawnBot()
+{
+	FVector SpawnLocation;
+	if (!CanSpawnBots() || !PickSpawnLocation(SpawnLocation))
+		return nullptr;
+
+	ACSActorPool* Pool = ACSActorPool::Get(GetWorld());
+	if (Pool == nullptr)
+		return nullptr;
+
+	//Bots take their match and director from their owner when they are acquired
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	SpawnParams.Owner = GetOwner();
+
+	ACSTrackerBot* Bot = Pool->AcquireActor<ACSTrackerBot>(BotClass, FTransform(SpawnLocation), SpawnParams);
+	if (Bot)
+	{
+		NumActiveBots++;
+		FCSTelemetry::Record(ECSTelemetryEvent::Spawn, Bot, GetOwner());
+	}
+
+	return Bot;
+}
+
+void UCSSpawnDirectorComponent::PrewarmPool(int32 NumBots)
+{
+	ACSActorPool* Pool = ACSActorPool::Get(GetWorld());
+	if (Pool && BotClass)
+		Pool->SetPrewarm(BotClass, this, CanSpawnBots() ? NumBots : 0);
+}
+
+int32 UCSSpawnDirectorComponent::GetNumPooledBots() const
+{
+	ACSActorPool* Pool = ACSActorPool::Get(GetWorld(), false);
+	return Pool && BotClass ? Pool->GetNumPooled(BotClass) : 0;
+}
+
+void UCSSpawnDirectorComponent::ReleaseBot(ACSTrackerBot* Bot)
+{
+	if (Bot == nullptr || PendingReleaseBots.Contains(Bot))
+		return;
+
+	PendingReleaseBots.Add(Bot);
+	PendingReleaseTimes.Add(GetWorld()->TimeSeconds + ReleaseDelay);
+
+	NumActiveBots = FMath::Max(NumActiveBots - 1, 0);
+}
+
+void UCSSpawnDirectorComponent::ReturnBot(ACSTrackerBot* Bot)
+{
+	if (Bot == nullptr || Bot->IsPendingKill())
+		return;
+
+	int32 PendingIndex = PendingReleaseBots.Find(Bot);
+	if (PendingIndex != INDEX_NONE)
+	{
+		PendingReleaseBots.RemoveAtSwap(PendingIndex, 1, false);
+		PendingReleaseTimes.RemoveAtSwap(PendingIndex, 1, false);
+	}
+	else if (!Bot->bPooled)
+	{
+		//Returned without exploding, e.g. on match reset
+		NumActiveBots = FMath::Max(NumActiveBots - 1, 0);
+	}
+
+	AddToPool(Bot);
+}
+
+void UCSSpawnDirectorComponent::AddToPool(ACSTrackerBot* Bot)
+{
+	if (Bot == nullptr || Bot->IsPendingKill())
+		return;
+
+	ACSActorPool::ReleaseToPool(Bot);
+}
+
+
+
+#pragma region Budget
+
+void UCSSpawnDirectorComponent::UpdateLoad(float DeltaTime)
+{
+	//Time the game thread spent working, the server sleeps the rest of the frame to hold its tick rate
+	float WorkTimeMs = (float)FMath::Max(0.0, FApp::GetDeltaTime() - FApp::GetIdleTime()) * 1000.0f;
+
+	float SaturatedConnections = 0.0f;
+	UNetDriver* NetDriver = GetWorld()->GetNetDriver();
+	if (NetDriver && NetDriver->ClientConnections.Num() > 0)
+	{
+		for (UNetConnection* Connection : NetDriver->ClientConnections)
+		{
+			if (Connection && Connection->IsNetReady(false) == 0)
+				SaturatedConnections++;
+		}
+
+		SaturatedConnections /= NetDriver->ClientConnections.Num();
+	}
+
+	float Alpha = LoadSmoothingHalfLife > 0.0f ? 1.0f - FMath::Pow(0.5f, DeltaTime / LoadSmoothingHalfLife) : 1.0f;
+	FrameTimeMs = FMath::Lerp(FrameTimeMs, WorkTimeMs, Alpha);
+	NetSaturation = FMath::Lerp(NetSaturation, SaturatedConnections, Alpha);
+
+	if (CanSpawnBots())
+	{
+		//Every match of the server has its own director, only count the bots of this one
+		LiveBots = NumActiveBots;
+	}
+	else
+	{
+		if (!Swarm.IsValid())
+			Swarm = ACSTrackerBotSwarm::Get(GetWorld());
+
+		LiveBots = Swarm.IsValid() ? Swarm->GetNumBots() : 0;
+	}
+
+	Load = FMath::Max3(FrameTimeMs / FrameBudgetMs, NetSaturation / MaxNetSaturation, LiveBots / (float)MaxLiveBots);
+
+	if (!bAdaptiveSpawning)
+		SpawnIntervalScale = 1.0f;
+	else if (Load < AccelerateBelowLoad)
+		SpawnIntervalScale = FMath::Lerp(MinSpawnIntervalScale, 1.0f, Load / AccelerateBelowLoad);
+	else if (Load <= 1.0f)
+		SpawnIntervalScale = 1.0f;
+	else
+		SpawnIntervalScale = FMath::Min(Load * Load, MaxSpawnIntervalScale);
+
+	SET_FLOAT_STAT(STAT_SpawnDirectorFrameTime, FrameTimeMs);
+	SET_FLOAT_STAT(STAT_SpawnDirectorNetSaturation, NetSaturation);
+	SET_FLOAT_STAT(STAT_SpawnDirectorLoad, Load);
+	SET_FLOAT_STAT(STAT_SpawnDirectorIntervalScale, SpawnIntervalScale);
+	SET_DWORD_STAT(STAT_SpawnDirectorLiveBots, LiveBots);
+}
+
+bool UCSSpawnDirectorComponent::ShouldDeferSpawn() const
+{
+	return bAdaptiveSpawning && (Load >= DeferAboveLoad || LiveBots >= MaxLiveBots);
+}
+
+void UCSSpawnDirectorComponent::NotifySpawnDeferred()
+{
+	NumDeferredSpawns++;
+	UE_LOG(LogCoop, Verbose, TEXT("Spawn Director: Spawn deferred, load %.2f (%.1fms, %.0f%% saturated, %d bots)."), Load, FrameTimeMs, NetSaturation * 100.0f, LiveBots);
+}
+
+float UCSSpawnDirectorComponent::GetSpawnInterval(float BaseInterval) const
+{
+	return BaseInterval * SpawnIntervalScale;
+}
+
+#pragma endregion Budget
+
+
+
+void UCSSpawnDirectorComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	UpdateLoad(DeltaTime);
+
+	//Return exploded bots
+	float TimeSeconds = GetWorld()->TimeSeconds;
+	for (int32 i = PendingReleaseBots.Num() - 1; i >= 0; i--)
+	{
+		if (PendingReleaseTimes[i] > TimeSeconds)
+			continue;
+
+		ACSTrackerBot* Bot = PendingReleaseBots[i];
+		PendingReleaseBots.RemoveAtSwap(i, 1, false);
+		PendingReleaseTimes.RemoveAtSwap(i, 1, false);
+
+		AddToPool(Bot);
+	}
+}
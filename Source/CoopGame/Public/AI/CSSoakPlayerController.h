@@ -0,0 +1,61 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AIController.h"
+#include "CSSoakPlayerController.generated.h"
+
+class ACSCharacter;
+
+
+/*
+Stand-in player used by soak tests. Gets a player state and is restarted by the game mode like a real player,
+it walks towards the nearest enemy, shoots it once it is in range and reloads while there is nothing to shoot.
+*/
+UCLASS()
+class COOPGAME_API ACSSoakPlayerController : public AAIController
+{
+	GENERATED_BODY()
+
+public:
+
+	ACSSoakPlayerController();
+
+	/* Possessed pawns do not take damage */
+	void SetInvulnerable(bool bNewInvulnerable) { bInvulnerable = bNewInvulnerable; }
+
+protected:
+
+	/* Enemies within this distance and in sight are shot at */
+	UPROPERTY(EditDefaultsOnly, Category = "Soak Test")
+	float EngageRange;
+
+	/* Distance the stand-in keeps to its target */
+	UPROPERTY(EditDefaultsOnly, Category = "Soak Test")
+	float PreferredRange;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Soak Test")
+	float RetargetInterval;
+
+	bool bInvulnerable;
+
+	bool bFiring;
+
+	TWeakObjectPtr<APawn> Target;
+
+	float RetargetTimeLeft;
+
+	virtual void OnPossess(APawn* InPawn) override;
+
+	virtual void OnUnPossess() override;
+
+	APawn* FindTarget() const;
+
+	void SetFiring(ACSCharacter* MyCharacter, bool bNewFiring);
+
+public:
+
+	virtual void Tick(float DeltaSeconds) override;
+
+};
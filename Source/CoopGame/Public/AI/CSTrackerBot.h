@@ -4,19 +4,66 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Pawn.h"
+#include "Engine/NetSerialization.h"
+#include "CSPoolableActor.h"
+#include "CSTriggerManager.h"
 #include "CSTrackerBot.generated.h"
 
 class UStaticMeshComponent;
 class UCSHealthComponent;
 class UParticleSystem;
-class USphereComponent;
 class USoundCue;
+class ACSTrackerBotSwarm;
+class ACSTrackerBotRenderer;
+class UCSSpawnDirectorComponent;
+
+
+// Quantized tracker bot movement, replaces the default replicated movement. Rotation is derived from the velocity on clients
+USTRUCT()
+struct FCSTrackerBotRepMovement
+{
+	GENERATED_BODY()
+
+public:
+
+	UPROPERTY()
+	FVector Location;
+
+	UPROPERTY()
+	FVector Velocity;
+
+	//Server world time the movement was taken at, clients extrapolate from it
+	UPROPERTY()
+	float ServerTime;
+
+	FCSTrackerBotRepMovement()
+		: Location(ForceInitToZero)
+		, Velocity(ForceInitToZero)
+		, ServerTime(0.0f)
+	{}
+
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
+};
+
+template<>
+struct TStructOpsTypeTraits<FCSTrackerBotRepMovement> : public TStructOpsTypeTraitsBase2<FCSTrackerBotRepMovement>
+{
+	enum
+	{
+		WithNetSerializer = true
+	};
+};
+
 
 UCLASS()
-class COOPGAME_API ACSTrackerBot : public APawn
+class COOPGAME_API ACSTrackerBot : public APawn, public ICSPoolableActor
 {
 	GENERATED_BODY() 
 
+	friend class ACSTrackerBotSwarm;
+	friend class ACSTrackerBotRenderer;
+	friend class UCSSpawnDirectorComponent;
+
 public:
 	// Sets default values for this pawn's properties
 	ACSTrackerBot();
@@ -29,23 +76,50 @@ protected:
 	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Components")
 	UCSHealthComponent* HealthComp;
 
-	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Components")
-	USphereComponent* SphereComp;
-
+	/* Radius of the detonation trigger and of the proximity check with other bots */
 	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Tracker Bot")
 	float SphereCompRadius;
 
+	//Starts the self destruction when a player comes close, enabled while the bot is shown
+	FCSTriggerHandle DetonationTrigger;
+
 	bool bExploded;
 
 	bool bHasStartedSelfDestruction;
 
-	FTimerHandle TimerHandle_DamageSelf;
-	FTimerHandle TimerHandle_BotProximity;
-	FTimerHandle TimerHandle_RefreshPath;
+	//Swarm that updates this bot on the server, replaces the per bot tick and timers
+	TWeakObjectPtr<ACSTrackerBotSwarm> Swarm;
 
-	//Dynamic Material Instance
+	int32 SwarmIndex;
+
+	//Dynamic Material Instance, only used while the bot is not rendered by ACSTrackerBotRenderer
 	UMaterialInstanceDynamic* MatInstance;
 
+	TWeakObjectPtr<ACSTrackerBotRenderer> Renderer;
+
+	int32 RenderBatchIndex;
+	int32 RenderInstanceIndex;
+
+
+	#pragma region Pooling
+
+	//Director of the match that owns the bot, exploded bots go back into the actor pool through it
+	TWeakObjectPtr<UCSSpawnDirectorComponent> SpawnDirector;
+
+	UPROPERTY(ReplicatedUsing = OnRep_PoolState)
+	bool bPooled;
+
+	/* Incremented every time the bot is taken from the pool, lets clients reset bots they saw explode */
+	UPROPERTY(ReplicatedUsing = OnRep_PoolState)
+	uint8 PoolGeneration;
+
+	uint8 LocalPoolGeneration;
+
+	//Match of the director that spawned the bot, only known on the server
+	int32 MatchId;
+
+	#pragma endregion Pooling
+
 
 	#pragma region Movement
 
@@ -65,8 +139,79 @@ protected:
 	UPROPERTY(EditDefaultsOnly, Category = "Tracker Bot|Movement")
 	float MaxTargetMoveDistance;
 
+	/* Time after which the path to the target is recalculated, even if the next path point wasn't reached */
+	UPROPERTY(EditDefaultsOnly, Category = "Tracker Bot|Movement")
+	float RefreshPathInterval;
+
 #pragma endregion Movement
 
+	#pragma region Physics LOD
+
+	/* Bots closer than this to any player simulate full rigid body physics, bots further away roll kinematically */
+	UPROPERTY(EditDefaultsOnly, Category = "Tracker Bot|Physics LOD", meta = (ClampMin = "0.0"))
+	float PhysicsLODRadius;
+
+	/* Extra distance past PhysicsLODRadius a bot has to travel before it drops back to kinematic movement */
+	UPROPERTY(EditDefaultsOnly, Category = "Tracker Bot|Physics LOD", meta = (ClampMin = "0.0"))
+	float PhysicsLODHysteresis;
+
+	/* Update interval used while the bot is moving kinematically */
+	UPROPERTY(EditDefaultsOnly, Category = "Tracker Bot|Physics LOD", meta = (ClampMin = "0.0"))
+	float KinematicTickInterval;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Tracker Bot|Physics LOD", meta = (ClampMin = "0.0"))
+	float KinematicNetUpdateFrequency;
+
+	/* Speed cap for kinematic movement, should roughly match the terminal speed the bot reaches when simulating */
+	UPROPERTY(EditDefaultsOnly, Category = "Tracker Bot|Physics LOD", meta = (ClampMin = "0.0"))
+	float KinematicMaxSpeed;
+
+	bool bKinematicLOD;
+
+	//Net update frequency used while simulating, taken from the defaults on BeginPlay
+	float SimulatedNetUpdateFrequency;
+
+	FVector KinematicVelocity;
+
+	float BotRadius;
+
+	float BotMass;
+
+#pragma endregion Physics LOD
+
+	#pragma region Movement Replication
+
+	UPROPERTY(ReplicatedUsing = OnRep_BotMovement)
+	FCSTrackerBotRepMovement BotMovement;
+
+	/* Distance between where clients extrapolate the bot to and where it really is, before a new movement update is sent */
+	UPROPERTY(EditDefaultsOnly, Category = "Tracker Bot|Replication", meta = (ClampMin = "0.0"))
+	float RepLocationTolerance;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Tracker Bot|Replication", meta = (ClampMin = "0.0"))
+	float RepVelocityTolerance;
+
+	/* Movement is sent at least this often, even if the extrapolation is still accurate */
+	UPROPERTY(EditDefaultsOnly, Category = "Tracker Bot|Replication", meta = (ClampMin = "0.0"))
+	float RepMaxInterval;
+
+	/* Time in which half of the client side prediction error is corrected */
+	UPROPERTY(EditDefaultsOnly, Category = "Tracker Bot|Replication", meta = (ClampMin = "0.0"))
+	float ErrorCorrectionHalfLife;
+
+	/* Prediction errors larger than this snap instead of being corrected smoothly */
+	UPROPERTY(EditDefaultsOnly, Category = "Tracker Bot|Replication", meta = (ClampMin = "0.0"))
+	float ErrorSnapDistance;
+
+	/* Maximum time clients extrapolate past the last movement update */
+	UPROPERTY(EditDefaultsOnly, Category = "Tracker Bot|Replication", meta = (ClampMin = "0.0"))
+	float MaxExtrapolationTime;
+
+	//Client, extrapolation state
+	FVector ErrorOffset;
+
+#pragma endregion Movement Replication
+
 	#pragma region Combat
 
 	UPROPERTY(EditDefaultsOnly, Category = "Tracker Bot")
@@ -83,6 +228,9 @@ protected:
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Tracker Bot|Proximity Attributes")
 	float BotProximityDamageMultiplier;
 
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Tracker Bot|Proximity Attributes")
+	float ProximityCheckInterval;
+
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Tracker Bot|Proximity Attributes")
 	int MaxBotProximityMultiplierCount;
 
@@ -115,6 +263,8 @@ protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
 
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 	void RefreshPath();
 
 	FVector GetNextPathPoint();
@@ -128,10 +278,66 @@ protected:
 
 	void CheckProximity();
 
+	void OnDetonationTriggerEnter(AActor* OtherActor);
+
+	/* Sets a material parameter on the instance custom data or on the dynamic material instance */
+	void SetMaterialParameter(FName ParameterName, int32 CustomDataIndex, float Value);
+
+	/* Shows the bot, either as an instance of ACSTrackerBotRenderer or through its own mesh */
+	void ShowBot();
+
+	void HideBot();
+
+	UFUNCTION()
+	void OnRep_PoolState();
+
+	/* Game thread part of the swarm update, applies the steering the swarm computed for this bot */
+	void ApplySwarmStep(const FVector& SteeringForce, bool bReachedPathPoint, float DistanceToNearestPlayer, float DeltaTime);
+
+	void UpdatePhysicsLOD(float DistanceToNearestPlayer);
+
+	void SetKinematicLOD(bool bNewKinematic);
+
+	void ApplyMovementForce(const FVector& Force, float DeltaTime);
+
+	void TickKinematicMovement(const FVector& Force, float DeltaTime);
+
+	FQuat GetRolledRotation(const FVector& Delta) const;
+
+	FVector GetBotVelocity() const;
+
+	void UpdateRepMovement();
+
+	UFUNCTION()
+	void OnRep_BotMovement();
+
+	void TickClientMovement(float DeltaTime);
+
+	// Client, time since the server took the replicated movement, capped at MaxExtrapolationTime
+	float GetExtrapolationTime() const;
+
 public:	
-	// Called every frame
+
+	/* Takes the bot into the match that owns it and resets health, physics and movement */
+	virtual void OnAcquiredFromPool_Implementation() override;
+
+	/* Takes the bot out of the swarm, it stays in the world hidden and dormant until it is acquired again */
+	virtual void OnReleasedToPool_Implementation() override;
+
+	/* Pooled bots go straight back into the pool on level reset, other bots are destroyed */
+	virtual void Reset() override;
+
+	int32 GetMatchId() const { return MatchId; }
+
 	virtual void Tick(float DeltaTime) override;
 
-	virtual void NotifyActorBeginOverlap(AActor* OtherActor) override;
+	virtual void PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker) override;
+
+	virtual void PostNetReceive() override;
+
+	/* Bots are never relevant to players of other matches. Used when the replication graph is disabled, the graph filters by match itself */
+	virtual bool IsNetRelevantFor(const AActor* RealViewer, const AActor* ViewTarget, const FVector& SrcLocation) const override;
+
+	virtual void NotifyHit(class UPrimitiveComponent* MyComp, AActor* Other, class UPrimitiveComponent* OtherComp, bool bSelfMoved, FVector HitLocation, FVector HitNormal, FVector NormalImpulse, const FHitResult& Hit) override;
 
 };
@@ -0,0 +1,92 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "CSTrackerBotRenderer.generated.h"
+
+class ACSTrackerBot;
+class UStaticMesh;
+class UInstancedStaticMeshComponent;
+
+// Custom data slots read by the tracker bot material through PerInstanceCustomData
+#define TRACKERBOT_CUSTOMDATA_LASTTIMEDAMAGETAKEN	0
+#define TRACKERBOT_CUSTOMDATA_GLOWAMOUNT			1
+#define TRACKERBOT_CUSTOMDATA_NUM					2
+
+
+// All instances of a single tracker bot mesh
+USTRUCT()
+struct FCSTrackerBotInstanceBatch
+{
+	GENERATED_BODY()
+
+public:
+
+	UPROPERTY()
+	UInstancedStaticMeshComponent* InstanceComp;
+
+	//Bot rendered by each instance, nullptr for free instances
+	UPROPERTY()
+	TArray<ACSTrackerBot*> Bots;
+
+	//Transform each instance was last rendered with
+	TArray<FTransform> Transforms;
+
+	TArray<int32> FreeInstances;
+
+	//Instances moved or their custom data changed since the last render state update
+	bool bRenderStateDirty;
+
+	FCSTrackerBotInstanceBatch()
+		: InstanceComp(nullptr)
+		, bRenderStateDirty(false)
+	{}
+};
+
+
+/*
+Renders every tracker bot of a world through one instanced static mesh component per mesh.
+Bots keep their own mesh component for physics and collision, but it is hidden while the bot is instanced.
+The damage flash and glow are passed as per instance custom data instead of a dynamic material instance per bot.
+Instanced static meshes only apply instance changes when their render state is recreated. It is recreated once per frame for
+meshes whose instances moved or changed, never per bot.
+Requires per instance custom data, see COOP_WITH_INSTANCE_CUSTOM_DATA. On older engines bots keep their own mesh and material.
+*/
+UCLASS(NotPlaceable, Transient)
+class COOPGAME_API ACSTrackerBotRenderer : public AActor
+{
+	GENERATED_BODY()
+
+public:
+
+	ACSTrackerBotRenderer();
+
+	/* Returns true if tracker bots in this world should be rendered through the renderer, always false without per instance custom data */
+	static bool IsEnabled(UWorld* World);
+
+	/* Returns the renderer of the given world, spawns one if there is none yet */
+	static ACSTrackerBotRenderer* Get(UWorld* World);
+
+	/* Starts rendering the bot as an instance. Returns false if the bot could not be instanced */
+	bool AddBot(ACSTrackerBot* Bot, UStaticMeshComponent* BotMeshComp);
+
+	void RemoveBot(ACSTrackerBot* Bot);
+
+	void SetCustomData(ACSTrackerBot* Bot, int32 CustomDataIndex, float Value);
+
+protected:
+
+	UPROPERTY(Transient)
+	TArray<FCSTrackerBotInstanceBatch> Batches;
+
+	TMap<UStaticMesh*, int32> BatchIndexByMesh;
+
+	int32 FindOrAddBatch(UStaticMeshComponent* BotMeshComp);
+
+public:
+
+	virtual void Tick(float DeltaSeconds) override;
+
+};
@@ -0,0 +1,133 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "CSTrackerBotSwarm.generated.h"
+
+class ACSTrackerBot;
+
+/*
+Server side manager that updates every tracker bot in one batch.
+Bot state is kept in contiguous arrays, steering is computed on worker threads
+and forces, path queries and the bot timers are applied on the game thread in one pass.
+*/
+UCLASS(NotPlaceable, Transient)
+class COOPGAME_API ACSTrackerBotSwarm : public AActor
+{
+	GENERATED_BODY()
+
+public:
+
+	ACSTrackerBotSwarm();
+
+	/* Returns the swarm of the given world, spawns one if there is none yet */
+	static ACSTrackerBotSwarm* Get(UWorld* World);
+
+	void RegisterBot(ACSTrackerBot* Bot);
+
+	void UnregisterBot(ACSTrackerBot* Bot);
+
+	/* Schedule a path refresh for the bot. Negative delay cancels a pending refresh */
+	void ScheduleRefreshPath(int32 BotIndex, float Delay);
+
+	int32 GetNumBots() const { return Bots.Num(); }
+
+	/* Records a physics contact between two bots, a pair that keeps touching is counted once when the contact starts */
+	void NotifyBotContact(const ACSTrackerBot* Bot, const ACSTrackerBot* Other);
+
+protected:
+
+	/* Below this many bots steering is computed on the game thread */
+	UPROPERTY(EditDefaultsOnly, Category = "Swarm")
+	int32 MinParallelBatchSize;
+
+#pragma region Steering
+
+	/* Bots within this distance of each other are neighbors for separation, alignment and avoidance */
+	UPROPERTY(EditDefaultsOnly, Category = "Swarm|Steering", meta = (ClampMin = "1.0"))
+	float NeighborRadius;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Swarm|Steering", meta = (ClampMin = "0.0"))
+	float SeparationWeight;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Swarm|Steering", meta = (ClampMin = "0.0"))
+	float AlignmentWeight;
+
+	/* Difference to the average neighbor velocity at which alignment steers at full strength, around a bots typical speed */
+	UPROPERTY(EditDefaultsOnly, Category = "Swarm|Steering", meta = (ClampMin = "1.0"))
+	float AlignmentFullSpeed;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Swarm|Steering", meta = (ClampMin = "0.0"))
+	float AvoidanceWeight;
+
+	/* How far ahead in seconds bots look for neighbors they are about to run into */
+	UPROPERTY(EditDefaultsOnly, Category = "Swarm|Steering", meta = (ClampMin = "0.0"))
+	float AvoidanceTime;
+
+	/* Combined steering force is capped at this multiple of the bots movement force */
+	UPROPERTY(EditDefaultsOnly, Category = "Swarm|Steering", meta = (ClampMin = "1.0"))
+	float MaxSteeringForceScale;
+
+#pragma endregion Steering
+
+#pragma region Bot State
+
+	UPROPERTY(Transient)
+	TArray<ACSTrackerBot*> Bots;
+
+	TArray<FVector> Locations;
+	TArray<FVector> Velocities;
+	TArray<float> Radii;
+	TArray<FVector> PathPoints;
+	TArray<float> MovementForces;
+	TArray<float> RequiredDistances;
+
+	//Time accumulated since the last step, kinematic bots step at a reduced rate
+	TArray<float> StepAccumulators;
+	TArray<float> StepDeltaTimes;
+
+	//Countdowns replacing the per bot timers, negative when inactive
+	TArray<float> DamageSelfTimeLeft;
+	TArray<float> ProximityTimeLeft;
+	TArray<float> RefreshPathTimeLeft;
+
+	//Steering output
+	TArray<FVector> SteeringForces;
+	TArray<uint8> PathPointReached;
+	TArray<float> NearestPlayerDistances;
+
+	TArray<FVector> PlayerLocations;
+
+	//Neighbor grid, bot indices sorted by cell and the range of each occupied cell
+	TArray<int64> CellKeys;
+	TArray<int32> SortedBotIndices;
+	TMap<int64, FIntPoint> CellRanges;
+
+	//Bot pairs that touched during the current and the previous physics step, by unique ids
+	TSet<uint64> TouchingPairs;
+	TSet<uint64> PreviousTouchingPairs;
+
+#pragma endregion Bot State
+
+	void CompactBots();
+
+	void GatherBotState(float DeltaSeconds);
+
+	int64 GetCellKey(int32 CellX, int32 CellY) const;
+
+	void BuildNeighborGrid();
+
+	/* Separation, alignment and avoidance from the neighbors of the bot. Safe to call from worker threads */
+	FVector ComputeNeighborSteering(int32 BotIndex) const;
+
+	void ComputeSteering();
+
+	void ApplySteering();
+
+public:
+
+	virtual void Tick(float DeltaSeconds) override;
+
+};
@@ -0,0 +1,146 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "CSActorPool.generated.h"
+
+
+// Pooled actors and counters of one class
+USTRUCT()
+struct FCSActorPoolEntry
+{
+	GENERATED_BODY()
+
+public:
+
+	UPROPERTY()
+	TArray<AActor*> PooledActors;
+
+	//Actors each requester wants kept in the pool, the pool is filled up to their sum
+	TMap<TWeakObjectPtr<const UObject>, int32> PrewarmRequests;
+
+	int32 NumAcquiredFromPool;
+
+	//Acquired while the pool was empty
+	int32 NumMissed;
+
+	int32 NumSpawned;
+
+	//Time spent spawning actors of this class, used to estimate the time the pool saved
+	double SpawnTimeMs;
+
+	FCSActorPoolEntry()
+		: NumAcquiredFromPool(0)
+		, NumMissed(0)
+		, NumSpawned(0)
+		, SpawnTimeMs(0.0)
+	{}
+
+	int32 GetPrewarmTarget() const;
+
+	float GetAverageSpawnTimeMs() const { return NumSpawned > 0 ? (float)(SpawnTimeMs / NumSpawned) : 0.0f; }
+};
+
+
+/*
+Per world pool of actors implementing ICSPoolableActor, on the server and on clients for their local actors.
+Released actors stay in the world hidden. Replicated ones go dormant, so clients keep them and reuse their channel when they are acquired again.
+Requesters ask for a number of actors to be kept in the pool, the pool spawns them a few per frame.
+Actors that don't implement the interface are spawned and destroyed as usual.
+*/
+UCLASS(NotPlaceable, Transient)
+class COOPGAME_API ACSActorPool : public AActor
+{
+	GENERATED_BODY()
+
+public:
+
+	ACSActorPool();
+
+	/* Returns the pool of the given world, spawns one if there is none yet */
+	static ACSActorPool* Get(UWorld* World, bool bCreateIfMissing = true);
+
+	/* Takes an actor of the class from the pool or spawns a new one, at the transform and with owner and instigator of the spawn parameters */
+	AActor* AcquireActor(UClass* ActorClass, const FTransform& Transform, const FActorSpawnParameters& SpawnParams);
+
+	template<class T>
+	T* AcquireActor(UClass* ActorClass, const FTransform& Transform, const FActorSpawnParameters& SpawnParams)
+	{
+		return Cast<T>(AcquireActor(ActorClass, Transform, SpawnParams));
+	}
+
+	/* Puts the actor into the pool, actors that are not poolable are destroyed */
+	void ReleaseActor(AActor* Actor);
+
+	/* Keep NumActors of the class in the pool for the requester, 0 removes the request */
+	void SetPrewarm(UClass* ActorClass, const UObject* Requester, int32 NumActors);
+
+	int32 GetNumPooled(UClass* ActorClass) const;
+
+	/* Returns true while the actor sits in the pool. Actors created by the pool begin play pooled */
+	static bool IsPooled(const AActor* Actor);
+
+	static bool IsPoolable(const UClass* ActorClass);
+
+	/* Spawns through the pool of the world, or like SpawnActor if the world has no pool */
+	template<class T>
+	static T* SpawnPooledActor(UWorld* World, UClass* ActorClass, const FTransform& Transform, const FActorSpawnParameters& SpawnParams)
+	{
+		ACSActorPool* Pool = Get(World);
+		if (Pool)
+			return Pool->AcquireActor<T>(ActorClass, Transform, SpawnParams);
+
+		return World ? Cast<T>(World->SpawnActor(ActorClass, &Transform, SpawnParams)) : nullptr;
+	}
+
+	/* Puts the actor into the pool of its world, use it in place of DestroyActor for poolable actors */
+	UFUNCTION(BlueprintCallable, Category = "Pool")
+	static void ReleaseToPool(AActor* Actor);
+
+protected:
+
+	UPROPERTY(Transient)
+	TMap<UClass*, FCSActorPoolEntry> Entries;
+
+	//Actors currently in the pool, weak so an actor destroyed outside the pool never matches a new one at its address
+	TSet<TWeakObjectPtr<const AActor>> PooledSet;
+
+	/* Acquired actors with an initial life span and the world time at which they go back into the pool */
+	TMap<TWeakObjectPtr<AActor>, float> LifeSpanExpiries;
+
+#pragma region Metrics
+
+	UPROPERTY(VisibleInstanceOnly, BlueprintReadOnly, Transient, Category = "Pool|Metrics")
+	int32 PoolSize;
+
+	/* Fraction of acquired actors that came from the pool */
+	UPROPERTY(VisibleInstanceOnly, BlueprintReadOnly, Transient, Category = "Pool|Metrics")
+	float HitRate;
+
+	/* Spawn time of the actors taken from the pool, estimated from the average spawn time of their class */
+	UPROPERTY(VisibleInstanceOnly, BlueprintReadOnly, Transient, Category = "Pool|Metrics")
+	float SpawnTimeSavedMs;
+
+#pragma endregion Metrics
+
+	// Spawns an actor straight into the pool, it begins play as pooled. The caller adds it to the pooled actors or activates it
+	AActor* SpawnIntoPool(UClass* ActorClass, const FTransform& Transform);
+
+	void DeactivateActor(AActor* Actor);
+
+	void ActivateActor(AActor* Actor, const FTransform& Transform, const FActorSpawnParameters& SpawnParams);
+
+	// Projectiles stop their movement on impact, start it over like on spawn
+	void RestartProjectileMovement(AActor* Actor);
+
+	void UpdateStats();
+
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+public:
+
+	virtual void Tick(float DeltaSeconds) override;
+
+};
@@ -10,6 +10,7 @@ class UCameraComponent;
 class USpringArmComponent;
 class ACSWeapon;
 class UCSHealthComponent;
+class UCSEffectComponent;
 
 
 UCLASS()
@@ -23,11 +24,23 @@ public:
 
 	virtual FVector GetPawnViewLocation() const override;
 
+	/* Characters are never relevant to players of other matches. Used when the replication graph is disabled, the graph filters by match itself */
+	virtual bool IsNetRelevantFor(const AActor* RealViewer, const AActor* ViewTarget, const FVector& SrcLocation) const override;
+
+	virtual void PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker) override;
+
+	virtual void PostNetReceive() override;
+
+	virtual bool CallRemoteFunction(UFunction* Function, void* Parameters, FOutParmRec* OutParms, FFrame* Stack) override;
+
 protected:
 
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Components")
 	UCSHealthComponent* HealthComp;
 
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Components")
+	UCSEffectComponent* EffectComp;
+
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Components")
 	UCameraComponent* CameraComp;
 
@@ -86,6 +99,11 @@ protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
 
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	// Hands the weapon back to the actor pool
+	virtual void Destroyed() override;
+
 
 	//Movement methods
 	void MoveForward(float Value);
@@ -99,6 +117,9 @@ protected:
 	UFUNCTION(BlueprintCallable, Category = "Movement")
 	void SetSpeedMultiplier(float speed);
 
+	// Walk or sprint speed scaled by the speed multiplier and the move speed effects
+	void UpdateMaxSpeed();
+
 
 	//Combat Methods	
 	UFUNCTION(Server, Reliable, WithValidation)
@@ -120,6 +141,9 @@ protected:
 	void OnReloadComplete();
 
 	
+	UFUNCTION()
+	void OnEffectStatsChanged(UCSEffectComponent* EffectComponent);
+
 	UFUNCTION()
 	void OnDeathEvent(UCSHealthComponent* HealthComponent, float HealthDelta, const class UDamageType* DamageType, class AController* InstigatedBy, AActor* DamageCauser);
 
@@ -4,6 +4,7 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
+#include "CSTimingWheel.h"
 #include "CSExplosiveActor.generated.h"
 
 class UStaticMeshComponent;
@@ -39,6 +40,29 @@ public:
 	UPROPERTY(VisibleDefaultsOnly, BlueprintReadOnly, Category = "Actor")
 	bool bHasExploded;
 
+	FTransform InitialTransform;
+
+	/* Time the barrel stays awake after it was hit, long enough for the impulse to settle */
+	UPROPERTY(EditDefaultsOnly, Category = "Explosive Actor|Replication")
+	float DormancyDelay;
+
+	FCSTimerHandle TimerHandle_Dormancy;
+
+	virtual void BeginPlay() override;
+
+	// Replicate the barrel until it settled again
+	void WakeForReplication();
+
+	void GoDormant();
+
+	/* Puts the barrel back where it started with full health */
+	virtual void Reset() override;
+
+	virtual void PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker) override;
+
+	UFUNCTION()
+	void OnHealthChanged(UCSHealthComponent* InHealthComp, float Health, float HealthDelta, const class UDamageType* DamageType, class AController* InstigatedBy, AActor* DamageCauser);
+
 	UFUNCTION()
 	void OnDeath(UCSHealthComponent* InHealthComp, float HealthDelta, const class UDamageType* DamageType, class AController* InstigatedBy, AActor* DamageCauser);
 
@@ -0,0 +1,142 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Misc/MemStack.h"
+
+
+/*
+Linear scratch memory for temporary data of the game thread, freed all at once at the end of the frame.
+Allocating is a pointer bump on pages the page allocator keeps around, there is nothing to free.
+Containers take TCSFrameAllocator, see TCSFrameArray. Anything allocated from it must not outlive the frame.
+
+Builds with COOP_WITH_ALLOC_COUNTERS count the heap allocations of the game thread per frame
+when started with -CountAllocs or -Soak, see the Coop stat group and the soak report.
+*/
+class COOPGAME_API FCSFrameScratch
+{
+public:
+
+	/* Hooks the end of frame reset and installs the allocation counter, called on module startup */
+	static void Startup();
+
+	static void Shutdown();
+
+	/* Scratch memory of the current frame, game thread only */
+	static FMemStackBase& Get();
+
+	/* Heap allocations the game thread made during the last frame, -1 if they are not counted */
+	static int32 GetLastFrameHeapAllocs();
+
+	/* Heap allocations the game thread made since startup, -1 if they are not counted. Diff two reads to measure a block */
+	static int64 GetTotalHeapAllocs();
+
+private:
+
+	static void OnEndFrame();
+};
+
+
+/*
+Allocator policy for containers in frame scratch memory, same as TMemStackAllocator on the scratch of FCSFrameScratch.
+Growing copies into a new block, the old one stays until the frame ends.
+*/
+template<uint32 Alignment = DEFAULT_ALIGNMENT>
+class TCSFrameAllocator
+{
+public:
+
+	typedef int32 SizeType;
+
+	enum { NeedsElementType = true };
+	enum { RequireRangeCheck = true };
+
+	class ForAnyElementType
+	{
+	public:
+
+		ForAnyElementType() : Data(nullptr) { }
+
+		FORCEINLINE void MoveToEmpty(ForAnyElementType& Other)
+		{
+			checkSlow(this != &Other);
+
+			Data = Other.Data;
+			Other.Data = nullptr;
+		}
+
+		FORCEINLINE FScriptContainerElement* GetAllocation() const
+		{
+			return Data;
+		}
+
+		void ResizeAllocation(SizeType PreviousNumElements, SizeType NumElements, SIZE_T NumBytesPerElement)
+		{
+			void* OldData = Data;
+			if (NumElements)
+			{
+				Data = (FScriptContainerElement*)FCSFrameScratch::Get().PushBytes(NumElements * NumBytesPerElement, Alignment);
+
+				if (OldData && PreviousNumElements)
+					FMemory::Memcpy(Data, OldData, FMath::Min(NumElements, PreviousNumElements) * NumBytesPerElement);
+			}
+		}
+
+		FORCEINLINE SizeType CalculateSlackReserve(SizeType NumElements, SIZE_T NumBytesPerElement) const
+		{
+			return DefaultCalculateSlackReserve(NumElements, NumBytesPerElement, true, Alignment);
+		}
+
+		FORCEINLINE SizeType CalculateSlackShrink(SizeType NumElements, SizeType NumAllocatedElements, SIZE_T NumBytesPerElement) const
+		{
+			return DefaultCalculateSlackShrink(NumElements, NumAllocatedElements, NumBytesPerElement, true, Alignment);
+		}
+
+		FORCEINLINE SizeType CalculateSlackGrow(SizeType NumElements, SizeType NumAllocatedElements, SIZE_T NumBytesPerElement) const
+		{
+			return DefaultCalculateSlackGrow(NumElements, NumAllocatedElements, NumBytesPerElement, true, Alignment);
+		}
+
+		SIZE_T GetAllocatedSize(SizeType NumAllocatedElements, SIZE_T NumBytesPerElement) const
+		{
+			return NumAllocatedElements * NumBytesPerElement;
+		}
+
+		bool HasAllocation()
+		{
+			return !!Data;
+		}
+
+	private:
+
+		ForAnyElementType(const ForAnyElementType&);
+		ForAnyElementType& operator=(const ForAnyElementType&);
+
+		FScriptContainerElement* Data;
+	};
+
+	template<typename ElementType>
+	class ForElementType : public ForAnyElementType
+	{
+	public:
+
+		ForElementType() { }
+
+		FORCEINLINE ElementType* GetAllocation() const
+		{
+			return (ElementType*)ForAnyElementType::GetAllocation();
+		}
+	};
+};
+
+template<uint32 Alignment>
+struct TAllocatorTraits<TCSFrameAllocator<Alignment>> : TAllocatorTraitsBase<TCSFrameAllocator<Alignment>>
+{
+	enum { SupportsMove = true };
+};
+
+
+// Temporary array of the game thread, gone at the end of the frame
+template<typename ElementType>
+using TCSFrameArray = TArray<ElementType, TCSFrameAllocator<>>;
@@ -6,7 +6,8 @@
 #include "GameFramework/GameModeBase.h"
 #include "CSGameMode.generated.h"
 
-enum class EWaveState : uint8;
+class ACSMatchInstance;
+class UCSSoakTestComponent;
 
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_ThreeParams(FOnActorKilled, AActor*, VictimActor, AActor*, KillerActor, AController*, KillerController); 
 
@@ -15,6 +16,8 @@ class COOPGAME_API ACSGameMode : public AGameModeBase
 {
 	GENERATED_BODY()
 
+	friend class ACSMatchInstance;
+
 public:
 
 	ACSGameMode();
@@ -22,57 +25,75 @@ public:
 
 protected:
 
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Components")
+	UCSSoakTestComponent* SoakTestComp;
+
 	UPROPERTY(EditDefaultsOnly, Category = "Game Mode")
 	float WaveInterval;
 
 	UPROPERTY(EditDefaultsOnly, Category = "Game Mode")
 	float BotSpawnInterval;
-	
 
-	UPROPERTY(BlueprintReadOnly, Category = "Game Mode")
-	int WaveCount;
+	/* Seconds a match stays in the game over state before it restarts, so clients can show it */
+	UPROPERTY(EditDefaultsOnly, Category = "Game Mode", meta = (ClampMin = "0.0"))
+	float GameOverResetDelay;
 
-	//Bots to spawn in current wave
-	UPROPERTY(BlueprintReadOnly, Category = "Game Mode")
-	int NumOfBotsToSpawn;
-	
-	FTimerHandle TimerHandle_BotSpawner;
-	FTimerHandle TimerHandle_NextWaveStart;
+#pragma region Matches
 
-protected:
+	/* Runs the waves of a match, its spawn director holds the bot class */
+	UPROPERTY(EditDefaultsOnly, Category = "Game Mode|Matches")
+	TSubclassOf<ACSMatchInstance> MatchInstanceClass;
 
+	/* Matches hosted at the same time, each needs its own arena in the map. -Matches= */
+	UPROPERTY(EditDefaultsOnly, Category = "Game Mode|Matches", meta = (ClampMin = "1"))
+	int32 MaxMatches;
 
-	
-	// Start spawning bots
-	void StartWave();
+	/* New players join the first match with room and open a new match once all are full */
+	UPROPERTY(EditDefaultsOnly, Category = "Game Mode|Matches", meta = (ClampMin = "1"))
+	int32 MaxPlayersPerMatch;
+
+	/* Arena N is tagged <Prefix><N>. Player starts use it as their PlayerStartTag, other actors as an actor tag */
+	UPROPERTY(EditDefaultsOnly, Category = "Game Mode|Matches")
+	FName ArenaTagPrefix;
 
-	void SpawnBotTimerElapsed();
+	UPROPERTY(Transient)
+	TArray<ACSMatchInstance*> Matches;
 
-	/* Hook for BP to spawn a single bot */
+#pragma endregion Matches
+
+protected:
+
+	/* Hook for BP to spawn a single bot, only used if the spawn director of the match has no bot class */
 	UFUNCTION(BlueprintImplementableEvent, Category = "Game Mode")
 	void SpawnNewBot();
 
-	// Stop spawning bots
-	void EndWave();
+	ACSMatchInstance* GetOrCreateMatch(int32 MatchId);
+
+	// Puts the player into the first match with room, stand-in players are assigned when they are first restarted
+	ACSMatchInstance* AssignPlayerToMatch(AController* Player);
 
-	// Set timer for next wave
-	void PrepareForNextWave();
+public:
 
-	void CheckWaveState();
+	virtual void InitGame(const FString& MapName, const FString& Options, FString& ErrorMessage) override;
 
-	void CheckAnyPlayerAlive();
+	virtual void StartPlay() override;
 
-	void GameOver();
+	virtual void Tick(float DeltaSeconds) override;
 
-	void SetWaveState(EWaveState NewState);
+	virtual void PostLogin(APlayerController* NewPlayer) override;
 
-	void RestartDeadPlayers();
+	/* Picks a player start of the player's arena if the server hosts several matches */
+	virtual AActor* ChoosePlayerStart_Implementation(AController* Player) override;
 
-public:
+	/* Returns the match of the controller, nullptr if it was not assigned yet */
+	UFUNCTION(BlueprintCallable, Category = "Game Mode")
+	ACSMatchInstance* GetMatchForController(AController* Controller) const;
 
-	virtual void StartPlay() override;
+	UFUNCTION(BlueprintCallable, Category = "Game Mode")
+	int32 GetNumMatches() const { return Matches.Num(); }
 
-	virtual void Tick(float DeltaSeconds) override;
+	/* Returns the match with the id, nullptr if it was not opened */
+	ACSMatchInstance* GetMatch(int32 MatchId) const { return Matches.IsValidIndex(MatchId) ? Matches[MatchId] : nullptr; }
 
 	/* Returns when an actor dies. Killed actor, Killer actor, Killer controller */
 	UPROPERTY(BlueprintAssignable, Category = "Game Mode")
@@ -28,16 +28,16 @@ class COOPGAME_API ACSGameState : public AGameStateBase
 {
 	GENERATED_BODY()
 
+public:
+
+	ACSGameState();
 
 protected:
 
-	UPROPERTY(ReplicatedUsing = OnRep_WaveState, BlueprintReadOnly, Category = "Game State")
+	/* Wave state of the local player's match, set by the replicated ACSMatchInstance */
+	UPROPERTY(BlueprintReadOnly, Category = "Game State")
 	EWaveState WaveState;
 
-
-
-	UFUNCTION()
-	void OnRep_WaveState(EWaveState OldState);
 	
 	UFUNCTION(BlueprintImplementableEvent, Category = "Game State")
 	void WaveStateChanged(EWaveState NewState, EWaveState OldState);
@@ -47,4 +47,10 @@ public:
 
 	UFUNCTION()
 	void SetWaveState(EWaveState NewState);
+
+	virtual void Reset() override;
+
+	virtual void PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker) override;
+
+	virtual void PostNetReceive() override;
 };
@@ -0,0 +1,64 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "CSTimingWheel.h"
+#include "CSGameplayScheduler.generated.h"
+
+
+/*
+Per world scheduler for gameplay timers, on the server and on clients. Runs the timers on a FCSTimingWheel,
+takes the same arguments as FTimerManager and fires its timers after physics like it.
+Timers of an actor are cleared when it ends play, other owners clear theirs with ClearAllTimersForObject.
+Timers fire on ticks of COOP.SchedulerResolution seconds, read when the scheduler is created.
+*/
+UCLASS(NotPlaceable, Transient)
+class COOPGAME_API ACSGameplayScheduler : public AActor
+{
+	GENERATED_BODY()
+
+public:
+
+	ACSGameplayScheduler();
+
+	/* Returns the scheduler of the given world, spawns one if there is none yet */
+	static ACSGameplayScheduler* Get(UWorld* World, bool bCreateIfMissing = true);
+
+	template<class UserClass>
+	void SetTimer(FCSTimerHandle& InOutHandle, UserClass* Object, typename FTimerDelegate::TUObjectMethodDelegate<UserClass>::FMethodPtr Method, float Rate, bool bLoop = false, float FirstDelay = -1.0f)
+	{
+		SetTimer(InOutHandle, Object, FTimerDelegate::CreateUObject(Object, Method), Rate, bLoop, FirstDelay);
+	}
+
+	/* A rate of 0 or less clears the timer. Setting an active timer again moves it and keeps its handle */
+	void SetTimer(FCSTimerHandle& InOutHandle, const UObject* Owner, const FTimerDelegate& Delegate, float Rate, bool bLoop = false, float FirstDelay = -1.0f);
+
+	void ClearTimer(FCSTimerHandle& InOutHandle);
+
+	void ClearAllTimersForObject(const UObject* Owner);
+
+	bool IsTimerActive(const FCSTimerHandle& Handle) const { return Wheel.IsTimerActive(Handle); }
+
+	/* Seconds until the timer fires, -1 if it is not active */
+	float GetTimerRemaining(const FCSTimerHandle& Handle) const;
+
+	int32 GetNumTimers() const { return Wheel.GetNumTimers(); }
+
+protected:
+
+	FCSTimingWheel Wheel;
+
+	virtual void BeginPlay() override;
+
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	UFUNCTION()
+	void OnOwnerEndPlay(AActor* Actor, EEndPlayReason::Type EndPlayReason);
+
+public:
+
+	virtual void Tick(float DeltaSeconds) override;
+
+};
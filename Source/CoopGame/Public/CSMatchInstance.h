@@ -0,0 +1,143 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Info.h"
+#include "CSGameState.h"
+#include "CSTimingWheel.h"
+#include "CSMatchInstance.generated.h"
+
+class ACSGameMode;
+class UCSSpawnDirectorComponent;
+
+
+/*
+One co-op match run by the game mode. A dedicated server can run several matches in one world, each in its own arena.
+A match has its own waves, spawn director and players, is only relevant to its own players and resets only its own actors on game over.
+Actors belong to a match through their player state, owner or instigator. Level actors of an arena carry the arena tag.
+Arenas share the world, navmesh and loaded assets. UCSReplicationGraph keeps actors of other matches and arenas away from a match's players.
+*/
+UCLASS(NotPlaceable)
+class COOPGAME_API ACSMatchInstance : public AInfo
+{
+	GENERATED_BODY()
+
+	friend class ACSGameMode;
+
+public:
+
+	ACSMatchInstance();
+
+protected:
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Components")
+	UCSSpawnDirectorComponent* SpawnDirectorComp;
+
+	UPROPERTY(Replicated, BlueprintReadOnly, Category = "Match")
+	int32 MatchId;
+
+	/* Player starts, bot spawn origins, pickups and barrels of the arena carry this tag. Only used if the server runs several matches */
+	UPROPERTY(Replicated, BlueprintReadOnly, Category = "Match")
+	FName ArenaTag;
+
+	UPROPERTY(ReplicatedUsing = OnRep_WaveState, BlueprintReadOnly, Category = "Match")
+	EWaveState WaveState;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Match")
+	int32 WaveCount;
+
+	//Bots to spawn in current wave
+	UPROPERTY(BlueprintReadOnly, Category = "Match")
+	int32 NumOfBotsToSpawn;
+
+	//Waves run while the match has players
+	bool bMatchStarted;
+
+	FCSTimerHandle TimerHandle_BotSpawner;
+	FCSTimerHandle TimerHandle_NextWaveStart;
+	FCSTimerHandle TimerHandle_GameOverReset;
+
+	/* Time the last in place match restart took */
+	UPROPERTY(VisibleInstanceOnly, BlueprintReadOnly, Transient, Category = "Match")
+	float LastRestartTimeMs;
+
+	virtual void BeginPlay() override;
+
+	ACSGameMode* GetGameMode() const;
+
+	void StartMatch();
+
+	// Stop the waves and clear the arena after the last player left
+	void StopMatch();
+
+	// Start spawning bots
+	void StartWave();
+
+	void SpawnBotTimerElapsed();
+
+	// Set timer for the next bot, the spawn director paces it by server load
+	void ScheduleNextBotSpawn();
+
+	// Stop spawning bots
+	void EndWave();
+
+	// Set timer for next wave
+	void PrepareForNextWave();
+
+	void CheckWaveState();
+
+	void CheckAnyPlayerAlive();
+
+	void GameOver();
+
+	// Restart the match once the game over was shown
+	void GameOverResetElapsed();
+
+	// Reset the match in place, clients stay connected
+	void ResetMatch();
+
+	// Reset the actors of this match only, other matches keep playing
+	void ResetMatchActors();
+
+	void RestartDeadPlayers();
+
+	void SetWaveState(EWaveState NewState);
+
+	UFUNCTION()
+	void OnRep_WaveState();
+
+	// Returns true if this is the match of the local player, its wave state is shown by the game state
+	bool IsLocalMatch() const;
+
+public:
+
+	/* Returns the match the actor belongs to, INDEX_NONE for actors shared by all matches */
+	static int32 FindMatchId(const AActor* Actor);
+
+	/* Returns false if the actors belong to different matches */
+	static bool IsSameMatch(const AActor* ActorA, const AActor* ActorB);
+
+	/* Set by the game mode before the match begins play */
+	void InitMatch(int32 InMatchId, FName InArenaTag);
+
+	int32 GetMatchId() const { return MatchId; }
+
+	FName GetArenaTag() const { return ArenaTag; }
+
+	/* Returns true if the actor belongs to this match or is a level actor of its arena */
+	bool ContainsActor(const AActor* Actor) const;
+
+	/* Number of controllers with a player state in this match, stand-in players included */
+	UFUNCTION(BlueprintCallable, Category = "Match")
+	int32 GetNumPlayers() const;
+
+	/* Called by the game mode once per game mode tick. Starts the waves once the first player joined */
+	void UpdateMatch();
+
+	virtual void Reset() override;
+
+	/* Only relevant to the players of this match. Used when the replication graph is disabled, the graph adds the match instance per connection */
+	virtual bool IsNetRelevantFor(const AActor* RealViewer, const AActor* ViewTarget, const FVector& SrcLocation) const override;
+
+};
@@ -0,0 +1,31 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class AActor;
+
+
+/*
+Counts how often actors are considered for replication, per class.
+Actors call NotifyConsidered from PreReplication, which the net driver and the replication graph call for every actor they replicate.
+COOP.LogNetConsidered 1 logs the counts once per second. COOP.NetDormancy 0 keeps dormant classes awake to compare against.
+*/
+class COOPGAME_API FCSNetStats
+{
+public:
+
+	static void NotifyConsidered(const AActor* Actor);
+
+	/* Returns false if actors that normally go dormant should stay awake */
+	static bool IsDormancyEnabled();
+
+private:
+
+	static TMap<FName, int32> ConsideredCounts;
+
+	static double CountStartTime;
+
+	static void LogConsideredCounts(double Now);
+};
@@ -0,0 +1,36 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "CSPacketCompressionCommandlet.generated.h"
+
+
+/*
+Trains the packet dictionary on captured packets and benchmarks the packet codec on them.
+Capture traffic first by playing a local listen or dedicated server and client with COOP.PacketCapture 1 on both.
+
+-run=CSPacketCompression -Train [-DictSize=4096]	Writes the dictionary to Content/Net/CoopPackets.dict
+-run=CSPacketCompression -Bench [-Level=1]			Logs compression ratio and time per packet with and without the dictionary
+Captures started within a minute of each other form a session. Every other session trains the dictionary, the benchmark runs on the sessions in between,
+so it measures traffic the dictionary was not trained on. Benchmarking needs captures of at least two sessions.
+-Captures=<dir> reads the captures from another directory than Saved/NetCaptures.
+*/
+UCLASS()
+class COOPGAME_API UCSPacketCompressionCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+
+	virtual int32 Main(const FString& Params) override;
+
+protected:
+
+	// Fill the dictionary with the byte sequences found in most packets, the most common ones last where deflate reaches them cheapest
+	void TrainDictionary(const TArray<TArray<uint8>>& Packets, int32 DictSize, TArray<uint8>& OutDictionary) const;
+
+	void Benchmark(const TArray<TArray<uint8>>& Packets, const TArray<uint8>* Dictionary, int32 Level, const TCHAR* Label) const;
+
+};
@@ -0,0 +1,161 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "PacketHandler.h"
+#include "CSPacketCompressionComponent.generated.h"
+
+struct z_stream_s;
+
+
+/*
+Preset dictionary for packet compression, trained on recorded CoopGame traffic by the CSPacketCompression commandlet.
+Loaded once from Content/Net. Without a dictionary file packets are compressed without one.
+*/
+struct COOPGAME_API FCSPacketDictionary
+{
+	TArray<uint8> Data;
+
+	/* Both ends of a connection compress only if their dictionary hashes match */
+	uint32 Hash;
+
+	FCSPacketDictionary() : Hash(0) { }
+
+	static const FCSPacketDictionary& Get();
+
+	static FString GetDefaultPath();
+
+	/* Largest dictionary the codec can reference, deflate only looks back 32KB */
+	static const int32 MaxSize = 16 * 1024;
+};
+
+
+/*
+Raw deflate with a preset dictionary. Every packet is compressed on its own, lost packets never stall the stream.
+The dictionary is hashed into a template stream once, every packet is compressed by a copy of it in memory the codec keeps around.
+The window is only as large as the dictionary and the largest packet need, which keeps the copy small.
+*/
+class COOPGAME_API FCSPacketCodec
+{
+public:
+
+	FCSPacketCodec();
+
+	~FCSPacketCodec();
+
+	/* The dictionary has to outlive the codec, nullptr compresses without one */
+	bool Init(const TArray<uint8>* InDictionary, int32 Level);
+
+	bool IsValid() const { return DeflateTemplate != nullptr && InflateStream != nullptr; }
+
+	bool Compress(const uint8* Src, int32 SrcSize, TArray<uint8>& OutData);
+
+	/* Fails unless exactly DestSize bytes were decompressed */
+	bool Decompress(const uint8* Src, int32 SrcSize, uint8* Dest, int32 DestSize);
+
+private:
+
+	//Primed with the dictionary once, never compresses itself
+	z_stream_s* DeflateTemplate;
+
+	//Copy of the template for the current packet
+	z_stream_s* DeflateStream;
+	bool bDeflateStreamCopied;
+
+	z_stream_s* InflateStream;
+
+	const TArray<uint8>* Dictionary;
+
+	//Memory of the per packet copy, handed out again for every packet
+	TArray<uint8> CopyArena;
+	int32 CopyArenaUsed;
+	int32 CopyArenaRequired;
+
+	// zlib allocation functions of the per packet copy, fall back to the heap until the arena has grown to fit
+	static void* AllocCopy(void* Opaque, uint32 Items, uint32 Size);
+	static void FreeCopy(void* Opaque, void* Address);
+
+	void Release();
+
+};
+
+
+/*
+Packet handler component compressing the packets of a connection with FCSPacketCodec.
+Each end sends the hash of its dictionary until the other end confirmed receiving it, packets are only compressed towards an end with the same dictionary.
+Packets that do not get smaller are sent as they are, so a connection never sends more than a few header bits over the raw size.
+COOP.PacketCapture 1 records raw outgoing packets to Saved/NetCaptures for dictionary training.
+*/
+class COOPGAME_API FCSPacketCompressionComponent : public HandlerComponent
+{
+public:
+
+	FCSPacketCompressionComponent();
+
+	virtual ~FCSPacketCompressionComponent();
+
+	virtual void Initialize() override;
+
+	virtual bool IsValid() const override;
+
+	virtual void Incoming(FBitReader& Packet) override;
+
+	virtual void Outgoing(FBitWriter& Packet, FOutPacketTraits& Traits) override;
+
+	virtual void IncomingConnectionless(const FString& Address, FBitReader& Packet) override { }
+
+	virtual void OutgoingConnectionless(const FString& Address, FBitWriter& Packet, FOutPacketTraits& Traits) override { }
+
+	virtual int32 GetReservedPacketBits() const override;
+
+	/* Directory COOP.PacketCapture writes to and the commandlet reads from */
+	static FString GetCaptureDir();
+
+	/* Capture files hold the packets back to back, each as its bit count followed by its bytes */
+	static bool LoadCapturedPackets(const FString& Filename, TArray<TArray<uint8>>& OutPackets);
+
+private:
+
+	FCSPacketCodec Codec;
+
+	//The other end uses the same dictionary, packets to it may be compressed
+	bool bPeerDictionaryMatches;
+
+	//The hash of the other end arrived, it is confirmed on every packet whether it matches or not
+	bool bReceivedPeerHash;
+
+	//The other end received our hash, stop sending it
+	bool bPeerConfirmedDictionary;
+
+	TArray<uint8> CompressedData;
+
+	TArray<uint8> DecompressedData;
+
+	//Totals of this connection, logged when it closes
+	int64 RawBytesSent;
+	int64 BytesSent;
+	int32 PacketsSent;
+	int32 PacketsCompressed;
+	uint64 CompressCycles;
+
+	static void CapturePacket(const uint8* Data, int32 NumBits);
+
+	static void FlushCapture();
+
+};
+
+
+/*
+Adds the component to a packet handler, listed under [PacketHandlerComponents] in DefaultEngine.ini.
+*/
+UCLASS()
+class COOPGAME_API UCSPacketCompressionComponentFactory : public UHandlerComponentFactory
+{
+	GENERATED_BODY()
+
+public:
+
+	virtual TSharedPtr<HandlerComponent> CreateComponentInstance(FString& Options) override;
+
+};
@@ -4,6 +4,8 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
+#include "CSTimingWheel.h"
+#include "CSTriggerManager.h"
 #include "CSPickupActor.generated.h"
 
 class USphereComponent;
@@ -21,6 +23,7 @@ public:
 
 protected:
 
+	/* Only sizes the pickup trigger, overlaps are tested by ACSTriggerManager */
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Components")
 	USphereComponent* SphereComp;
 
@@ -36,16 +39,26 @@ protected:
 	UPROPERTY(EditInstanceOnly, Category = "Pickup")
 	float CooldownDuration;
 
-	FTimerHandle TimerHandle_RespawnTimer;
+	FCSTimerHandle TimerHandle_RespawnTimer;
+
+	FCSTriggerHandle PickupTrigger;
 
 
 
 	virtual void BeginPlay() override;
 
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 	void Respawn();
 
+	// Hands the powerup to the character that walked in
+	void OnPickupTriggerEnter(AActor* OtherActor);
+
 public:
 
-	virtual void NotifyActorBeginOverlap(AActor* OtherActor) override;
+	/* Respawns the powerup right away if it was picked up */
+	virtual void Reset() override;
+
+	virtual void PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker) override;
 
 };
@@ -14,9 +14,64 @@ class COOPGAME_API ACSPlayerState : public APlayerState
 {
 	GENERATED_BODY()
 
+public:
+
+	ACSPlayerState();
+
+	virtual bool CallRemoteFunction(UFunction* Function, void* Parameters, FOutParmRec* OutParms, FFrame* Stack) override;
+
+	/* Only relevant to players of the same match. Used when the replication graph is disabled, the graph adds player states per connection */
+	virtual bool IsNetRelevantFor(const AActor* RealViewer, const AActor* ViewTarget, const FVector& SrcLocation) const override;
+
+protected:
+
+	/* Match instance the player plays in, INDEX_NONE until the game mode assigned one */
+	UPROPERTY(Replicated, BlueprintReadOnly, Category = "Player State")
+	int32 MatchId;
+
+#pragma region Join In Progress
+
+	//Server real time the player logged in, negative for players that never joined over the network
+	float JoinTime;
+
+	/* Time from login until the client had its pawn, weapon and the game state. Measured on the server, half the ping is taken off */
+	UPROPERTY(VisibleInstanceOnly, BlueprintReadOnly, Transient, Category = "Player State|Join")
+	float TimeToPlayableMs;
+
+	//Owning client only, the report is sent once per join
+	bool bReportedPlayable;
+
+	UFUNCTION(Server, Reliable, WithValidation)
+	void ServerReportPlayable();
+
+#pragma endregion Join In Progress
+
 public:
 
 	UFUNCTION(BlueprintCallable, Category = "Player State")
 	void AddScore(float ScoreDelta);
+
+	int32 GetMatchId() const { return MatchId; }
+
+	void SetMatchId(int32 NewMatchId) { MatchId = NewMatchId; }
+
+	/* Called by the game mode on login, starts streaming the world in around the player */
+	void NotifyLoggedIn();
+
+	/* Called on the owning client once it can play, reports the time to the server */
+	void ReportPlayable();
+
+	/* Returns true while the world is still streamed in to the player after its login */
+	bool IsStreamingIn() const;
+
+	/* Radius around the viewer that is replicated while the player streams in */
+	float GetJoinStreamRadius() const;
+
+	/*
+	Returns false for actors held back from a client that is still streaming in, given its current GetJoinStreamRadius.
+	Characters, bots, pickups, powerups and barrels arrive by distance from the viewer, the viewer's own pawn and weapon go first.
+	Applied by UCSReplicationGraphNode_MatchGrid to the actors it gathers for the connection.
+	*/
+	static bool IsJoinStreamRelevant(const AActor* Actor, const AActor* Viewer, const FVector& ViewLocation, float StreamRadius);
 	
 };
@@ -0,0 +1,35 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Interface.h"
+#include "CSPoolableActor.generated.h"
+
+
+UINTERFACE(BlueprintType)
+class COOPGAME_API UCSPoolableActor : public UInterface
+{
+	GENERATED_BODY()
+};
+
+/*
+Actors implementing this are recycled by ACSActorPool instead of being destroyed.
+The pool hides pooled actors, disables their collision and tick and puts replicated ones to sleep, the actor resets its own state.
+Blueprint actors implement it in the class settings and call ReleaseToPool instead of DestroyActor.
+*/
+class COOPGAME_API ICSPoolableActor
+{
+	GENERATED_BODY()
+
+public:
+
+	/* Called after the actor was taken from the pool and moved to its spawn transform. Restore the state of a freshly spawned actor */
+	UFUNCTION(BlueprintNativeEvent, Category = "Pool")
+	void OnAcquiredFromPool();
+
+	/* Called before the actor is hidden in the pool. Stop timers and effects */
+	UFUNCTION(BlueprintNativeEvent, Category = "Pool")
+	void OnReleasedToPool();
+
+};
@@ -4,10 +4,13 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
+#include "CSPoolableActor.h"
+#include "CSTimingWheel.h"
+#include "Components/CSEffectComponent.h"
 #include "CSPowerupActor.generated.h"
 
 UCLASS()
-class COOPGAME_API ACSPowerupActor : public AActor
+class COOPGAME_API ACSPowerupActor : public AActor, public ICSPoolableActor
 {
 	GENERATED_BODY()
 	
@@ -35,7 +38,23 @@ protected:
 	UPROPERTY(VisibleInstanceOnly, BlueprintReadOnly, Category = "Powerup")
 	int32 TicksProcessed;
 
-	FTimerHandle TimerHandle_PowerupTick;
+	FCSTimerHandle TimerHandle_PowerupTick;
+
+	/* Stat effects applied to the activating actor. Timed effects expire on the clock of its effect component,
+	effects without a duration are removed when the powerup expires */
+	UPROPERTY(EditDefaultsOnly, Category = "Powerup")
+	TArray<FCSEffectSpec> Effects;
+
+	//Effect component the effects were added to
+	TWeakObjectPtr<UCSEffectComponent> EffectTarget;
+
+	//Effects without a duration
+	TArray<int32> PowerupEffectIds;
+
+	// Removes the effects that last as long as the powerup
+	void RemoveEffects();
+
+	virtual void BeginPlay() override;
 
 	//Replicates the state of Powerup
 	UFUNCTION()
@@ -53,6 +72,15 @@ public:
 	
 	void ActivatePowerup(AActor* TriggeringActor);
 
+	/* Releases powerups that were already picked up to the pool, unused ones stay with their pickup */
+	virtual void Reset() override;
+
+	virtual void OnAcquiredFromPool_Implementation() override;
+
+	virtual void OnReleasedToPool_Implementation() override;
+
+	virtual void PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker) override;
+
 	UFUNCTION(BlueprintImplementableEvent, Category = "Powerup")
 	void OnActivated();
 
@@ -19,6 +19,16 @@ protected:
 	UPROPERTY(EditDefaultsOnly, Category = "Weapon")
 	TSubclassOf<AActor> ProjectileClass;
 
+	//Projectiles fired by this weapon, released with the weapon on reset. They are owned by the weapon until the pool hands them to another one
+	TArray<TWeakObjectPtr<AActor>> SpawnedProjectiles;
+
+	// Returns true while the projectile is flying for this weapon, false once it went back to the pool or was acquired by another weapon
+	bool IsOwnProjectile(const TWeakObjectPtr<AActor>& Projectile) const;
+
 	void Fire() override;
+
+public:
+
+	virtual void Reset() override;
 	
 };
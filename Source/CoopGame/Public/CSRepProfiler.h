@@ -0,0 +1,76 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CoopGame.h"
+
+class AActor;
+class UFunction;
+
+
+/*
+Attributes replication bandwidth to class, property and RPC per connection over a profiling window.
+COOP.RepProfile.Start opens the window, COOP.RepProfile.Stop [Bits|Sends|Changes|Reads] closes it, logs the most expensive
+entries and writes the whole report as CSV to Saved/RepProfile. -RepProfile profiles the whole session.
+
+Servers compare the replicated properties of an actor and its replicated components against a copy taken the last time the
+actor was considered for replication, clients the last time the actor received an update. Every changed property is serialized
+on its own to estimate its size and attributed to the connections with a channel for the actor, respecting owner conditions.
+Object references count as 32 bits. Bunch headers, packet overhead and changes coalesced between sends are not included.
+
+Reads are counted where code calls COOP_REP_READ, blueprint and engine reads are not. A read site is known once it ran in
+the session, properties without a known read site are reported as not instrumented. Instrumented properties changing more than
+once a second and read less than once per 10 changes are flagged, they are the first candidates for a lower update rate or a condition.
+*/
+class COOPGAME_API FCSRepProfiler
+{
+public:
+
+	/* Starts profiling if the game was started with -RepProfile, called on module startup */
+	static void Startup();
+
+	/* Writes the report of a running window */
+	static void Shutdown();
+
+	static void Start();
+
+	/* Ends the window and writes the report, sorted by Bits, Sends, Changes or Reads */
+	static void Stop(const FString& SortBy = FString());
+
+	static bool IsProfiling();
+
+	/* Measures the properties that changed since the last call, called by servers from PreReplication */
+	static void NotifyPreReplication(AActor* Actor);
+
+	/* Measures the properties the actor received, called by clients from PostNetReceive */
+	static void NotifyPostNetReceive(AActor* Actor);
+
+	/* Measures an RPC being sent, called from CallRemoteFunction */
+	static void NotifyRemoteFunction(AActor* Actor, UFunction* Function, void* Parameters);
+
+	/* Counts a read of a replicated property, see COOP_REP_READ */
+	static void NotifyRead(const UObject* Object, FName PropertyName);
+
+	/* Marks reads of the property as instrumented, called once per COOP_REP_READ site */
+	static void RegisterReadSite(const UClass* Class, FName PropertyName);
+};
+
+
+// Counts a read of the replicated property of this object for the replication profiler
+#if COOP_WITH_REP_PROFILER
+#define COOP_REP_READ(Property) \
+	do \
+	{ \
+		static bool bReadSiteRegistered = false; \
+		if (!bReadSiteRegistered) \
+		{ \
+			bReadSiteRegistered = true; \
+			FCSRepProfiler::RegisterReadSite(ThisClass::StaticClass(), GET_MEMBER_NAME_CHECKED(ThisClass, Property)); \
+		} \
+		if (FCSRepProfiler::IsProfiling()) \
+			FCSRepProfiler::NotifyRead(this, GET_MEMBER_NAME_CHECKED(ThisClass, Property)); \
+	} while (0)
+#else
+#define COOP_REP_READ(Property)
+#endif
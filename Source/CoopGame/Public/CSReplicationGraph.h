@@ -0,0 +1,148 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ReplicationGraph.h"
+#include "CSReplicationGraph.generated.h"
+
+class UReplicationGraphNode_ActorList;
+class UCSReplicationGraphNode_MatchGrid;
+
+
+// How actors of a class are routed into the graph
+enum class ECSClassRepNodeMapping : uint32
+{
+	//Not added to any global node, replicated through another actor or a connection node
+	NotRouted,
+
+	RelevantAllConnections,
+
+	//Spatialized, never move
+	Spatialize_Static,
+
+	//Spatialized, updated in the grid every frame
+	Spatialize_Dynamic,
+
+	//Spatialized, treated as static while dormant
+	Spatialize_Dormancy,
+};
+
+
+/*
+Replication graph for CoopGame, replaces the per actor and per connection relevancy checks of the net driver.
+Bots, characters and projectiles are gathered from a 2D spatial grid, pickups, powerups and barrels sit in its dormancy lists.
+Weapons are dependent actors of their character and replicate whenever it does.
+The game state is relevant to all connections, each connection gets its own match instance and the player states of its match.
+Actors gathered from the grid are dropped for connections of another match, see UCSReplicationGraphNode_MatchGrid.
+Enabled through ReplicationDriverClassName of the net driver in DefaultEngine.ini.
+*/
+UCLASS(Transient, Config = Engine)
+class COOPGAME_API UCSReplicationGraph : public UReplicationGraph
+{
+	GENERATED_BODY()
+
+public:
+
+	UCSReplicationGraph();
+
+	virtual void InitGlobalActorClassSettings() override;
+
+	virtual void InitGlobalGraphNodes() override;
+
+	virtual void InitConnectionGraphNodes(UNetReplicationGraphConnection* RepGraphConnection) override;
+
+	virtual void RouteAddNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo, FGlobalActorReplicationInfo& GlobalInfo) override;
+
+	virtual void RouteRemoveNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo) override;
+
+	/* Sets the net update frequency of a spawned actor. The graph reads it only once per actor, so its replication period is updated too */
+	static void SetActorNetUpdateFrequency(AActor* Actor, float NewFrequency);
+
+	/* Moves a dependent actor to the dependent list of its new owner, pooled weapons change owner without being respawned */
+	static void NotifyDependentOwnerChanged(AActor* Actor, AActor* OldOwner);
+
+protected:
+
+	UPROPERTY()
+	UCSReplicationGraphNode_MatchGrid* GridNode;
+
+	UPROPERTY()
+	UReplicationGraphNode_ActorList* AlwaysRelevantNode;
+
+	TClassMap<ECSClassRepNodeMapping> ClassRepNodePolicies;
+
+	ECSClassRepNodeMapping GetMappingPolicy(UClass* Class);
+
+	bool IsSpatialized(ECSClassRepNodeMapping Mapping) const { return Mapping >= ECSClassRepNodeMapping::Spatialize_Static; }
+
+	void InitClassReplicationInfo(FClassReplicationInfo& Info, UClass* Class, bool bSpatialize, float ServerMaxTickRate) const;
+
+	// Weapons replicate with the character that owns them
+	void AddDependentActor(AActor* Parent, AActor* Child);
+
+	void RemoveDependentActor(AActor* Parent, AActor* Child);
+
+};
+
+
+/*
+Spatial grid that only passes on actors of the viewer's match and level actors that are not tagged for another arena.
+Viewers without a match see everything. Players that joined mid-match get the grid in a growing radius, see ACSPlayerState::IsJoinStreamRelevant. Matches are looked up when gathering, so pooled actors can change their match without being moved in the grid.
+*/
+UCLASS()
+class COOPGAME_API UCSReplicationGraphNode_MatchGrid : public UReplicationGraphNode_GridSpatialization2D
+{
+	GENERATED_BODY()
+
+public:
+
+	UCSReplicationGraphNode_MatchGrid();
+
+	virtual void GatherActorListsForConnection(const FConnectionGatherActorListParameters& Params) override;
+
+protected:
+
+	// Returns false for actors the connection must not receive
+	virtual bool IsRelevantForConnection(const AActor* Actor, const FConnectionGatherActorListParameters& Params) const;
+
+	//Match of the connection being gathered and the arena tags of all other matches
+	int32 ViewerMatchId;
+	TArray<FName> OtherArenaTags;
+
+	//Radius the connection being gathered streams in, 0 once it is in
+	float JoinStreamRadius;
+
+	//Cell lists of the connection being gathered, filtered into ReplicationActorList. Connections are gathered and replicated one after another
+	FGatheredReplicationActorLists GridLists;
+
+	FActorRepListRefView ReplicationActorList;
+
+};
+
+
+/*
+Per connection node. Adds the viewer, its view target and pawn, the match instance of the viewer's match and the player states of that match.
+*/
+UCLASS()
+class COOPGAME_API UCSReplicationGraphNode_AlwaysRelevant_ForConnection : public UReplicationGraphNode
+{
+	GENERATED_BODY()
+
+public:
+
+	virtual void NotifyAddNetworkActor(const FNewReplicatedActorInfo& Actor) override { }
+
+	virtual bool NotifyRemoveNetworkActor(const FNewReplicatedActorInfo& ActorInfo, bool bWarnIfNotFound = true) override { return false; }
+
+	virtual void NotifyResetAllNetworkActors() override { }
+
+	virtual void GatherActorListsForConnection(const FConnectionGatherActorListParameters& Params) override;
+
+	virtual void LogNode(FReplicationGraphDebugInfo& DebugInfo, const FString& NodeName) const override;
+
+protected:
+
+	FActorRepListRefView ReplicationActorList;
+
+};
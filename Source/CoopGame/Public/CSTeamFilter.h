@@ -0,0 +1,56 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/EngineTypes.h"
+#include "Templates/SubclassOf.h"
+
+class AActor;
+class AController;
+class UDamageType;
+
+
+/*
+Maps teams onto the mask filter of the physics bodies so queries skip friendlies inside the physics scene.
+Teams 0 to 5 get a bit each, the physics scene has no room for more. Actors of other teams fall back to
+UCSHealthComponent::IsFriendly after the hit, like before.
+COOP.TeamCollisionFilter 0 turns the query side off to compare against, COOP.LogFriendlyDiscards 1 logs
+once per minute how many friendly events gameplay code still had to throw away.
+*/
+class COOPGAME_API FCSTeamFilter
+{
+public:
+
+	/* Bit of the team, 0 if the team has none */
+	static FMaskFilter GetTeamMask(uint8 TeamNum);
+
+	/* Bit of the team of the actor's health component, 0 without one */
+	static FMaskFilter GetTeamMask(const AActor* Actor);
+
+	/* Mask to ignore in queries made for the actor, 0 while the filter is turned off */
+	static FMaskFilter GetQueryIgnoreMask(const AActor* Actor);
+
+	/* Tags every primitive of the actor with the team bit */
+	static void ApplyTeamMask(AActor* Actor, FMaskFilter TeamMask);
+
+	static bool IsEnabled();
+
+	/*
+	Same as UGameplayStatics::ApplyRadialDamage, but the overlap skips the team of the damage causer.
+	Returns true if damage was applied to at least one actor.
+	*/
+	static bool ApplyRadialDamage(AActor* DamageCauser, float BaseDamage, const FVector& Origin, float DamageRadius, TSubclassOf<UDamageType> DamageTypeClass,
+		TArrayView<AActor* const> IgnoreActors, AController* InstigatedByController = nullptr, bool bDoFullDamage = false, ECollisionChannel DamagePreventionChannel = ECC_Visibility);
+
+	/* Counts a friendly event gameplay code rejected after the physics query reported it */
+	static void NotifyFriendlyDiscarded(FName Source);
+
+private:
+
+	static TMap<FName, int32> DiscardCounts;
+
+	static double CountStartTime;
+
+	static void LogDiscardCounts(double Now);
+};
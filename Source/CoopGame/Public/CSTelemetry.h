@@ -0,0 +1,116 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Async/Future.h"
+
+class AActor;
+class IFileHandle;
+
+
+// Gameplay events recorded by FCSTelemetry, stored as a byte in the file
+enum class ECSTelemetryEvent : uint8
+{
+	Damage,
+	Heal,
+	Kill,
+	Spawn,
+	WaveStart,
+	WaveEnd,
+	GameOver,
+};
+
+
+// Fixed size record of a telemetry event, written to the file as it is in memory
+struct FCSTelemetryRecord
+{
+	//World time of the event
+	float Time;
+
+	ECSTelemetryEvent Event;
+
+	//Match of the subject, -1 if it has none
+	int8 MatchId;
+
+	//Index into the class names written with the records
+	uint16 SubjectClass;
+
+	uint32 SubjectId;
+
+	//Instigator, damage causer or killer, 0 if there is none
+	uint32 OtherId;
+
+	uint16 OtherClass;
+
+	uint16 Reserved;
+
+	//Damage, heal amount or wave number
+	float Value;
+
+	//Location of the subject
+	float X;
+	float Y;
+	float Z;
+};
+
+static_assert(sizeof(FCSTelemetryRecord) == 36, "Telemetry files expect 36 byte records");
+
+
+/*
+Records gameplay events as fixed size records into a ring buffer on the game thread, no strings are built per event.
+New records are written to Saved/Telemetry in blocks on a worker thread, once a quarter of the buffer is filled or every COOP.TelemetryFlushInterval seconds.
+If the writer falls behind, the oldest records are overwritten and counted as dropped.
+
+File layout, little endian: "CSTL", version, record size, then blocks of
+	uint32 NumNewClasses, per class uint16 length and UTF-8 name, uint32 NumRecords, the records.
+Class indices of a record refer to all classes listed by the blocks so far.
+*/
+class COOPGAME_API FCSTelemetry
+{
+public:
+
+	static void Startup();
+
+	/* Writes what is left and closes the file */
+	static void Shutdown();
+
+	/* Records an event of the subject, game thread only. Wave events take the match instance as subject */
+	static void Record(ECSTelemetryEvent Event, const AActor* Subject, const AActor* Other = nullptr, float Value = 0.0f);
+
+	static bool IsEnabled();
+
+	/* Starts writing the records not written yet, skipped while the last block is still being written */
+	static void Flush();
+
+private:
+
+	static TArray<FCSTelemetryRecord> Ring;
+
+	//Records ever added and records handed to the writer, the ring holds the last Ring.Num() of them
+	static uint64 NumRecorded;
+	static uint64 NumFlushed;
+
+	static uint64 NumDropped;
+
+	static TMap<const UClass*, uint16> ClassIndices;
+
+	//Classes not written to the file yet
+	static TArray<FString> NewClassNames;
+
+	static IFileHandle* FileHandle;
+
+	static TFuture<void> PendingWrite;
+
+	static double LastFlushTime;
+
+	static FDelegateHandle EndFrameHandle;
+
+	static FCSTelemetryRecord& AddRecord(ECSTelemetryEvent Event);
+
+	static uint16 GetClassIndex(const UClass* Class);
+
+	static bool OpenFile();
+
+	static void OnEndFrame();
+};
@@ -0,0 +1,25 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "CSTimerBenchmarkCommandlet.generated.h"
+
+
+/*
+Runs the same timer workload on FTimerManager and on the timing wheel of the gameplay scheduler and logs the time each spends.
+Timers fire once or loop at random rates, every frame some of them are set again and some cleared and set anew.
+
+-run=CSTimerBenchmark [-Timers=5000] [-Frames=1800] [-Reset=500] [-Clear=50] [-Resolution=0.008333]
+*/
+UCLASS()
+class COOPGAME_API UCSTimerBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+
+	virtual int32 Main(const FString& Params) override;
+
+};
@@ -0,0 +1,150 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "TimerManager.h"
+
+
+// Handle to a timer of FCSTimingWheel, stays safe to use after the timer fired or was cleared
+struct COOPGAME_API FCSTimerHandle
+{
+	FCSTimerHandle() : Index(INDEX_NONE), Serial(0) { }
+
+	bool IsValid() const { return Index != INDEX_NONE; }
+
+	void Invalidate() { Index = INDEX_NONE; Serial = 0; }
+
+	bool operator==(const FCSTimerHandle& Other) const { return Index == Other.Index && Serial == Other.Serial; }
+
+	bool operator!=(const FCSTimerHandle& Other) const { return !(*this == Other); }
+
+private:
+
+	friend class FCSTimingWheel;
+
+	int32 Index;
+
+	uint32 Serial;
+};
+
+
+/*
+Hierarchical timing wheel. Time is cut into ticks of a fixed resolution, timers are kept in 4 levels of 64 slots,
+each level covering 64 times the span of the one below. Timers further out than the last level wait in it and are placed again when it turns.
+Setting and clearing a timer links or unlinks it from a slot, both are constant time. Timers due in a tick are collected and fired as one batch.
+Every timer belongs to an owner, all timers of an owner can be cleared at once.
+*/
+class COOPGAME_API FCSTimingWheel
+{
+public:
+
+	explicit FCSTimingWheel(float InResolution = 1.0f / 120.0f);
+
+	/* Clears all timers and starts the wheel at the given time */
+	void Reset(double Time);
+
+	/* Same arguments as FTimerManager::SetTimer. A rate of 0 or less clears the timer */
+	void SetTimer(FCSTimerHandle& InOutHandle, const void* Owner, const FTimerDelegate& Delegate, double Now, float Rate, bool bLoop, float FirstDelay = -1.0f);
+
+	void ClearTimer(FCSTimerHandle& InOutHandle);
+
+	/* Clears every timer of the owner, returns the number cleared */
+	int32 ClearAllTimersForOwner(const void* Owner);
+
+	bool IsTimerActive(const FCSTimerHandle& Handle) const;
+
+	/* Seconds until the timer fires, -1 if it is not active */
+	float GetTimerRemaining(const FCSTimerHandle& Handle, double Now) const;
+
+	bool HasTimersForOwner(const void* Owner) const { return OwnerHeads.Contains(Owner); }
+
+	/* Fires every timer due up to the given time, returns the number fired */
+	int32 Advance(double Now);
+
+	int32 GetNumTimers() const { return NumTimers; }
+
+	float GetResolution() const { return Resolution; }
+
+private:
+
+	enum
+	{
+		SlotBits = 6,
+		SlotsPerLevel = 1 << SlotBits,
+		SlotMask = SlotsPerLevel - 1,
+		NumLevels = 4,
+	};
+
+	//Bucket of free timers and timers collected for the tick being fired
+	static const int32 BucketFree = -1;
+	static const int32 BucketFiring = -2;
+
+	struct FTimer
+	{
+		FTimerDelegate Delegate;
+
+		const void* Owner;
+
+		uint64 ExpireTick;
+
+		//0 for timers firing once
+		uint32 IntervalTicks;
+
+		//Bumped whenever the timer is freed, outdates the handles to it
+		uint32 Serial;
+
+		int32 Bucket;
+
+		//Slot list, the free list uses Next only
+		int32 Prev;
+		int32 Next;
+
+		int32 OwnerPrev;
+		int32 OwnerNext;
+	};
+
+	TArray<FTimer> Timers;
+
+	int32 FreeHead;
+
+	int32 NumTimers;
+
+	//First timer of each slot, level by level
+	int32 Buckets[NumLevels * SlotsPerLevel];
+
+	//First timer of each owner
+	TMap<const void*, int32> OwnerHeads;
+
+	//Timers due in the tick being fired, with their serial to skip the ones cleared meanwhile
+	TArray<TPair<int32, uint32>> FiringTimers;
+
+	float Resolution;
+
+	//Next tick to fire, every tick before it has been fired
+	uint64 NextTick;
+
+	uint64 TimeToTick(double Time) const;
+
+	int32 AllocTimer();
+
+	void FreeTimer(int32 Index);
+
+	// Links the timer into the slot its expire tick falls in, seen from the next tick
+	void LinkTimer(int32 Index);
+
+	void UnlinkTimer(int32 Index);
+
+	void LinkOwner(int32 Index);
+
+	void UnlinkOwner(int32 Index);
+
+	// Places the timers of a slot of an upper level again, they move down to a lower one
+	int32 Cascade(int32 Level);
+
+	// Fires the timers due in the tick, returns the number fired
+	int32 FireTick(uint64 Tick);
+
+	const FTimer* FindTimer(const FCSTimerHandle& Handle) const;
+
+};
@@ -0,0 +1,167 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "Containers/SparseArray.h"
+#include "CSTriggerManager.generated.h"
+
+
+//Enter and exit events of a trigger, the argument is the occupant
+DECLARE_DELEGATE_OneParam(FCSTriggerSignature, AActor*);
+
+
+// Handle to a trigger of ACSTriggerManager, stays safe to use after the trigger was removed
+struct COOPGAME_API FCSTriggerHandle
+{
+	FCSTriggerHandle() : Index(INDEX_NONE), Serial(0) { }
+
+	bool IsValid() const { return Index != INDEX_NONE; }
+
+	void Invalidate() { Index = INDEX_NONE; Serial = 0; }
+
+private:
+
+	friend class ACSTriggerManager;
+
+	int32 Index;
+
+	uint32 Serial;
+};
+
+
+/*
+Per world manager for the trigger spheres of gameplay actors, replaces their overlap components.
+Occupants are the actors that can set triggers off, they are put into a 2D grid once per tick
+and every enabled trigger tests only the cells under it. Enter and exit events are collected over the whole pass
+and raised after it, so handlers can add and remove triggers safely.
+Runs wherever triggers are added, on the server and on clients.
+*/
+UCLASS(NotPlaceable, Transient)
+class COOPGAME_API ACSTriggerManager : public AActor
+{
+	GENERATED_BODY()
+
+public:
+
+	ACSTriggerManager();
+
+	/* Returns the trigger manager of the given world, spawns one if there is none yet */
+	static ACSTriggerManager* Get(UWorld* World, bool bCreateIfMissing = true);
+
+	/* Adds a trigger sphere at the owner. Moving triggers follow the owner, the others stay where they were added */
+	FCSTriggerHandle AddTrigger(AActor* Owner, float Radius, bool bMovesWithOwner, const FCSTriggerSignature& OnEnter, const FCSTriggerSignature& OnExit = FCSTriggerSignature());
+
+	void RemoveTrigger(FCSTriggerHandle& InOutHandle);
+
+	/* Disabled triggers are skipped, occupants inside are forgotten without exit events */
+	void SetTriggerEnabled(const FCSTriggerHandle& Handle, bool bEnabled);
+
+	/* Occupants sharing a bit with the mask never enter the trigger, see FCSTeamFilter */
+	void SetTriggerIgnoreMask(const FCSTriggerHandle& Handle, FMaskFilter IgnoreMask);
+
+	/* Occupants are tested with their collision cylinder and filtered by their team */
+	void AddOccupant(AActor* Actor);
+
+	/* Raises the exit events of every trigger the occupant is in */
+	void RemoveOccupant(AActor* Actor);
+
+	int32 GetNumTriggers() const { return Triggers.Num(); }
+
+	int32 GetNumOccupants() const { return Occupants.Num(); }
+
+protected:
+
+	struct FTrigger
+	{
+		TWeakObjectPtr<AActor> Owner;
+
+		FVector Location;
+
+		float Radius;
+
+		bool bMovesWithOwner;
+
+		bool bEnabled;
+
+		FMaskFilter IgnoreMask;
+
+		uint32 Serial;
+
+		FCSTriggerSignature OnEnter;
+
+		FCSTriggerSignature OnExit;
+
+		//Occupants inside the trigger since the last pass
+		TArray<TWeakObjectPtr<AActor>, TInlineAllocator<4>> Inside;
+	};
+
+	struct FOccupant
+	{
+		TWeakObjectPtr<AActor> Actor;
+
+		FVector Location;
+
+		float Radius;
+
+		float HalfHeight;
+
+		FMaskFilter TeamMask;
+	};
+
+	struct FTriggerEvent
+	{
+		int32 TriggerIndex;
+
+		uint32 Serial;
+
+		TWeakObjectPtr<AActor> Actor;
+
+		bool bEnter;
+	};
+
+	TSparseArray<FTrigger> Triggers;
+
+	uint32 NextSerial;
+
+	TArray<FOccupant> Occupants;
+
+	//Cell of every occupant, occupants sorted by cell and the range of each cell in the sorted list
+	TArray<int64> CellKeys;
+
+	TArray<int32> SortedOccupantIndices;
+
+	TMap<int64, FIntPoint> CellRanges;
+
+	//Largest occupant radius of the pass, widens the cells a trigger looks at
+	float MaxOccupantRadius;
+
+	float CellSize;
+
+	TArray<FTriggerEvent> PendingEvents;
+
+	//Scratch list of the occupants overlapping the trigger being tested
+	TArray<TWeakObjectPtr<AActor>, TInlineAllocator<8>> Overlapping;
+
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	int64 GetCellKey(int32 CellX, int32 CellY) const;
+
+	FTrigger* FindTrigger(const FCSTriggerHandle& Handle);
+
+	// Reads the occupant locations and puts them into the grid, drops destroyed occupants
+	void BuildOccupantGrid();
+
+	// Tests the trigger against the occupants in its cells and queues its events
+	void UpdateTrigger(int32 TriggerIndex, FTrigger& Trigger);
+
+	bool IsOverlapping(const FTrigger& Trigger, const FOccupant& Occupant) const;
+
+	void DispatchEvents();
+
+public:
+
+	virtual void Tick(float DeltaSeconds) override;
+
+};
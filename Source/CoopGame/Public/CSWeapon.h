@@ -4,12 +4,16 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
+#include "CollisionQueryParams.h"
+#include "CSPoolableActor.h"
+#include "CSTimingWheel.h"
 #include "CSWeapon.generated.h"
 
 class USkeletalMeshComponent;
 class UDamageType;
 class UParticleSystem;
 class UCameraShake;
+class UCSEffectComponent;
 
 
 // Contains information of a single hitscan weapon line trace
@@ -30,7 +34,7 @@ public:
 
 
 UCLASS()
-class COOPGAME_API ACSWeapon : public AActor
+class COOPGAME_API ACSWeapon : public AActor, public ICSPoolableActor
 {
 	GENERATED_BODY()
 	
@@ -73,9 +77,18 @@ protected:
 	UPROPERTY(EditDefaultsOnly, Category = "Weapon")
 	float ReloadSpeed;
 
+	/* Damage and critical hit effects of the owner add to the multipliers of the weapon */
+	UPROPERTY(Transient)
+	UCSEffectComponent* OwnerEffectComp;
+
+	//Hit scan trace params, built once per owner instead of on every shot. Clients get the owner replicated, so they are built on demand
+	FCollisionQueryParams FireQueryParams;
+
+	TWeakObjectPtr<AActor> FireQueryParamsOwner;
+
 #pragma region RateOfFire
 
-	FTimerHandle TimerHandle_TimeBetweenShots;
+	FCSTimerHandle TimerHandle_TimeBetweenShots;
 	float LastFiredTime;
 
 	/* BPM - Bullets per minute fired by weapon */
@@ -87,6 +100,31 @@ protected:
 
 #pragma endregion RateOfFire
 
+#pragma region Replication
+
+	/* Net update frequency while the weapon is firing, 0 uses the NetUpdateFrequency of the class */
+	UPROPERTY(EditDefaultsOnly, Category = "Weapon|Replication", meta = (ClampMin = "0"))
+	float FiringNetUpdateFrequency;
+
+	/* Net update frequency while the weapon is held without firing, ammo and reloads replicate at this rate */
+	UPROPERTY(EditDefaultsOnly, Category = "Weapon|Replication", meta = (ClampMin = "1"))
+	float IdleNetUpdateFrequency;
+
+	/* Time after the last shot before the weapon drops to the idle rate */
+	UPROPERTY(EditDefaultsOnly, Category = "Weapon|Replication")
+	float IdleNetUpdateDelay;
+
+	bool bNetUpdateIdle;
+
+	float LastNetFireTime;
+
+	// Raise the net update rate on the server when the weapon fires
+	void NotifyNetFire();
+
+	void SetNetUpdateIdle(bool bNewIdle);
+
+#pragma endregion Replication
+
 #pragma region Ammo
 
 	UPROPERTY(Replicated, EditDefaultsOnly, BlueprintReadOnly, Category = "Weapon|Ammo")
@@ -168,6 +206,10 @@ protected:
 
 
 
+	float GetDamageMultiplier() const;
+
+	float GetCriticalHitMultiplier() const;
+
 	/* Add given amount to weapon base damage */
 	UFUNCTION(BlueprintCallable, Server, Reliable, WithValidation, Category = "Weapon")
 	void AddBaseDamage(float amount);
@@ -201,6 +243,22 @@ public:
 	//Methods
 	virtual void Tick(float DeltaSeconds) override;
 
+	/* Weapons belong to player pawns, which are destroyed when the level is reset */
+	virtual void Reset() override;
+
+	virtual void PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker) override;
+
+	virtual void PostNetReceive() override;
+
+	virtual bool CallRemoteFunction(UFunction* Function, void* Parameters, FOutParmRec* OutParms, FFrame* Stack) override;
+
+	/* Weapons replicate as dependents of their owner, the replication graph follows them to a new owner */
+	virtual void SetOwner(AActor* NewOwner) override;
+
+	virtual void OnAcquiredFromPool_Implementation() override;
+
+	virtual void OnReleasedToPool_Implementation() override;
+
 	UFUNCTION(BLueprintCallable, Category = "Weapon")
 	bool CanReload();
 
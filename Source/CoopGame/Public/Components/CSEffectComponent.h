@@ -0,0 +1,191 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "Engine/NetSerialization.h"
+#include "CSTimingWheel.h"
+#include "CSEffectComponent.generated.h"
+
+class UCSEffectComponent;
+
+
+// Stats an effect can modify, every stat is the sum of the percentages of its active effects
+UENUM(BlueprintType)
+enum class ECSEffectStat : uint8
+{
+	MoveSpeed,
+	Damage,
+	CriticalHit,
+
+	MAX UMETA(Hidden)
+};
+
+
+// Modifier applied by a powerup, configured on its class
+USTRUCT(BlueprintType)
+struct FCSEffectSpec
+{
+	GENERATED_BODY()
+
+public:
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Effect")
+	ECSEffectStat Stat;
+
+	/* Percent added to the stat, 100 doubles it */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Effect")
+	float Percent;
+
+	/* Seconds the effect lasts, 0 lasts until it is removed */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Effect", meta = (ClampMin = "0.0"))
+	float Duration;
+
+	FCSEffectSpec() : Stat(ECSEffectStat::MoveSpeed), Percent(0.0f), Duration(0.0f) { }
+};
+
+
+// A single active effect, replicated as an item of FCSActiveEffectArray
+USTRUCT(BlueprintType)
+struct FCSActiveEffect : public FFastArraySerializerItem
+{
+	GENERATED_BODY()
+
+public:
+
+	UPROPERTY(BlueprintReadOnly, Category = "Effect")
+	int32 EffectId;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Effect")
+	ECSEffectStat Stat;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Effect")
+	float Percent;
+
+	/* Server world time the effect expires at, 0 never expires */
+	UPROPERTY(BlueprintReadOnly, Category = "Effect")
+	float ExpireTime;
+
+	//Actor that applied the effect, only known to the server
+	TWeakObjectPtr<const UObject> Source;
+
+	FCSActiveEffect() : EffectId(INDEX_NONE), Stat(ECSEffectStat::MoveSpeed), Percent(0.0f), ExpireTime(0.0f) { }
+
+	void PostReplicatedAdd(const struct FCSActiveEffectArray& InArraySerializer);
+	void PostReplicatedChange(const struct FCSActiveEffectArray& InArraySerializer);
+	void PreReplicatedRemove(const struct FCSActiveEffectArray& InArraySerializer);
+};
+
+
+// Active effects of a component, only added and removed items are sent to clients
+USTRUCT()
+struct FCSActiveEffectArray : public FFastArraySerializer
+{
+	GENERATED_BODY()
+
+public:
+
+	UPROPERTY()
+	TArray<FCSActiveEffect> Items;
+
+	UPROPERTY(NotReplicated)
+	UCSEffectComponent* Owner;
+
+	FCSActiveEffectArray() : Owner(nullptr) { }
+
+	bool NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms)
+	{
+		return FFastArraySerializer::FastArrayDeltaSerialize<FCSActiveEffect, FCSActiveEffectArray>(Items, DeltaParms, *this);
+	}
+};
+
+template<>
+struct TStructOpsTypeTraits<FCSActiveEffectArray> : public TStructOpsTypeTraitsBase2<FCSActiveEffectArray>
+{
+	enum
+	{
+		WithNetDeltaSerializer = true,
+	};
+};
+
+
+//OnEffectStatsChanged event
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnEffectStatsChangedSignature, UCSEffectComponent*, EffectComp);
+
+
+/*
+Keeps the stat modifiers active on its owner. Stats are summed up only when an effect is added or removed,
+reading a stat is a lookup no matter how many effects are stacked.
+All timed effects of the component expire from a single timer set to the earliest expiry.
+Effects are added on the server and replicate to clients as a fast array delta.
+*/
+UCLASS( ClassGroup=(Coop), meta=(BlueprintSpawnableComponent) )
+class COOPGAME_API UCSEffectComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	// Sets default values for this component's properties
+	UCSEffectComponent();
+
+protected:
+
+	UPROPERTY(Replicated)
+	FCSActiveEffectArray ActiveEffects;
+
+	//Summed percent of every stat
+	float StatPercents[(uint8)ECSEffectStat::MAX];
+
+	int32 NextEffectId;
+
+	FCSTimerHandle TimerHandle_ExpireEffects;
+
+	virtual void BeginPlay() override;
+
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	// Removes every effect whose time is up and sets the timer to the next expiry
+	void ExpireEffects();
+
+	void ScheduleExpiry();
+
+	void RemoveEffectAt(int32 Index);
+
+public:
+
+	/* Adds an effect on the server, returns its id */
+	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly, Category = "Effect Component")
+	int32 AddEffect(const FCSEffectSpec& Spec, const UObject* Source = nullptr);
+
+	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly, Category = "Effect Component")
+	bool RemoveEffect(int32 EffectId);
+
+	/* Removes every effect applied by the source, returns the number removed */
+	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly, Category = "Effect Component")
+	int32 RemoveEffectsFromSource(const UObject* Source);
+
+	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly, Category = "Effect Component")
+	void ClearEffects();
+
+	/* Summed percent of all active effects on the stat */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Effect Component")
+	float GetStatPercent(ECSEffectStat Stat) const { return Stat < ECSEffectStat::MAX ? StatPercents[(uint8)Stat] : 0.0f; }
+
+	/* Factor to scale the stat with, never below 0 */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Effect Component")
+	float GetStatMultiplier(ECSEffectStat Stat) const { return FMath::Max(1.0f + GetStatPercent(Stat) / 100.0f, 0.0f); }
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Effect Component")
+	int32 GetNumActiveEffects() const { return ActiveEffects.Items.Num(); }
+
+	const TArray<FCSActiveEffect>& GetActiveEffects() const { return ActiveEffects.Items; }
+
+	// Sums up the stats again, called whenever the set of effects changes
+	void UpdateStats();
+
+	/* Called on server and clients after the stats changed */
+	UPROPERTY(BlueprintAssignable, Category = "Effect Component|Event")
+	FOnEffectStatsChangedSignature OnStatsChanged;
+
+};
@@ -50,6 +50,10 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Health Component")
 	void Heal(float HealAmount);
 
+	/* Brings the owner back to full health, used when pooled actors are reused */
+	UFUNCTION(BlueprintCallable, Category = "Health Component")
+	void ResetHealth();
+
 	UPROPERTY(BlueprintAssignable, Category = "Health Component|Event")
 	FOnHealthChangedSignature OnHealthChanged;
 
@@ -0,0 +1,297 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "Engine/EngineBaseTypes.h"
+#include "CSSoakTestComponent.generated.h"
+
+class UCSSoakTestComponent;
+class ACSSoakPlayerController;
+class ACSTrackerBotSwarm;
+
+
+// Time stamps the physics step of the frame, one runs right before StartPhysics and one right after EndPhysics
+USTRUCT()
+struct FCSSoakPhysicsTickFunction : public FTickFunction
+{
+	GENERATED_BODY()
+
+public:
+
+	UCSSoakTestComponent* Target;
+
+	bool bPhysicsStart;
+
+	FCSSoakPhysicsTickFunction()
+		: Target(nullptr)
+		, bPhysicsStart(false)
+	{}
+
+	virtual void ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent) override;
+
+	virtual FString DiagnosticMessage() override;
+};
+
+template<>
+struct TStructOpsTypeTraits<FCSSoakPhysicsTickFunction> : public TStructOpsTypeTraitsBase2<FCSSoakPhysicsTickFunction>
+{
+	enum
+	{
+		WithCopy = false
+	};
+};
+
+
+// Measurements of a single wave
+USTRUCT(BlueprintType)
+struct FCSSoakWaveReport
+{
+	GENERATED_BODY()
+
+public:
+
+	UPROPERTY(BlueprintReadOnly, Category = "Soak Test")
+	int32 Wave;
+
+	/* Number of bots the game mode spawns in the wave */
+	UPROPERTY(BlueprintReadOnly, Category = "Soak Test")
+	int32 WaveSize;
+
+	/* Game time from wave start to wave complete */
+	UPROPERTY(BlueprintReadOnly, Category = "Soak Test")
+	float Duration;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Soak Test")
+	int32 NumFrames;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Soak Test")
+	float FrameTimeP50Ms;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Soak Test")
+	float FrameTimeP90Ms;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Soak Test")
+	float FrameTimeP99Ms;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Soak Test")
+	float FrameTimeMaxMs;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Soak Test")
+	float PhysicsTimeAvgMs;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Soak Test")
+	float PhysicsTimeMaxMs;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Soak Test")
+	int32 PeakLiveBots;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Soak Test")
+	float UsedMemoryMB;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Soak Test")
+	float PeakUsedMemoryMB;
+
+	/* Heap allocations of the game thread per frame, -1 if they were not counted */
+	UPROPERTY(BlueprintReadOnly, Category = "Soak Test")
+	float HeapAllocsAvg;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Soak Test")
+	int32 HeapAllocsMax;
+
+	/* Frames taking longer than the hitch threshold */
+	UPROPERTY(BlueprintReadOnly, Category = "Soak Test")
+	int32 NumHitches;
+
+	/* Remote clients connected at the end of the wave */
+	UPROPERTY(BlueprintReadOnly, Category = "Soak Test")
+	int32 NumClients;
+
+	/* Bandwidth the server sends to a remote client, averaged over clients */
+	UPROPERTY(BlueprintReadOnly, Category = "Soak Test")
+	float NetOutKBpsAvg;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Soak Test")
+	float NetOutKBpsMax;
+
+	/* Peak physical memory of the process since it started */
+	UPROPERTY(BlueprintReadOnly, Category = "Soak Test")
+	float MemoryHighWaterMB;
+
+	FCSSoakWaveReport()
+		: Wave(0)
+		, WaveSize(0)
+		, Duration(0.0f)
+		, NumFrames(0)
+		, FrameTimeP50Ms(0.0f)
+		, FrameTimeP90Ms(0.0f)
+		, FrameTimeP99Ms(0.0f)
+		, FrameTimeMaxMs(0.0f)
+		, PhysicsTimeAvgMs(0.0f)
+		, PhysicsTimeMaxMs(0.0f)
+		, PeakLiveBots(0)
+		, UsedMemoryMB(0.0f)
+		, PeakUsedMemoryMB(0.0f)
+		, HeapAllocsAvg(-1.0f)
+		, HeapAllocsMax(-1)
+		, NumHitches(0)
+		, NumClients(0)
+		, NetOutKBpsAvg(0.0f)
+		, NetOutKBpsMax(0.0f)
+		, MemoryHighWaterMB(0.0f)
+	{}
+};
+
+
+/*
+Runs the match as an accelerated soak test when the game is started with -Soak.
+Stand-in players controlled by ACSSoakPlayerController fight the waves, the game runs on a fixed time step without idling
+and frame time, physics time, bot count and memory are recorded per wave. The report is written to Saved/Soak when the run ends.
+
+Example for a headless run on a build machine:
+	CoopGame <Map> -server -log -unattended -Soak -SoakWaves=50 -SoakPlayers=4 -SoakFPS=30
+Client builds need -nullrhi -nosound to run without rendering and audio.
+With -SoakClients=N the first wave waits for N remote clients, their bandwidth is part of the report.
+Build/Scripts/RunPerfTest.py runs a server with headless clients and compares the report against a baseline.
+*/
+UCLASS( ClassGroup=(Coop), meta=(BlueprintSpawnableComponent) )
+class COOPGAME_API UCSSoakTestComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+	friend struct FCSSoakPhysicsTickFunction;
+
+public:
+
+	UCSSoakTestComponent();
+
+protected:
+
+#pragma region Settings
+
+	/* Waves to play before the report is written and the game exits. -SoakWaves= */
+	UPROPERTY(EditDefaultsOnly, Category = "Soak Test", meta = (ClampMin = "1"))
+	int32 NumWaves;
+
+	/* Number of stand-in players. -SoakPlayers= */
+	UPROPERTY(EditDefaultsOnly, Category = "Soak Test", meta = (ClampMin = "1"))
+	int32 NumStandInPlayers;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Soak Test")
+	TSubclassOf<ACSSoakPlayerController> StandInControllerClass;
+
+	/* Simulated frames per second. The game steps by a fixed delta time and does not wait for real time. 0 runs in real time. -SoakFPS= */
+	UPROPERTY(EditDefaultsOnly, Category = "Soak Test", meta = (ClampMin = "0.0"))
+	float FixedFrameRate;
+
+	/* Global time dilation. Large values make physics sub step or clamp, prefer a fixed frame rate. -SoakTimeDilation= */
+	UPROPERTY(EditDefaultsOnly, Category = "Soak Test", meta = (ClampMin = "0.1"))
+	float TimeDilation;
+
+	/* Stand-in players take damage and the match can be lost. -SoakMortal */
+	UPROPERTY(EditDefaultsOnly, Category = "Soak Test")
+	bool bMortalStandIns;
+
+	/* Waves averaging more game thread heap allocations per frame fail the run with an error. 0 has no budget. -SoakMaxHeapAllocs= */
+	UPROPERTY(EditDefaultsOnly, Category = "Soak Test", meta = (ClampMin = "0"))
+	int32 MaxHeapAllocsPerFrame;
+
+	/* Remote clients that have to join before the first wave starts. -SoakClients= */
+	UPROPERTY(EditDefaultsOnly, Category = "Soak Test", meta = (ClampMin = "0"))
+	int32 NumClients;
+
+	/* Real seconds to wait for the remote clients before the run fails. -SoakClientTimeout= */
+	UPROPERTY(EditDefaultsOnly, Category = "Soak Test", meta = (ClampMin = "1.0"))
+	float ClientTimeout;
+
+	/* Frames taking longer in real time count as hitches. -SoakHitchMs= */
+	UPROPERTY(EditDefaultsOnly, Category = "Soak Test", meta = (ClampMin = "1.0"))
+	float HitchThresholdMs;
+
+	/* Seed of the random streams so runs spread shots and pick targets the same way. -SoakSeed= */
+	UPROPERTY(EditDefaultsOnly, Category = "Soak Test")
+	int32 RandomSeed;
+
+#pragma endregion Settings
+
+	bool bSoakRunning;
+
+	int32 WavesPlayed;
+
+	int32 NumGameOvers;
+
+	TArray<FCSSoakWaveReport> WaveReports;
+
+	//Current wave
+	FCSSoakWaveReport CurrentWave;
+	float WaveStartTime;
+	bool bWaveRunning;
+	TArray<float> FrameTimesMs;
+	float PhysicsTimeTotalMs;
+	int32 NumPhysicsSteps;
+	int64 HeapAllocsTotal;
+	int32 NumHeapAllocFrames;
+	float NetOutKBpsTotal;
+	int32 NumNetSamples;
+
+	bool bClientsJoined;
+	double ClientWaitStartTime;
+
+	TWeakObjectPtr<ACSTrackerBotSwarm> Swarm;
+
+	double LastFrameTime;
+	double PhysicsStartTime;
+
+	FCSSoakPhysicsTickFunction PhysicsStartTickFunction;
+	FCSSoakPhysicsTickFunction PhysicsEndTickFunction;
+
+	virtual void BeginPlay() override;
+
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	void ParseCommandLine();
+
+	void RegisterPhysicsTickFunctions();
+
+	void UnregisterPhysicsTickFunctions();
+
+	void OnPhysicsStart();
+
+	void OnPhysicsEnd();
+
+	void SampleMemory();
+
+	void SampleNetwork();
+
+	int32 GetNumClients() const;
+
+	void UpdateClientsJoined();
+
+	void FinishRun();
+
+	void WriteReport() const;
+
+public:
+
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+	/* Returns true if the game was started as a soak test */
+	bool IsSoakRunning() const { return bSoakRunning; }
+
+	/* Returns true while the soak test holds the match for remote clients to join */
+	bool IsWaitingForClients() const { return bSoakRunning && !bClientsJoined; }
+
+	/* Spawns the stand-in players, they are restarted by the game mode like real players */
+	void SpawnStandInPlayers();
+
+	void NotifyWaveStarted(int32 Wave, int32 WaveSize);
+
+	void NotifyWaveCompleted(int32 Wave);
+
+	void NotifyGameOver();
+
+	UFUNCTION(BlueprintCallable, Category = "Soak Test")
+	TArray<FCSSoakWaveReport> GetWaveReports() const { return WaveReports; }
+
+};
@@ -0,0 +1,183 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "CSSpawnDirectorComponent.generated.h"
+
+class ACSTrackerBot;
+class ACSTrackerBotSwarm;
+
+
+/*
+Spawns tracker bots for a match instance natively.
+Bots are taken from the actor pool, which is pre-warmed between waves, and go back into it after they exploded,
+spawn locations are picked from a set of navigable candidates computed once when play begins.
+The spawn rate adapts to server frame time, net saturation and the number of live bots to stay inside a budget.
+*/
+UCLASS( ClassGroup=(Coop), meta=(BlueprintSpawnableComponent) )
+class COOPGAME_API UCSSpawnDirectorComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+
+	UCSSpawnDirectorComponent();
+
+protected:
+
+	/* Bot spawned by the director. If not set the match falls back to its SpawnNewBot Blueprint hook */
+	UPROPERTY(EditDefaultsOnly, Category = "Spawn Director")
+	TSubclassOf<ACSTrackerBot> BotClass;
+
+	/* Time an exploded bot stays in the world before it returns to the pool */
+	UPROPERTY(EditDefaultsOnly, Category = "Spawn Director", meta = (ClampMin = "0.0"))
+	float ReleaseDelay;
+
+#pragma region Spawn Points
+
+	/* Actors with this tag are used as spawn origins. Player starts are used if no actor has the tag */
+	UPROPERTY(EditDefaultsOnly, Category = "Spawn Director|Spawn Points")
+	FName SpawnOriginTag;
+
+	/* Number of spawn candidates sampled on the navmesh around each spawn origin */
+	UPROPERTY(EditDefaultsOnly, Category = "Spawn Director|Spawn Points", meta = (ClampMin = "1"))
+	int32 CandidatesPerOrigin;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Spawn Director|Spawn Points", meta = (ClampMin = "0.0"))
+	float CandidateRadius;
+
+	/* Candidates closer than this to a player are not used */
+	UPROPERTY(EditDefaultsOnly, Category = "Spawn Director|Spawn Points", meta = (ClampMin = "0.0"))
+	float MinDistanceToPlayers;
+
+	/* Height above the navmesh bots are spawned at */
+	UPROPERTY(EditDefaultsOnly, Category = "Spawn Director|Spawn Points")
+	float SpawnHeightOffset;
+
+	TArray<FVector> SpawnCandidates;
+
+#pragma endregion Spawn Points
+
+#pragma region Budget
+
+	/* Scale the spawn interval with the server load. Waves keep their size, only the pace changes */
+	UPROPERTY(EditDefaultsOnly, Category = "Spawn Director|Budget")
+	bool bAdaptiveSpawning;
+
+	/* Game thread time per frame the server should stay under, idle time is not counted */
+	UPROPERTY(EditDefaultsOnly, Category = "Spawn Director|Budget", meta = (ClampMin = "1.0"))
+	float FrameBudgetMs;
+
+	/* Fraction of client connections allowed to be saturated */
+	UPROPERTY(EditDefaultsOnly, Category = "Spawn Director|Budget", meta = (ClampMin = "0.01", ClampMax = "1.0"))
+	float MaxNetSaturation;
+
+	/* Spawns are held while this many bots are alive */
+	UPROPERTY(EditDefaultsOnly, Category = "Spawn Director|Budget", meta = (ClampMin = "1"))
+	int32 MaxLiveBots;
+
+	/* Below this load bots are spawned faster than the game mode interval */
+	UPROPERTY(EditDefaultsOnly, Category = "Spawn Director|Budget", meta = (ClampMin = "0.0", ClampMax = "1.0"))
+	float AccelerateBelowLoad;
+
+	/* Above this load spawns are held until the server recovers */
+	UPROPERTY(EditDefaultsOnly, Category = "Spawn Director|Budget", meta = (ClampMin = "1.0"))
+	float DeferAboveLoad;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Spawn Director|Budget", meta = (ClampMin = "0.0", ClampMax = "1.0"))
+	float MinSpawnIntervalScale;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Spawn Director|Budget", meta = (ClampMin = "1.0"))
+	float MaxSpawnIntervalScale;
+
+	/* Half life in seconds of the smoothing applied to frame time and net saturation */
+	UPROPERTY(EditDefaultsOnly, Category = "Spawn Director|Budget", meta = (ClampMin = "0.0"))
+	float LoadSmoothingHalfLife;
+
+	TWeakObjectPtr<ACSTrackerBotSwarm> Swarm;
+
+#pragma endregion Budget
+
+#pragma region Metrics
+
+	/* Smoothed game thread time of the server */
+	UPROPERTY(VisibleInstanceOnly, BlueprintReadOnly, Transient, Category = "Spawn Director|Metrics")
+	float FrameTimeMs;
+
+	/* Smoothed fraction of saturated client connections */
+	UPROPERTY(VisibleInstanceOnly, BlueprintReadOnly, Transient, Category = "Spawn Director|Metrics")
+	float NetSaturation;
+
+	/* Active bots of this director, or of the whole world if the director does not spawn bots itself */
+	UPROPERTY(VisibleInstanceOnly, BlueprintReadOnly, Transient, Category = "Spawn Director|Metrics")
+	int32 LiveBots;
+
+	/* Highest of frame time, net saturation and live bots relative to their budget. Above 1 the server is over budget */
+	UPROPERTY(VisibleInstanceOnly, BlueprintReadOnly, Transient, Category = "Spawn Director|Metrics")
+	float Load;
+
+	/* Multiplier the director currently applies to the spawn interval */
+	UPROPERTY(VisibleInstanceOnly, BlueprintReadOnly, Transient, Category = "Spawn Director|Metrics")
+	float SpawnIntervalScale;
+
+	/* Spawns held back because the server was over budget */
+	UPROPERTY(VisibleInstanceOnly, BlueprintReadOnly, Transient, Category = "Spawn Director|Metrics")
+	int32 NumDeferredSpawns;
+
+#pragma endregion Metrics
+
+	/* Exploded bots and the world time at which they go back into the pool */
+	UPROPERTY(Transient)
+	TArray<ACSTrackerBot*> PendingReleaseBots;
+
+	TArray<float> PendingReleaseTimes;
+
+	//Spawned and not yet exploded or returned
+	int32 NumActiveBots;
+
+	virtual void BeginPlay() override;
+
+	void BuildSpawnCandidates();
+
+	bool PickSpawnLocation(FVector& OutLocation) const;
+
+	void AddToPool(ACSTrackerBot* Bot);
+
+	void UpdateLoad(float DeltaTime);
+
+public:
+
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+	/* Returns true if the director is set up to spawn bots */
+	bool CanSpawnBots() const;
+
+	/* Activates a bot from the pool at a spawn location. Returns nullptr if no bot could be spawned */
+	ACSTrackerBot* SpawnBot();
+
+	/* Keep the given number of bots in the actor pool for this director, the pool grows over the next frames */
+	void PrewarmPool(int32 NumBots);
+
+	/* Returns the bot to the pool after ReleaseDelay */
+	void ReleaseBot(ACSTrackerBot* Bot);
+
+	/* Returns the bot to the pool right away */
+	void ReturnBot(ACSTrackerBot* Bot);
+
+	int32 GetNumPooledBots() const;
+
+	/* Set before play begins, each arena of a multi match server has its own spawn origins */
+	void SetSpawnOriginTag(FName NewSpawnOriginTag) { SpawnOriginTag = NewSpawnOriginTag; }
+
+	/* Returns true if the next spawn should be held back because the server is over budget */
+	bool ShouldDeferSpawn() const;
+
+	/* Counts a spawn the caller held back after ShouldDeferSpawn */
+	void NotifySpawnDeferred();
+
+	/* Returns the interval until the next spawn, scaled by the current load */
+	float GetSpawnInterval(float BaseInterval) const;
+
+};